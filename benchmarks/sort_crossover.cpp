@@ -0,0 +1,91 @@
+// Per-hit cost of the two engines that order the hits of an event whose
+// sensor IDs are too sparse for the counting sort: the radix sort and the
+// comparison sort. Where the radix sort catches up is kRadixSortMinHits.
+//
+// Build from the repository root (needs pybind11 and the Python headers):
+//
+//   c++ -O3 -std=c++17 -ffp-contract=off $(python3 -m pybind11 --includes) \
+//       benchmarks/sort_crossover.cpp -o sort_crossover $(python3-config --ldflags --embed)
+//   ./sort_crossover [strings] [sensors per string]
+//
+// Hits fall on random sensors of a strings x sensors detector (80 x 80 by
+// default) at random times; each size is timed on fresh events until it has
+// run for about 0.2 s, and the best of five such rounds is reported.
+
+#include "../src/nt_summary_stats.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+struct BenchEvent {
+    std::vector<int32_t> string_ids;
+    std::vector<int32_t> sensor_ids;
+    std::vector<double> times;
+    EventInputs inputs;
+};
+
+BenchEvent make_event(std::size_t n_hits, int32_t n_strings, int32_t n_sensors, std::mt19937_64& rng) {
+    BenchEvent event;
+    std::uniform_int_distribution<int32_t> string_id(1, n_strings);
+    std::uniform_int_distribution<int32_t> sensor_id(1, n_sensors);
+    std::uniform_real_distribution<double> time(0.0, 10000.0);
+    for (std::size_t i = 0; i < n_hits; ++i) {
+        event.string_ids.push_back(string_id(rng));
+        event.sensor_ids.push_back(sensor_id(rng));
+        event.times.push_back(time(rng));
+    }
+    event.inputs.n_hits = n_hits;
+    event.inputs.string_ids = event.string_ids.data();
+    event.inputs.sensor_ids = event.sensor_ids.data();
+    event.inputs.times = event.times.data();
+    return event;
+}
+
+// Best ns/hit over five rounds of ordering `events` round-robin with `sort`.
+template<typename Sort>
+double time_per_hit(const std::vector<BenchEvent>& events, std::size_t n_hits, Sort sort) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::size_t> order(n_hits);
+    double best = std::numeric_limits<double>::infinity();
+    for (int round = 0; round < 5; ++round) {
+        std::size_t n_sorted = 0;
+        const auto start = Clock::now();
+        double elapsed = 0.0;
+        while (elapsed < 0.2) {
+            with_hit_columns(events[n_sorted % events.size()].inputs,
+                             [&](const auto& hits) { sort(hits, order.data()); });
+            ++n_sorted;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        best = std::min(best, elapsed * 1e9 / static_cast<double>(n_sorted * n_hits));
+    }
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int32_t n_strings = argc > 1 ? std::atoi(argv[1]) : 80;
+    const int32_t n_sensors = argc > 2 ? std::atoi(argv[2]) : 80;
+    std::mt19937_64 rng(42);
+
+    std::printf("%10s %9s %12s   (ns/hit, %d x %d sensors)\n", "hits", "radix", "comparison", n_strings, n_sensors);
+    for (std::size_t n_hits : {32, 64, 96, 128, 160, 192, 256, 384, 512, 4096, 65536, 1000000}) {
+        std::vector<BenchEvent> events;
+        for (int k = 0; k < 4; ++k) {
+            events.push_back(make_event(n_hits, n_strings, n_sensors, rng));
+        }
+        const double radix = time_per_hit(events, n_hits, [](const auto& hits, std::size_t* order) {
+            radix_sort_hits(hits, order, 1, thread_arena());
+        });
+        const double comparison = time_per_hit(events, n_hits, [](const auto& hits, std::size_t* order) {
+            comparison_sort_hits(hits, order);
+        });
+        std::printf("%10zu %9.1f %12.1f%s\n", n_hits, radix, comparison,
+                    n_hits >= kRadixSortMinHits ? "   <- radix sort used" : "");
+    }
+    return 0;
+}
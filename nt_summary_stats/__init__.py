@@ -31,7 +31,8 @@ When extended=True, 16 additional statistics are computed (25 total):
 21. Charge within 2000ns of first pulse
 22. Number of pulses (pre-grouping count)
 23. Peak charge fraction (max pulse charge / total charge)
-24. Same-string neighbor hit count (HLC-style, +-2 sensor IDs, +-1000ns; 0 outside process_event)
+24. Same-string neighbor hit count (HLC-style, +-2 sensor IDs, +-1000ns by default, see NeighborRule;
+    0 outside process_event)
 25. Charge-weighted time skewness (3rd standardized moment; 0 for < 3 pulses)
 """
 
@@ -40,32 +41,63 @@ from __future__ import annotations
 import numpy as np
 
 from . import _backend
+from .accumulator import PartialStats, SensorAccumulator
+from .cleaning import HitCleaning
 from .core import compute_summary_stats as _compute_summary_stats_numpy
-from .event import process_event, process_sensor_data
+from .event import (
+    _float_column,
+    _output_dtype,
+    _time_column,
+    _write_output,
+    process_event,
+    process_event_dense,
+    process_events_batch,
+    process_events_batch_dense,
+    process_sensor_data,
+)
+from .geometry import Geometry
+from .neighbors import NeighborRule
+from .stat_plan import StatPlan, _as_plan, _compute_plan_stats_numpy
 
 native_available = _backend.native_available
 using_native_backend = _backend.using_native_backend
+set_num_threads = _backend.set_num_threads
+get_num_threads = _backend.get_num_threads
 
 __version__ = "1.1"
 
-def compute_summary_stats(times, charges, extended=False):
+def compute_summary_stats(times, charges, extended=False, out=None, plan=None, dtype=np.float64):
     """
     Compute summary statistics, preferring the native backend when available.
 
+    The native backend reads float32, float64 or int64 times and float32 or
+    float64 charges in place.
+
     Args:
         times: Array of pulse arrival times (in ns)
         charges: Array of pulse charges
         extended: If True, compute 25 statistics. If False (default), compute 9.
+        out: Optional preallocated array of shape (n_stats,) and dtype ``dtype``
+            that receives the statistics (and is returned).
+        plan: Optional StatPlan selecting the statistics, or the column names /
+            bitmask to build one with ``StatPlan.select``; overrides ``extended``.
+        dtype: Output dtype, ``np.float64`` (default) or ``np.float32``. Statistics
+            are computed in double precision either way.
 
     Returns:
-        np.ndarray of shape (9,) or (25,) containing summary statistics
+        np.ndarray of shape (9,), (25,) or (plan.n_stats,) containing summary statistics
     """
+    plan = _as_plan(plan)
+    dtype = _output_dtype(dtype)
     native = _backend.get_native_module()
     if native is not None:
-        times_arr = np.ascontiguousarray(times, dtype=np.float64)
-        charges_arr = np.ascontiguousarray(charges, dtype=np.float64)
-        return native.compute_summary_stats(times_arr, charges_arr, extended)
-    return _compute_summary_stats_numpy(times, charges, extended)
+        return native.compute_summary_stats(_time_column(times), _float_column(charges), extended, out=out,
+                                            plan=None if plan is None else plan._native, dtype=dtype)
+    if plan is not None:
+        result = _compute_plan_stats_numpy(times, charges, plan)
+    else:
+        result = _compute_summary_stats_numpy(times, charges, extended)
+    return _write_output(result.astype(dtype, copy=False), out, "out")
 
 
 def compute_summary_stats_numpy(times, charges, extended=False):
@@ -87,8 +119,19 @@ __all__ = [
     "__version__",
     "compute_summary_stats",
     "compute_summary_stats_numpy",
+    "Geometry",
+    "HitCleaning",
+    "NeighborRule",
+    "PartialStats",
+    "SensorAccumulator",
+    "StatPlan",
     "process_event",
+    "process_event_dense",
+    "process_events_batch",
+    "process_events_batch_dense",
     "process_sensor_data",
     "native_available",
     "using_native_backend",
+    "set_num_threads",
+    "get_num_threads",
 ]
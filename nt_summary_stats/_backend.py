@@ -5,6 +5,8 @@ The environment variables below control behaviour:
 
 NTSS_DISABLE_NATIVE=1  -> always use the NumPy implementation.
 NTSS_FORCE_NATIVE=1    -> raise at import time if the native module is unavailable.
+NTSS_NUM_THREADS=N     -> size of the native worker pool (default: one thread per core).
+NTSS_SIMD=ISA          -> cap the native SIMD kernels at scalar, sse2 or avx2 (default: best available).
 """
 
 from __future__ import annotations
@@ -20,6 +22,7 @@ _FORCE_NATIVE = os.environ.get("NTSS_FORCE_NATIVE", "").lower() in {"1", "true",
 
 _NATIVE_INITIALISED = False
 _NATIVE_MODULE: Optional[ModuleType] = None
+_NUM_THREADS: Optional[int] = None
 
 
 def get_native_module() -> Optional[ModuleType]:
@@ -46,6 +49,11 @@ def get_native_module() -> Optional[ModuleType]:
                 _NATIVE_MODULE = None
             else:
                 _NATIVE_MODULE = module
+                num_threads = _NUM_THREADS
+                if num_threads is None and os.environ.get("NTSS_NUM_THREADS"):
+                    num_threads = int(os.environ["NTSS_NUM_THREADS"])
+                if num_threads is not None:
+                    module.set_num_threads(num_threads)
     return _NATIVE_MODULE
 
 
@@ -59,6 +67,35 @@ def using_native_backend() -> bool:
     return native_available()
 
 
+def set_num_threads(n_threads: int) -> None:
+    """
+    Set the number of threads used by the native worker pool.
+
+    The count includes the calling thread. The pool is long-lived and shared by
+    every native entry point; it is rebuilt automatically in forked child
+    processes (e.g. PyTorch DataLoader workers). Has no effect on the NumPy
+    implementation.
+    """
+    global _NUM_THREADS
+    n_threads = int(n_threads)
+    if n_threads < 1:
+        raise ValueError("n_threads must be a positive integer")
+    _NUM_THREADS = n_threads
+    native = get_native_module()
+    if native is not None:
+        native.set_num_threads(n_threads)
+
+
+def get_num_threads() -> int:
+    """Return the number of threads used by the native worker pool."""
+    native = get_native_module()
+    if native is not None:
+        return native.get_num_threads()
+    if _NUM_THREADS is not None:
+        return _NUM_THREADS
+    return os.cpu_count() or 1
+
+
 def disable_native() -> bool:
     """Return True if native execution has been explicitly disabled."""
     return _DISABLE_NATIVE
@@ -73,6 +110,8 @@ __all__ = [
     "get_native_module",
     "native_available",
     "using_native_backend",
+    "set_num_threads",
+    "get_num_threads",
     "disable_native",
     "force_native",
 ]
@@ -0,0 +1,227 @@
+"""
+Streaming and partial per-sensor statistics.
+
+A :class:`SensorAccumulator` takes the hits of one sensor as they arrive, in
+time order, and produces the summary statistics of everything added so far on
+demand, without recomputing over the whole history. A :class:`PartialStats`
+holds the state of part of a sensor's hits (one file, readout frame or shard);
+partial states merge associatively into the state of all the hits.
+"""
+
+from typing import List, Optional, Tuple, Union
+
+import numpy as np
+from numpy.typing import DTypeLike
+
+from . import _backend
+from .core import compute_summary_stats as _compute_summary_stats_numpy
+from .event import _float_column, _output_dtype, _time_column, _write_output
+from .stat_plan import _PlanArg, _as_plan, _compute_plan_stats_numpy
+
+
+class SensorAccumulator:
+    """
+    Summary statistics of one sensor, updated as hits arrive in time order.
+
+    With the native backend each added hit updates the running sums in O(1)
+    amortized time, and :meth:`stats` gives exactly what
+    :func:`compute_summary_stats` returns for all hits added so far. The NumPy
+    fallback keeps the hits and recomputes on each call to :meth:`stats`.
+
+    The windows and quantiles of a snapshot are looked up among all hits, so
+    the accumulator keeps each hit's time and running charge: its memory grows
+    by 16 bytes per hit (the fallback keeps times and charges, also 16) for as
+    long as it lives. Call :meth:`reset` between readouts of a long stream to
+    release it.
+
+    Args:
+        extended: If True, compute 25 statistics. If False (default), compute 9.
+        plan: Optional :class:`StatPlan` selecting the statistics, or the column
+            names / bitmask to build one with :meth:`StatPlan.select`; overrides ``extended``.
+    """
+
+    def __init__(self, extended: bool = False, plan: Optional[_PlanArg] = None):
+        self._extended = extended
+        self._plan = _as_plan(plan)
+        native = _backend.get_native_module()
+        self._native = None if native is None else native.SensorAccumulator(
+            extended, plan=None if self._plan is None else self._plan._native
+        )
+        self._times: List[np.ndarray] = []
+        self._charges: List[np.ndarray] = []
+        self._last_time = -np.inf
+
+    def add(self, times: Union[np.ndarray, list, float],
+            charges: Optional[Union[np.ndarray, list, float]] = None) -> None:
+        """
+        Append hits. Times must be ascending and must not precede the last hit
+        added; charges default to 1.0. The native backend reads float32, float64
+        or int64 times and float32 or float64 charges in place.
+        """
+        times_arr = _time_column(np.atleast_1d(times))
+        charges_arr = None if charges is None else _float_column(np.atleast_1d(charges))
+        if self._native is not None:
+            self._native.add(times_arr, charges_arr)
+            return
+
+        times_arr = times_arr.astype(np.float64, copy=False)
+        charges_arr = None if charges_arr is None else charges_arr.astype(np.float64, copy=False)
+        if times_arr.ndim != 1:
+            raise ValueError("times must be a 1D array")
+        if charges_arr is None:
+            charges_arr = np.ones_like(times_arr)
+        elif charges_arr.ndim != 1 or len(charges_arr) != len(times_arr):
+            raise ValueError("charges must be 1D and match times length")
+        if len(times_arr) == 0:
+            return
+        if np.any(np.diff(times_arr) < 0) or times_arr[0] < self._last_time:
+            raise ValueError("hits must be added in time order")
+        self._times.append(times_arr.copy())
+        self._charges.append(charges_arr.copy())
+        self._last_time = times_arr[-1]
+
+    def stats(self, out: Optional[np.ndarray] = None, dtype: DTypeLike = np.float64) -> np.ndarray:
+        """
+        Statistics of all hits added so far, shape (9,), (25,) or (plan.n_stats,),
+        of dtype ``dtype`` (float64 default, or float32). ``out`` may be a
+        preallocated array of that shape and dtype.
+        """
+        dtype = _output_dtype(dtype)
+        if self._native is not None:
+            return self._native.stats(out=out, dtype=dtype)
+        times, charges = self._hits()
+        if self._plan is not None:
+            result = _compute_plan_stats_numpy(times, charges, self._plan)
+        else:
+            result = _compute_summary_stats_numpy(times, charges, self._extended)
+        return _write_output(result.astype(dtype, copy=False), out, "out")
+
+    def reset(self) -> None:
+        """Drop all hits added so far and release the memory they held."""
+        if self._native is not None:
+            self._native.reset()
+        self._times = []
+        self._charges = []
+        self._last_time = -np.inf
+
+    @property
+    def n_hits(self) -> int:
+        if self._native is not None:
+            return self._native.n_hits
+        return sum(len(t) for t in self._times)
+
+    @property
+    def n_stats(self) -> int:
+        if self._plan is not None:
+            return self._plan.n_stats
+        return 25 if self._extended else 9
+
+    def _hits(self) -> Tuple[np.ndarray, np.ndarray]:
+        if not self._times:
+            return np.empty(0), np.empty(0)
+        return np.concatenate(self._times), np.concatenate(self._charges)
+
+
+class PartialStats:
+    """
+    Mergeable statistics state of part of one sensor's hits.
+
+    The state keeps the part's hits in time order. :meth:`merge` combines two
+    states; merging the states of the parts of a split hit array, in order and
+    with any bracketing, gives the state of the whole array, and :meth:`stats`
+    then returns what :func:`compute_summary_stats` returns for the whole array
+    (hits with equal times are taken in part order). States pickle, so they can
+    be produced on one worker and merged on another.
+
+    The state is O(n) in the part's hits: 16 bytes per hit, or 8 when the part
+    was built without charges (unit charges are not stored). A merge is a
+    linear merge of two time-ordered runs, O(n_a + n_b) in time and in the size
+    of the new state, and :meth:`stats` is one O(n) pass. The windows and
+    quantiles are measured from the first pulse of the whole sensor, so no
+    fixed-size summary of a part can stand in for its hits.
+
+    Args:
+        times: Hit times, in any order (float32, float64 or int64 are read in place)
+        charges: Hit charges (optional, defaults to 1.0)
+    """
+
+    def __init__(self, times: Union[np.ndarray, list] = (),
+                 charges: Optional[Union[np.ndarray, list]] = None):
+        times_arr = _time_column(times)
+        charges_arr = None if charges is None else _float_column(charges)
+        native = _backend.get_native_module()
+        if native is not None:
+            self._native = native.PartialStats(times_arr, charges_arr)
+            return
+
+        self._native = None
+        times_arr = times_arr.astype(np.float64, copy=False)
+        charges_arr = None if charges_arr is None else charges_arr.astype(np.float64, copy=False)
+        if times_arr.ndim != 1:
+            raise ValueError("times must be a 1D array")
+        if charges_arr is not None and (charges_arr.ndim != 1 or len(charges_arr) != len(times_arr)):
+            raise ValueError("charges must be 1D and match times length")
+        order = np.argsort(times_arr, kind="stable")
+        self._times = times_arr[order]
+        # None for unit charges, which are not stored.
+        self._charges = None if charges_arr is None else charges_arr[order]
+
+    def merge(self, other: "PartialStats") -> "PartialStats":
+        """The state of this part's hits followed by ``other``'s."""
+        merged = PartialStats.__new__(PartialStats)
+        if self._native is not None:
+            merged._native = self._native.merge(other._native)
+            return merged
+        merged._native = None
+        times = np.concatenate([self._times, other._times])
+        order = np.argsort(times, kind="stable")
+        merged._times = times[order]
+        if self._charges is None and other._charges is None:
+            merged._charges = None
+        else:
+            merged._charges = np.concatenate([self.charges, other.charges])[order]
+        return merged
+
+    def stats(self, extended: bool = False, out: Optional[np.ndarray] = None,
+              plan: Optional[_PlanArg] = None, dtype: DTypeLike = np.float64) -> np.ndarray:
+        """
+        Statistics of the hits of this state, shape (9,), (25,) or (plan.n_stats,),
+        of dtype ``dtype`` (float64 default, or float32).
+        """
+        plan = _as_plan(plan)
+        dtype = _output_dtype(dtype)
+        if self._native is not None:
+            return self._native.stats(extended, out=out, plan=None if plan is None else plan._native, dtype=dtype)
+        charges = self.charges
+        if plan is not None:
+            result = _compute_plan_stats_numpy(self._times, charges, plan)
+        else:
+            result = _compute_summary_stats_numpy(self._times, charges, extended)
+        return _write_output(result.astype(dtype, copy=False), out, "out")
+
+    @property
+    def n_hits(self) -> int:
+        return self._native.n_hits if self._native is not None else len(self._times)
+
+    @property
+    def times(self) -> np.ndarray:
+        """Hit times, in time order."""
+        return self._native.times if self._native is not None else self._times
+
+    @property
+    def charges(self) -> np.ndarray:
+        """Hit charges, in time order (ones for a state without charges)."""
+        if self._native is not None:
+            return self._native.charges
+        return np.ones_like(self._times) if self._charges is None else self._charges
+
+    @property
+    def unit_charges(self) -> bool:
+        """Whether the state was built without charges, which it then does not store."""
+        return self._native.unit_charges if self._native is not None else self._charges is None
+
+    def __len__(self) -> int:
+        return self.n_hits
+
+    def __reduce__(self):
+        return (PartialStats, (self.times, None if self.unit_charges else self.charges))
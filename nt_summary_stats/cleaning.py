@@ -0,0 +1,114 @@
+"""
+Noise cleaning of event hits.
+
+A :class:`HitCleaning` selects the hits of an event that enter the statistics
+of the event entry points, dropping noise ahead of them: seeded RT cleaning
+grows the HLC hits into the hits causally connected to them, and time-window
+cleaning keeps the hits in the densest window of the event.
+"""
+
+from typing import List, Optional
+
+import numpy as np
+
+from . import _backend
+
+
+class HitCleaning:
+    """
+    Noise cleaning applied to an event's hits before the statistics.
+
+    Seeded RT cleaning (``srt_radius``) starts from the HLC hits of the
+    event's :class:`NeighborRule` and adds, round by round, every hit within
+    ``srt_time_ns`` of an already kept hit on a sensor at most ``srt_radius``
+    away (its own sensor included). It stops when a round adds nothing or after
+    ``srt_iterations`` rounds. Time-window cleaning (``time_window_ns``) then
+    keeps only the hits in the ``time_window_ns`` window holding most of the
+    remaining hits, the earliest such window on ties. Either stage may be left
+    off; sensors left without hits get no row.
+
+    Args:
+        time_window_ns: Optional width of the time window in ns, > 0
+        srt_radius: Optional RT radius in position units, > 0; enables seeded RT cleaning
+        srt_time_ns: RT time window in ns (inclusive), >= 0
+        srt_iterations: Optional largest number of RT rounds, >= 1 (default: until no change)
+    """
+
+    def __init__(self, time_window_ns: Optional[float] = None, srt_radius: Optional[float] = None,
+                 srt_time_ns: float = 1000.0, srt_iterations: Optional[int] = None):
+        time_window_ns = None if time_window_ns is None else float(time_window_ns)
+        srt_radius = None if srt_radius is None else float(srt_radius)
+        srt_time_ns = float(srt_time_ns)
+        srt_iterations = None if srt_iterations is None else int(srt_iterations)
+        if time_window_ns is not None and not (np.isfinite(time_window_ns) and time_window_ns > 0):
+            raise ValueError("time_window_ns must be finite and positive")
+        if srt_radius is not None and not (np.isfinite(srt_radius) and srt_radius > 0):
+            raise ValueError("srt_radius must be finite and positive")
+        if not np.isfinite(srt_time_ns) or srt_time_ns < 0:
+            raise ValueError("srt_time_ns must be finite and non-negative")
+        if srt_iterations is not None and srt_iterations < 1:
+            raise ValueError("srt_iterations must be at least 1")
+
+        self.time_window_ns = time_window_ns
+        self.srt_radius = srt_radius
+        self.srt_time_ns = srt_time_ns
+        self.srt_iterations = srt_iterations
+
+        native = _backend.get_native_module()
+        self._native = None if native is None else native.HitCleaning(
+            time_window_ns, srt_radius, srt_time_ns, srt_iterations
+        )
+
+    def __repr__(self) -> str:
+        return (f"HitCleaning(time_window_ns={self.time_window_ns}, srt_radius={self.srt_radius}, "
+                f"srt_time_ns={self.srt_time_ns}, srt_iterations={self.srt_iterations})")
+
+    def __reduce__(self):
+        return (HitCleaning, (self.time_window_ns, self.srt_radius, self.srt_time_ns, self.srt_iterations))
+
+
+def _clean_hits_numpy(cleaning: HitCleaning, times: np.ndarray, positions: np.ndarray,
+                      sensor_hits: List[np.ndarray], seeds: Optional[np.ndarray]) -> np.ndarray:
+    """
+    The hits of an event kept by ``cleaning``, as a boolean mask in input order.
+
+    Args:
+        cleaning: The cleaning stages
+        times: Hit times, shape (N,)
+        positions: Sensor positions, shape (N_sensors, 3)
+        sensor_hits: Hit indices of each sensor
+        seeds: HLC flags of the hits, shape (N,); needed for seeded RT cleaning
+    """
+    keep = np.ones(len(times), dtype=bool)
+    if cleaning.srt_radius is not None:
+        keep = np.asarray(seeds, dtype=bool).copy()
+        rounds = 0
+        while cleaning.srt_iterations is None or rounds < cleaning.srt_iterations:
+            # Each round reads the hits kept by the previous one only.
+            grown = keep.copy()
+            kept_times = [np.sort(times[hits[keep[hits]]]) for hits in sensor_hits]
+            for i, hits in enumerate(sensor_hits):
+                delta = positions - positions[i]
+                near = np.flatnonzero(np.einsum("ij,ij->i", delta, delta)
+                                      <= cleaning.srt_radius * cleaning.srt_radius)
+                candidates = np.sort(np.concatenate([kept_times[j] for j in near]))
+                if len(candidates) == 0:
+                    continue
+                t = times[hits]
+                k = np.searchsorted(candidates, t - cleaning.srt_time_ns, side="left")
+                inside = k < len(candidates)
+                matched = np.zeros(len(hits), dtype=bool)
+                matched[inside] = candidates[k[inside]] <= t[inside] + cleaning.srt_time_ns
+                grown[hits[matched]] = True
+            rounds += 1
+            if np.array_equal(grown, keep):
+                break
+            keep = grown
+
+    if cleaning.time_window_ns is not None:
+        kept_times = np.sort(times[keep & ~np.isnan(times)])
+        if len(kept_times):
+            ends = np.searchsorted(kept_times, kept_times + cleaning.time_window_ns, side="right")
+            first = kept_times[np.argmax(ends - np.arange(len(kept_times)))]
+            keep &= (times >= first) & (times <= first + cleaning.time_window_ns)
+    return keep
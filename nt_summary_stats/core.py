@@ -125,20 +125,27 @@ def compute_summary_stats(times: Union[np.ndarray, list],
     # Optimized charge calculations - reuse cumulative sum
     cumulative_charge = np.cumsum(charges_sorted)
 
+    def charge_until(idx):
+        # A window covering every hit reports total_charge itself, not the
+        # (differently rounded) last element of the cumulative sum.
+        if idx == n_times:
+            return total_charge
+        return cumulative_charge[idx - 1] if idx > 0 else 0.0
+
     if extended:
         idx_10ns, idx_20ns, idx_50ns, idx_100ns, idx_200ns, idx_500ns, idx_1000ns, idx_2000ns = time_indices
-        charge_10ns = cumulative_charge[idx_10ns - 1] if idx_10ns > 0 else 0.0
-        charge_20ns = cumulative_charge[idx_20ns - 1] if idx_20ns > 0 else 0.0
-        charge_50ns = cumulative_charge[idx_50ns - 1] if idx_50ns > 0 else 0.0
-        charge_100ns = cumulative_charge[idx_100ns - 1] if idx_100ns > 0 else 0.0
-        charge_200ns = cumulative_charge[idx_200ns - 1] if idx_200ns > 0 else 0.0
-        charge_500ns = cumulative_charge[idx_500ns - 1] if idx_500ns > 0 else 0.0
-        charge_1000ns = cumulative_charge[idx_1000ns - 1] if idx_1000ns > 0 else 0.0
-        charge_2000ns = cumulative_charge[idx_2000ns - 1] if idx_2000ns > 0 else 0.0
+        charge_10ns = charge_until(idx_10ns)
+        charge_20ns = charge_until(idx_20ns)
+        charge_50ns = charge_until(idx_50ns)
+        charge_100ns = charge_until(idx_100ns)
+        charge_200ns = charge_until(idx_200ns)
+        charge_500ns = charge_until(idx_500ns)
+        charge_1000ns = charge_until(idx_1000ns)
+        charge_2000ns = charge_until(idx_2000ns)
     else:
         idx_100ns, idx_500ns = time_indices[0], time_indices[1]
-        charge_100ns = cumulative_charge[idx_100ns - 1] if idx_100ns > 0 else 0.0
-        charge_500ns = cumulative_charge[idx_500ns - 1] if idx_500ns > 0 else 0.0
+        charge_100ns = charge_until(idx_100ns)
+        charge_500ns = charge_until(idx_500ns)
     
     # Efficient percentile calculations using existing cumulative sum
     if extended:
@@ -8,9 +8,14 @@ summary statistics using either the native extension or the NumPy fallback.
 from typing import Any, Dict, Optional, Tuple, Union
 
 import numpy as np
+from numpy.typing import DTypeLike
 
 from . import _backend
 from .core import compute_summary_stats as _compute_summary_stats_numpy
+from .cleaning import HitCleaning, _clean_hits_numpy
+from .geometry import Geometry, _int32_ids
+from .neighbors import NeighborRule, _neighbor_scan_numpy
+from .stat_plan import StatPlan, _PlanArg, _as_plan, _compute_plan_stats_numpy
 
 
 def process_sensor_data(
@@ -18,6 +23,9 @@ def process_sensor_data(
     sensor_charges: Optional[Union[np.ndarray, list]] = None,
     grouping_window_ns: Optional[float] = None,
     extended: bool = False,
+    out: Optional[np.ndarray] = None,
+    plan: Optional[_PlanArg] = None,
+    dtype: DTypeLike = np.float64,
 ) -> np.ndarray:
     """
     Process sensor data with optional time-based grouping.
@@ -25,25 +33,35 @@ def process_sensor_data(
     This function processes timing data from a single sensor, optionally grouping
     hits within a time window before computing summary statistics. When the
     compiled extension is available it is used automatically; otherwise, the
-    NumPy implementation is used.
+    NumPy implementation is used. The native backend reads float32, float64 or
+    int64 times and float32 or float64 charges in place.
 
     Args:
         sensor_times: Hit times for the sensor
         sensor_charges: Hit charges (optional, defaults to 1.0)
         grouping_window_ns: Time window for grouping hits (default: None, no grouping)
         extended: If True, compute 25 statistics. If False (default), compute 9.
+        out: Optional preallocated array of shape (n_stats,) and dtype ``dtype``
+            that receives the statistics (and is returned).
+        plan: Optional :class:`StatPlan` selecting the statistics, or the column
+            names / bitmask to build one with :meth:`StatPlan.select`; overrides ``extended``.
+        dtype: Output dtype, ``np.float64`` (default) or ``np.float32``. Statistics
+            are computed in double precision either way.
 
     Returns:
-        np.ndarray of shape (9,) or (25,) containing summary statistics
+        np.ndarray of shape (9,), (25,) or (plan.n_stats,) containing summary statistics
     """
+    plan = _as_plan(plan)
+    dtype = _output_dtype(dtype)
     native = _backend.get_native_module()
     if native is not None:
-        times_arr = np.ascontiguousarray(sensor_times, dtype=np.float64)
-        charges_arr = (None if sensor_charges is None
-                       else np.ascontiguousarray(sensor_charges, dtype=np.float64))
-        return native.process_sensor_data(times_arr, charges_arr, grouping_window_ns, extended)
+        times_arr = _time_column(sensor_times)
+        charges_arr = None if sensor_charges is None else _float_column(sensor_charges)
+        return native.process_sensor_data(times_arr, charges_arr, grouping_window_ns, extended, out=out,
+                                          plan=None if plan is None else plan._native, dtype=dtype)
 
-    return _process_sensor_data_numpy(sensor_times, sensor_charges, grouping_window_ns, extended)
+    result = _process_sensor_data_numpy(sensor_times, sensor_charges, grouping_window_ns, extended, plan)
+    return _write_output(result.astype(dtype, copy=False), out, "out")
 
 
 def _process_sensor_data_numpy(
@@ -51,8 +69,15 @@ def _process_sensor_data_numpy(
     sensor_charges: Optional[Union[np.ndarray, list]] = None,
     grouping_window_ns: Optional[float] = None,
     extended: bool = False,
+    plan: Optional[StatPlan] = None,
 ) -> np.ndarray:
     sensor_times = np.asarray(sensor_times, dtype=np.float64)
+    n_pulses_column, _ = _special_columns(plan, extended)
+
+    def compute(times, charges):
+        if plan is not None:
+            return _compute_plan_stats_numpy(times, charges, plan)
+        return _compute_summary_stats_numpy(times, charges, extended)
 
     if sensor_charges is None:
         sensor_charges = np.ones_like(sensor_times, dtype=np.float64)
@@ -60,90 +85,604 @@ def _process_sensor_data_numpy(
         sensor_charges = np.asarray(sensor_charges, dtype=np.float64)
 
     if len(sensor_times) == 0:
-        return _compute_summary_stats_numpy([], [], extended)
+        return compute([], [])
 
     if grouping_window_ns is not None and grouping_window_ns > 0:
         pre_grouping_n = float(len(sensor_times))
         grouped_times, grouped_charges = _group_hits_by_window(
             sensor_times, sensor_charges, grouping_window_ns
         )
-        result = _compute_summary_stats_numpy(grouped_times, grouped_charges, extended)
+        result = compute(grouped_times, grouped_charges)
         # Override n_pulses with pre-grouping count
-        if extended:
-            result[21] = pre_grouping_n
+        if n_pulses_column is not None:
+            result[n_pulses_column] = pre_grouping_n
         return result
     else:
         grouped_times = sensor_times
         grouped_charges = sensor_charges
 
-    return _compute_summary_stats_numpy(grouped_times, grouped_charges, extended)
+    return compute(grouped_times, grouped_charges)
+
+
+def _special_columns(plan: Optional[StatPlan], extended: bool) -> Tuple[Optional[int], Optional[int]]:
+    """Output columns of n_pulses and n_string_neighbors, None where absent."""
+    if plan is None:
+        return (21, 23) if extended else (None, None)
+    return plan._column_index("n_pulses"), plan._column_index("n_string_neighbors")
+
+
+def _num_stats(plan: Optional[StatPlan], extended: bool) -> int:
+    return plan.n_stats if plan is not None else (25 if extended else 9)
 
 
 def process_event(
     event_data: Dict[str, Any],
     grouping_window_ns: Optional[float] = None,
     extended: bool = False,
-) -> Tuple[np.ndarray, np.ndarray]:
+    n_threads: Optional[int] = None,
+    out: Optional[np.ndarray] = None,
+    out_positions: Optional[np.ndarray] = None,
+    geometry: Optional[Geometry] = None,
+    plan: Optional[_PlanArg] = None,
+    dtype: DTypeLike = np.float64,
+    neighbor_rule: Optional[NeighborRule] = None,
+    return_hlc_flags: bool = False,
+    hlc_only: bool = False,
+    cleaning: Optional[HitCleaning] = None,
+    per_pmt: bool = False,
+) -> Tuple[np.ndarray, ...]:
     """
     Process a detector event to extract sensor positions and summary statistics.
 
     The input must be a mapping that either contains a ``"photons"`` dictionary
     with the required fields or directly exposes the photon-level fields
     ``sensor_pos_x``, ``sensor_pos_y``, ``sensor_pos_z``, ``string_id``,
-    ``sensor_id``, ``t``, and optionally ``charge``. When the native extension is
+    ``sensor_id``, ``t``, and optionally ``charge``. With a ``geometry`` the
+    ``sensor_pos_*`` fields are not needed. When the native extension is
     available it is used automatically; otherwise the NumPy implementation is invoked.
+    The native backend reads float32 or float64 times, charges and positions,
+    int64 times and int16, int32 or int64 IDs in place; other dtypes are
+    converted first.
 
     Args:
         event_data: Event dictionary with required photon fields
         grouping_window_ns: Time window for grouping hits (default: None, no grouping)
         extended: If True, compute 25 statistics per sensor. If False (default), compute 9.
+        n_threads: Number of threads the native backend may use for the per-sensor
+            work (default: None, the pool size set by ``set_num_threads``). Small
+            events always run on the calling thread. Ignored by the NumPy implementation.
+        out: Optional preallocated array of shape (M, 9) or (M, 25) with
+            M >= N_sensors and dtype ``dtype``. Statistics are written into its leading rows.
+        out_positions: Optional preallocated array of shape (M, 3) with
+            M >= N_sensors and dtype ``dtype`` that receives the sensor positions.
+        geometry: Optional :class:`Geometry` supplying sensor positions. Every
+            hit sensor must be part of it.
+        plan: Optional :class:`StatPlan` selecting the statistic columns, or the
+            column names / bitmask to build one with :meth:`StatPlan.select`;
+            overrides ``extended``.
+        dtype: Output dtype, ``np.float64`` (default) or ``np.float32``. Statistics
+            are computed in double precision either way.
+        neighbor_rule: Optional :class:`NeighborRule` defining the
+            ``n_string_neighbors`` column and the HLC hits (default: same string,
+            +-2 sensor IDs, +-1000 ns).
+        return_hlc_flags: If True, also return the HLC flag of every hit: a uint8
+            array of shape (N_hits,) in input order, 1 for hits in coincidence
+            with hits on at least ``neighbor_rule.multiplicity`` neighbor sensors.
+            The flags come from the same pass as the neighbor counts.
+        hlc_only: If True, compute the statistics over the HLC hits only; sensors
+            without one get no row.
+        cleaning: Optional :class:`HitCleaning` dropping noise hits (seeded RT,
+            then time-window cleaning) before the statistics; sensors left without
+            hits get no row. When hits are dropped, by this or by ``hlc_only``,
+            ``n_string_neighbors`` counts over the kept hits; the HLC flags are
+            always those of all hits.
+        per_pmt: If True, the sensors are multi-PMT modules and the photon field
+            ``pmt_id`` gives the PMT of each hit. Statistics are then also
+            returned per (string_id, sensor_id, pmt_id), from the same sort as
+            the module rows, which are unchanged. PMT rows take the position of
+            their earliest hit (the module position with a ``geometry``) and
+            their module's ``n_string_neighbors``.
 
     Returns:
-        Tuple of (sensor_positions, sensor_stats) where:
+        Tuple of (sensor_positions, sensor_stats), plus (pmt_positions, pmt_stats,
+        pmt_offsets) with ``per_pmt`` and hlc_flags with ``return_hlc_flags``, where:
         - sensor_positions: np.ndarray of shape (N_sensors, 3)
         - sensor_stats: np.ndarray of shape (N_sensors, 9) or (N_sensors, 25)
+        - pmt_positions: np.ndarray of shape (N_pmts, 3), rows in
+          (string_id, sensor_id, pmt_id) order
+        - pmt_stats: np.ndarray of shape (N_pmts, 9) or (N_pmts, 25)
+        - pmt_offsets: np.ndarray of shape (N_sensors + 1,), dtype int64; the PMT
+          rows of sensor i are pmt_offsets[i]:pmt_offsets[i + 1]
+        - hlc_flags: np.ndarray of shape (N_hits,), dtype uint8
+        When ``out`` / ``out_positions`` are given, the returned arrays are views
+        of their first N_sensors rows.
     """
-    photons = _extract_photons_data(event_data)
-
-    sensor_pos_x = np.ascontiguousarray(photons['sensor_pos_x'], dtype=np.float64)
-    sensor_pos_y = np.ascontiguousarray(photons['sensor_pos_y'], dtype=np.float64)
-    sensor_pos_z = np.ascontiguousarray(photons['sensor_pos_z'], dtype=np.float64)
-    string_ids = np.ascontiguousarray(photons['string_id'], dtype=np.int32)
-    sensor_ids = np.ascontiguousarray(photons['sensor_id'], dtype=np.int32)
-    times = np.ascontiguousarray(photons['t'], dtype=np.float64)
+    plan = _as_plan(plan)
+    dtype = _output_dtype(dtype)
+    photons = _extract_photons_data(event_data, require_positions=geometry is None)
+
+    string_ids, sensor_ids = _id_columns(photons['string_id'], photons['sensor_id'])
+    times = _time_column(photons['t'])
     charges = photons.get('charge')
-    charges_arr = None if charges is None else np.ascontiguousarray(charges, dtype=np.float64)
+    charges_arr = None if charges is None else _float_column(charges)
+    pmt_ids = _pmt_column(photons) if per_pmt else None
+
+    native = _backend.get_native_module()
+    native_plan = None if plan is None or native is None else plan._native
+    native_rule = None if neighbor_rule is None or native is None else neighbor_rule._native
+    native_cleaning = None if cleaning is None or native is None else cleaning._native
+    if native is not None and geometry is not None:
+        return native.process_event_geometry(
+            geometry._native,
+            string_ids,
+            sensor_ids,
+            times,
+            charges=charges_arr,
+            grouping_window_ns=grouping_window_ns,
+            n_threads=n_threads,
+            extended=extended,
+            out=out,
+            out_positions=out_positions,
+            plan=native_plan,
+            dtype=dtype,
+            neighbor_rule=native_rule,
+            return_hlc_flags=return_hlc_flags,
+            hlc_only=hlc_only,
+            cleaning=native_cleaning,
+            pmt_ids=pmt_ids,
+        )
+
+    sensor_pos_x, sensor_pos_y, sensor_pos_z = _hit_positions(photons, geometry, string_ids, sensor_ids)
+    if native is not None:
+        return native.process_event_arrays(
+            string_ids,
+            sensor_ids,
+            times,
+            sensor_pos_x,
+            sensor_pos_y,
+            sensor_pos_z,
+            charges=charges_arr,
+            grouping_window_ns=grouping_window_ns,
+            n_threads=n_threads,
+            extended=extended,
+            out=out,
+            out_positions=out_positions,
+            plan=native_plan,
+            dtype=dtype,
+            neighbor_rule=native_rule,
+            return_hlc_flags=return_hlc_flags,
+            hlc_only=hlc_only,
+            cleaning=native_cleaning,
+            pmt_ids=pmt_ids,
+        )
 
-    n_stats = 25 if extended else 9
+    n_stats = _num_stats(plan, extended)
+    hit_flags = np.zeros(0, dtype=np.uint8)
+    pmt_tables = (np.empty((0, 3)), np.empty((0, n_stats)), np.zeros(0, dtype=np.int64))
     if len(times) == 0:
-        return np.empty((0, 3), dtype=np.float64), np.empty((0, n_stats), dtype=np.float64)
+        positions = np.empty((0, 3), dtype=np.float64)
+        stats = np.empty((0, n_stats), dtype=np.float64)
+    else:
+        positions, stats, hit_flags, pmt_tables, _ = _process_event_arrays_numpy(
+            sensor_pos_x,
+            sensor_pos_y,
+            sensor_pos_z,
+            string_ids,
+            sensor_ids,
+            times,
+            charges_arr,
+            grouping_window_ns,
+            extended,
+            plan,
+            neighbor_rule,
+            return_hlc_flags,
+            hlc_only,
+            cleaning,
+            pmt_ids,
+        )
+    result = (_write_output(positions.astype(dtype, copy=False), out_positions, "out_positions"),
+              _write_output(stats.astype(dtype, copy=False), out, "out"))
+    if per_pmt:
+        pmt_positions, pmt_stats, pmts_per_sensor = pmt_tables
+        pmt_offsets = np.concatenate(([0], np.cumsum(pmts_per_sensor))).astype(np.int64)
+        result += (pmt_positions.astype(dtype), pmt_stats.astype(dtype), pmt_offsets)
+    return result + (hit_flags,) if return_hlc_flags else result
+
+
+def process_events_batch(
+    event_data: Dict[str, Any],
+    event_offsets: Union[np.ndarray, list],
+    grouping_window_ns: Optional[float] = None,
+    extended: bool = False,
+    n_threads: Optional[int] = None,
+    out: Optional[np.ndarray] = None,
+    out_positions: Optional[np.ndarray] = None,
+    geometry: Optional[Geometry] = None,
+    plan: Optional[_PlanArg] = None,
+    dtype: DTypeLike = np.float64,
+    neighbor_rule: Optional[NeighborRule] = None,
+    return_hlc_flags: bool = False,
+    hlc_only: bool = False,
+    cleaning: Optional[HitCleaning] = None,
+    per_pmt: bool = False,
+) -> Tuple[np.ndarray, ...]:
+    """
+    Process many events stored as flat, concatenated photon-level columns.
+
+    ``event_data`` holds the same fields as for :func:`process_event`, but each
+    column contains the hits of all events back to back. Event ``i`` owns hits
+    ``event_offsets[i]:event_offsets[i + 1]`` (CSR layout), so ``event_offsets``
+    has length ``n_events + 1``, starts at 0 and ends at the total hit count.
+    The native backend processes all events with the GIL released and in
+    parallel across events.
+
+    Args:
+        event_data: Dictionary with flat photon fields for the whole batch
+        event_offsets: Hit offsets delimiting the events, shape (n_events + 1,)
+        grouping_window_ns: Time window for grouping hits (default: None, no grouping)
+        extended: If True, compute 25 statistics per sensor. If False (default), compute 9.
+        n_threads: Number of threads the native backend may use (default: None,
+            the pool size set by ``set_num_threads``). Ignored by the NumPy implementation.
+        out: Optional preallocated array of shape (M, 9) or (M, 25) with
+            M >= N_sensors_total and dtype ``dtype`` that receives the statistics.
+        out_positions: Optional preallocated array of shape (M, 3) with
+            M >= N_sensors_total and dtype ``dtype`` that receives the sensor positions.
+        geometry: Optional :class:`Geometry` supplying sensor positions, as for
+            :func:`process_event`.
+        plan: Optional :class:`StatPlan` selecting the statistic columns, as for
+            :func:`process_event`.
+        dtype: Output dtype, ``np.float64`` (default) or ``np.float32``, as for
+            :func:`process_event`.
+        neighbor_rule: Optional :class:`NeighborRule`, as for :func:`process_event`.
+        return_hlc_flags: If True, also return the HLC flags of all hits, shape
+            (N_hits_total,), as for :func:`process_event`.
+        hlc_only: Compute the statistics over the HLC hits only, as for
+            :func:`process_event`.
+        cleaning: Optional :class:`HitCleaning`, as for :func:`process_event`.
+        per_pmt: Also compute per-PMT statistics from the ``pmt_id`` field, as
+            for :func:`process_event`.
+
+    Returns:
+        Tuple of (sensor_positions, sensor_stats, sensor_offsets), plus
+        (pmt_positions, pmt_stats, pmt_offsets) with ``per_pmt`` and hlc_flags
+        with ``return_hlc_flags``, where:
+        - sensor_positions: np.ndarray of shape (N_sensors_total, 3)
+        - sensor_stats: np.ndarray of shape (N_sensors_total, 9) or (N_sensors_total, 25)
+        - sensor_offsets: np.ndarray of shape (n_events + 1,), dtype int64; the rows
+          of event i are sensor_offsets[i]:sensor_offsets[i + 1]
+        - pmt_positions, pmt_stats: the PMT rows of all events, as for :func:`process_event`
+        - pmt_offsets: np.ndarray of shape (N_sensors_total + 1,), dtype int64; the
+          PMT rows of sensor row i are pmt_offsets[i]:pmt_offsets[i + 1]
+        - hlc_flags: np.ndarray of shape (N_hits_total,), dtype uint8
+    """
+    plan = _as_plan(plan)
+    dtype = _output_dtype(dtype)
+    photons = _extract_photons_data(event_data, require_positions=geometry is None)
+
+    string_ids, sensor_ids = _id_columns(photons['string_id'], photons['sensor_id'])
+    times = _time_column(photons['t'])
+    charges = photons.get('charge')
+    charges_arr = None if charges is None else _float_column(charges)
+    pmt_ids = _pmt_column(photons) if per_pmt else None
+    offsets = np.ascontiguousarray(event_offsets, dtype=np.int64)
 
     native = _backend.get_native_module()
+    native_plan = None if plan is None or native is None else plan._native
+    native_rule = None if neighbor_rule is None or native is None else neighbor_rule._native
+    native_cleaning = None if cleaning is None or native is None else cleaning._native
+    if native is not None and geometry is not None:
+        return native.process_events_batch_geometry(
+            geometry._native,
+            string_ids,
+            sensor_ids,
+            times,
+            offsets,
+            charges=charges_arr,
+            grouping_window_ns=grouping_window_ns,
+            n_threads=n_threads,
+            extended=extended,
+            out=out,
+            out_positions=out_positions,
+            plan=native_plan,
+            dtype=dtype,
+            neighbor_rule=native_rule,
+            return_hlc_flags=return_hlc_flags,
+            hlc_only=hlc_only,
+            cleaning=native_cleaning,
+            pmt_ids=pmt_ids,
+        )
+
+    sensor_pos_x, sensor_pos_y, sensor_pos_z = _hit_positions(photons, geometry, string_ids, sensor_ids)
     if native is not None:
-        return native.process_event_arrays(
+        return native.process_events_batch(
             string_ids,
             sensor_ids,
             times,
             sensor_pos_x,
             sensor_pos_y,
             sensor_pos_z,
+            offsets,
+            charges=charges_arr,
+            grouping_window_ns=grouping_window_ns,
+            n_threads=n_threads,
+            extended=extended,
+            out=out,
+            out_positions=out_positions,
+            plan=native_plan,
+            dtype=dtype,
+            neighbor_rule=native_rule,
+            return_hlc_flags=return_hlc_flags,
+            hlc_only=hlc_only,
+            cleaning=native_cleaning,
+            pmt_ids=pmt_ids,
+        )
+
+    if offsets.ndim != 1 or len(offsets) < 1 or offsets[0] != 0 or offsets[-1] != len(times):
+        raise ValueError("event_offsets must start at 0 and end at the number of hits")
+    if np.any(np.diff(offsets) < 0):
+        raise ValueError("event_offsets must be non-decreasing")
+
+    n_stats = _num_stats(plan, extended)
+    positions_list = []
+    stats_list = []
+    sensor_offsets = np.zeros(len(offsets), dtype=np.int64)
+    hit_flags = np.zeros(len(times), dtype=np.uint8)
+    pmt_positions_list = []
+    pmt_stats_list = []
+    pmts_per_sensor_list = []
+    for i in range(len(offsets) - 1):
+        start, end = offsets[i], offsets[i + 1]
+        if end > start:
+            positions, stats, event_flags, pmt_tables, _ = _process_event_arrays_numpy(
+                sensor_pos_x[start:end],
+                sensor_pos_y[start:end],
+                sensor_pos_z[start:end],
+                string_ids[start:end],
+                sensor_ids[start:end],
+                times[start:end],
+                None if charges_arr is None else charges_arr[start:end],
+                grouping_window_ns,
+                extended,
+                plan,
+                neighbor_rule,
+                return_hlc_flags,
+                hlc_only,
+                cleaning,
+                None if pmt_ids is None else pmt_ids[start:end],
+            )
+            if event_flags is not None:
+                hit_flags[start:end] = event_flags
+            if pmt_tables is not None:
+                pmt_positions_list.append(pmt_tables[0])
+                pmt_stats_list.append(pmt_tables[1])
+                pmts_per_sensor_list.append(pmt_tables[2])
+            positions_list.append(positions)
+            stats_list.append(stats)
+            sensor_offsets[i + 1] = sensor_offsets[i] + len(stats)
+        else:
+            sensor_offsets[i + 1] = sensor_offsets[i]
+
+    if stats_list:
+        positions = np.concatenate(positions_list)
+        stats = np.concatenate(stats_list)
+    else:
+        positions = np.empty((0, 3), dtype=np.float64)
+        stats = np.empty((0, n_stats), dtype=np.float64)
+    result = (_write_output(positions.astype(dtype, copy=False), out_positions, "out_positions"),
+              _write_output(stats.astype(dtype, copy=False), out, "out"),
+              sensor_offsets)
+    if per_pmt:
+        if pmt_stats_list:
+            pmt_positions = np.concatenate(pmt_positions_list)
+            pmt_stats = np.concatenate(pmt_stats_list)
+            pmts_per_sensor = np.concatenate(pmts_per_sensor_list)
+        else:
+            pmt_positions = np.empty((0, 3))
+            pmt_stats = np.empty((0, n_stats))
+            pmts_per_sensor = np.zeros(0, dtype=np.int64)
+        pmt_offsets = np.concatenate(([0], np.cumsum(pmts_per_sensor))).astype(np.int64)
+        result += (pmt_positions.astype(dtype), pmt_stats.astype(dtype), pmt_offsets)
+    return result + (hit_flags,) if return_hlc_flags else result
+
+
+def process_event_dense(
+    event_data: Dict[str, Any],
+    geometry: Geometry,
+    out: Optional[np.ndarray] = None,
+    fill_value: float = 0.0,
+    grouping_window_ns: Optional[float] = None,
+    extended: bool = False,
+    n_threads: Optional[int] = None,
+    plan: Optional[_PlanArg] = None,
+    dtype: DTypeLike = np.float64,
+    neighbor_rule: Optional[NeighborRule] = None,
+    hlc_only: bool = False,
+    cleaning: Optional[HitCleaning] = None,
+) -> np.ndarray:
+    """
+    Process a detector event into a dense detector tensor indexed by geometry.
+
+    Every sensor of the ``geometry`` grid gets a cell of statistics: sensor
+    ``(string_id, sensor_id)`` sits at ``[string_id - s0, sensor_id - d0]``
+    with ``(s0, d0) = geometry.grid_origin``, and cells of sensors without hits
+    (or of grid slots without a sensor) hold ``fill_value``. The native backend
+    writes the statistics straight into the tensor, with no compact sensor table
+    in between, which suits CNN inputs. ``event_data`` is read as for
+    :func:`process_event`; the ``sensor_pos_*`` fields are not needed. The
+    tensor is the only output: there is no ``return_hlc_flags`` or ``per_pmt``
+    here, :func:`process_event` provides those.
+
+    Args:
+        event_data: Event dictionary with required photon fields
+        geometry: :class:`Geometry` defining the grid; every hit sensor must be part of it
+        out: Optional preallocated C-contiguous array of dtype ``dtype`` and shape
+            ``(*geometry.grid_shape, n_stats)`` that is filled and returned.
+        fill_value: Value of the cells without hits (default: 0.0)
+        grouping_window_ns: Time window for grouping hits (default: None, no grouping)
+        extended: If True, compute 25 statistics per sensor. If False (default), compute 9.
+        n_threads: Number of threads the native backend may use, as for :func:`process_event`.
+        plan: Optional :class:`StatPlan` selecting the statistic columns, as for
+            :func:`process_event`.
+        dtype: Output dtype, ``np.float64`` (default) or ``np.float32``, as for
+            :func:`process_event`.
+        neighbor_rule: Optional :class:`NeighborRule`, as for :func:`process_event`.
+        hlc_only: Compute the statistics over the HLC hits only, as for
+            :func:`process_event`; sensors without one keep ``fill_value``.
+        cleaning: Optional :class:`HitCleaning`, as for :func:`process_event`.
+
+    Returns:
+        np.ndarray of shape (n_string_slots, n_sensor_slots, n_stats)
+    """
+    plan = _as_plan(plan)
+    dtype = _output_dtype(dtype)
+    photons = _extract_photons_data(event_data, require_positions=False)
+
+    string_ids, sensor_ids = _id_columns(photons['string_id'], photons['sensor_id'])
+    times = _time_column(photons['t'])
+    charges = photons.get('charge')
+    charges_arr = None if charges is None else _float_column(charges)
+
+    native = _backend.get_native_module()
+    if native is not None:
+        return native.process_event_dense(
+            geometry._native,
+            string_ids,
+            sensor_ids,
+            times,
             charges=charges_arr,
+            out=out,
+            fill_value=fill_value,
             grouping_window_ns=grouping_window_ns,
-            n_threads=None,
+            n_threads=n_threads,
             extended=extended,
+            plan=None if plan is None else plan._native,
+            dtype=dtype,
+            neighbor_rule=None if neighbor_rule is None else neighbor_rule._native,
+            hlc_only=hlc_only,
+            cleaning=None if cleaning is None else cleaning._native,
         )
 
-    return _process_event_arrays_numpy(
-        sensor_pos_x,
-        sensor_pos_y,
-        sensor_pos_z,
-        string_ids,
-        sensor_ids,
-        times,
-        charges_arr,
-        grouping_window_ns,
-        extended,
+    shape = geometry.grid_shape + (_num_stats(plan, extended),)
+    tensor = _dense_output(out, shape, dtype, fill_value)
+    _fill_dense_numpy(tensor, geometry, photons, string_ids, sensor_ids, times, charges_arr,
+                      grouping_window_ns, extended, plan, neighbor_rule, hlc_only, cleaning)
+    return tensor
+
+
+def process_events_batch_dense(
+    event_data: Dict[str, Any],
+    event_offsets: Union[np.ndarray, list],
+    geometry: Geometry,
+    out: Optional[np.ndarray] = None,
+    fill_value: float = 0.0,
+    grouping_window_ns: Optional[float] = None,
+    extended: bool = False,
+    n_threads: Optional[int] = None,
+    plan: Optional[_PlanArg] = None,
+    dtype: DTypeLike = np.float64,
+    neighbor_rule: Optional[NeighborRule] = None,
+    hlc_only: bool = False,
+    cleaning: Optional[HitCleaning] = None,
+) -> np.ndarray:
+    """
+    Process many events into a batch of dense detector tensors.
+
+    ``event_data`` and ``event_offsets`` are read as for
+    :func:`process_events_batch`, and event ``i`` fills ``out[i]`` as
+    :func:`process_event_dense` fills its tensor. The native backend processes
+    the events with the GIL released and in parallel across events.
+
+    Args:
+        event_data: Dictionary with flat photon fields for the whole batch
+        event_offsets: Hit offsets delimiting the events, shape (n_events + 1,)
+        geometry: :class:`Geometry` defining the grid; every hit sensor must be part of it
+        out: Optional preallocated C-contiguous array of dtype ``dtype`` and shape
+            ``(n_events, *geometry.grid_shape, n_stats)`` that is filled and returned.
+        fill_value: Value of the cells without hits (default: 0.0)
+        grouping_window_ns, extended, n_threads, plan, dtype, neighbor_rule,
+            hlc_only, cleaning: As for :func:`process_event_dense`.
+
+    Returns:
+        np.ndarray of shape (n_events, n_string_slots, n_sensor_slots, n_stats)
+    """
+    plan = _as_plan(plan)
+    dtype = _output_dtype(dtype)
+    photons = _extract_photons_data(event_data, require_positions=False)
+
+    string_ids, sensor_ids = _id_columns(photons['string_id'], photons['sensor_id'])
+    times = _time_column(photons['t'])
+    charges = photons.get('charge')
+    charges_arr = None if charges is None else _float_column(charges)
+    offsets = np.ascontiguousarray(event_offsets, dtype=np.int64)
+
+    native = _backend.get_native_module()
+    if native is not None:
+        return native.process_events_batch_dense(
+            geometry._native,
+            string_ids,
+            sensor_ids,
+            times,
+            offsets,
+            charges=charges_arr,
+            out=out,
+            fill_value=fill_value,
+            grouping_window_ns=grouping_window_ns,
+            n_threads=n_threads,
+            extended=extended,
+            plan=None if plan is None else plan._native,
+            dtype=dtype,
+            neighbor_rule=None if neighbor_rule is None else neighbor_rule._native,
+            hlc_only=hlc_only,
+            cleaning=None if cleaning is None else cleaning._native,
+        )
+
+    if offsets.ndim != 1 or len(offsets) < 1:
+        raise ValueError("event_offsets must be a 1D array of length n_events + 1")
+    if offsets[0] != 0 or offsets[-1] != len(times):
+        raise ValueError("event_offsets must start at 0 and end at the number of hits")
+    if np.any(np.diff(offsets) < 0):
+        raise ValueError("event_offsets must be non-decreasing")
+
+    shape = (len(offsets) - 1,) + geometry.grid_shape + (_num_stats(plan, extended),)
+    tensor = _dense_output(out, shape, dtype, fill_value)
+    for i in range(len(offsets) - 1):
+        start, end = offsets[i], offsets[i + 1]
+        _fill_dense_numpy(tensor[i], geometry, photons, string_ids[start:end], sensor_ids[start:end],
+                          times[start:end], None if charges_arr is None else charges_arr[start:end],
+                          grouping_window_ns, extended, plan, neighbor_rule, hlc_only, cleaning)
+    return tensor
+
+
+def _dense_output(out: Optional[np.ndarray], shape: Tuple[int, ...], dtype: np.dtype,
+                  fill_value: float) -> np.ndarray:
+    """A dense tensor of ``shape`` filled with ``fill_value``: ``out``, after the native checks, or a new one."""
+    if out is None:
+        return np.full(shape, fill_value, dtype=dtype)
+    if not isinstance(out, np.ndarray) or out.dtype != dtype:
+        raise ValueError(f"out must have dtype {dtype}")
+    if not out.flags.c_contiguous or not out.flags.writeable:
+        raise ValueError("out must be a writeable C-contiguous array")
+    if out.shape != shape:
+        raise ValueError(f"out must have shape ({', '.join(str(n) for n in shape)})")
+    out.fill(fill_value)
+    return out
+
+
+def _fill_dense_numpy(tensor: np.ndarray, geometry: Geometry, photons: Dict[str, Any],
+                      string_ids: np.ndarray, sensor_ids: np.ndarray, times: np.ndarray,
+                      charges: Optional[np.ndarray], grouping_window_ns: Optional[float], extended: bool,
+                      plan: Optional[StatPlan], neighbor_rule: Optional[NeighborRule], hlc_only: bool,
+                      cleaning: Optional[HitCleaning]) -> None:
+    """Write the statistics of one event into the cells of its sensors in a filled event tensor."""
+    if len(times) == 0:
+        return
+    sensor_pos_x, sensor_pos_y, sensor_pos_z = _hit_positions(photons, geometry, string_ids, sensor_ids)
+    _, stats, _, _, sensor_keys = _process_event_arrays_numpy(
+        sensor_pos_x, sensor_pos_y, sensor_pos_z, string_ids, sensor_ids, times, charges,
+        grouping_window_ns, extended, plan, neighbor_rule, False, hlc_only, cleaning,
     )
+    cells = tensor.reshape(-1, tensor.shape[-1])
+    cells[geometry._slots(sensor_keys[:, 0], sensor_keys[:, 1])] = stats
 
 
 def _process_event_arrays_numpy(sensor_pos_x: np.ndarray,
@@ -154,7 +693,22 @@ def _process_event_arrays_numpy(sensor_pos_x: np.ndarray,
                                 times: np.ndarray,
                                 charges: Optional[np.ndarray],
                                 grouping_window_ns: Optional[float],
-                                extended: bool = False) -> Tuple[np.ndarray, np.ndarray]:
+                                extended: bool = False,
+                                plan: Optional[StatPlan] = None,
+                                neighbor_rule: Optional[NeighborRule] = None,
+                                hlc_flags: bool = False,
+                                hlc_only: bool = False,
+                                cleaning: Optional[HitCleaning] = None,
+                                pmt_ids: Optional[np.ndarray] = None,
+                                ) -> Tuple[np.ndarray, np.ndarray, Optional[np.ndarray], Optional[Tuple], np.ndarray]:
+    """
+    Positions and statistics of one event; when the HLC hits are needed
+    (``hlc_flags``, ``hlc_only`` or seeded RT cleaning) the HLC flag of every
+    hit (input order; else None); with ``pmt_ids`` the PMT tables
+    (positions, statistics, number of PMT rows per sensor; else None); and the
+    (string_id, sensor_id) of each row, shape (N_sensors, 2).
+    """
+    times = np.asarray(times, dtype=np.float64)
     if charges is None:
         charges = np.ones_like(times, dtype=np.float64)
     else:
@@ -162,85 +716,120 @@ def _process_event_arrays_numpy(sensor_pos_x: np.ndarray,
 
     sensor_keys = np.column_stack((string_ids, sensor_ids))
     unique_sensors, inverse_indices = np.unique(sensor_keys, axis=0, return_inverse=True)
+    inverse_indices = inverse_indices.reshape(-1)
 
     n_sensors = len(unique_sensors)
-    n_stats = 25 if extended else 9
-
-    sensor_positions = np.empty((n_sensors, 3), dtype=np.float64)
-    sensor_stats = np.empty((n_sensors, n_stats), dtype=np.float64)
+    n_stats = _num_stats(plan, extended)
+    n_pulses_column, neighbors_column = _special_columns(plan, extended)
 
-    sort_order = np.argsort(inverse_indices)
-    sorted_times = times[sort_order]
-    sorted_charges = charges[sort_order]
-    sorted_positions_x = sensor_pos_x[sort_order]
-    sorted_positions_y = sensor_pos_y[sort_order]
-    sorted_positions_z = sensor_pos_z[sort_order]
+    sort_order = np.argsort(inverse_indices, kind="stable")
     sorted_indices = inverse_indices[sort_order]
-
     split_points = np.where(np.diff(sorted_indices) != 0)[0] + 1
-
-    sensor_times_list = np.split(sorted_times, split_points)
-    sensor_charges_list = np.split(sorted_charges, split_points)
-    sensor_pos_x_list = np.split(sorted_positions_x, split_points)
-    sensor_pos_y_list = np.split(sorted_positions_y, split_points)
-    sensor_pos_z_list = np.split(sorted_positions_z, split_points)
-
-    for i in range(n_sensors):
-        times_slice = sensor_times_list[i]
-        min_idx = np.argmin(times_slice)
-        sensor_positions[i] = [
-            sensor_pos_x_list[i][min_idx],
-            sensor_pos_y_list[i][min_idx],
-            sensor_pos_z_list[i][min_idx]
-        ]
-        sensor_stats[i] = _process_sensor_data_numpy(
-            sensor_times_list[i],
-            sensor_charges_list[i],
+    sensor_hits = np.split(sort_order, split_points)
+
+    def positions_of(hits_list):
+        positions = np.empty((len(hits_list), 3), dtype=np.float64)
+        for i, hits in enumerate(hits_list):
+            first = hits[np.argmin(times[hits])]
+            positions[i] = [sensor_pos_x[first], sensor_pos_y[first], sensor_pos_z[first]]
+        return positions
+
+    sensor_positions = positions_of(sensor_hits)
+
+    # Neighbor pass over all hits: counts per sensor and HLC flags per hit.
+    rule = neighbor_rule if neighbor_rule is not None else NeighborRule()
+    seeded_rt = cleaning is not None and cleaning.srt_radius is not None
+    drops_hits = hlc_only or (cleaning is not None and (seeded_rt or cleaning.time_window_ns is not None))
+    hit_flags = None
+    counts = None
+    if neighbors_column is not None or hlc_flags or hlc_only or seeded_rt:
+        counts, flags_list = _neighbor_scan_numpy(rule, unique_sensors, sensor_positions,
+                                                  [times[hits] for hits in sensor_hits])
+        if hlc_flags or hlc_only or seeded_rt:
+            hit_flags = np.zeros(len(times), dtype=np.uint8)
+            for hits, flags in zip(sensor_hits, flags_list):
+                hit_flags[hits] = flags
+
+    # Cleaning and HLC-only selection on one mask; neighbors are then counted
+    # over the kept hits.
+    if drops_hits:
+        keep = (np.ones(len(times), dtype=bool) if cleaning is None
+                else _clean_hits_numpy(cleaning, times, sensor_positions, sensor_hits, hit_flags))
+        if hlc_only:
+            keep &= hit_flags.astype(bool)
+        sensor_hits = [hits[keep[hits]] for hits in sensor_hits]
+        kept = np.array([i for i, hits in enumerate(sensor_hits) if len(hits)], dtype=np.int64)
+        sensor_hits = [sensor_hits[i] for i in kept]
+        unique_sensors = unique_sensors[kept]
+        sensor_positions = positions_of(sensor_hits)
+        if neighbors_column is not None:
+            counts, _ = _neighbor_scan_numpy(rule, unique_sensors, sensor_positions,
+                                             [times[hits] for hits in sensor_hits])
+
+    sensor_stats = np.empty((len(sensor_hits), n_stats), dtype=np.float64)
+    for row, hits in enumerate(sensor_hits):
+        sensor_stats[row] = _process_sensor_data_numpy(
+            times[hits],
+            charges[hits],
             grouping_window_ns,
             extended,
+            plan,
         )
 
-    if extended:
-        # HLC-style neighbor count: same string, +-2 sensor_id, +-1000ns coincidence.
-        # Pre-sort each sensor's times for the merge-scan (numpy path doesn't
-        # guarantee time-sorted order within sensor groups).
-        sorted_sensor_times = [np.sort(t) for t in sensor_times_list]
-        for i in range(n_sensors):
-            my_str, my_sid = unique_sensors[i]
-            count = 0
-            for j in range(max(0, i - 4), min(n_sensors, i + 5)):
-                if j == i:
-                    continue
-                other_str, other_sid = unique_sensors[j]
-                if other_str != my_str:
-                    continue
-                sid_diff = abs(int(other_sid) - int(my_sid))
-                if sid_diff < 1 or sid_diff > 2:
-                    continue
-                # Merge-scan for +-1000ns coincidence on pre-grouping times
-                t_a = sorted_sensor_times[i]
-                t_b = sorted_sensor_times[j]
-                ai, bi = 0, 0
-                coincident = False
-                while ai < len(t_a) and bi < len(t_b):
-                    diff = t_a[ai] - t_b[bi]
-                    if abs(diff) <= 1000.0:
-                        coincident = True
-                        break
-                    if diff < 0:
-                        ai += 1
-                    else:
-                        bi += 1
-                if coincident:
-                    count += 1
-            sensor_stats[i, 23] = float(count)
-
-        # Override n_pulses with pre-grouping count when grouping is applied
-        if grouping_window_ns is not None and grouping_window_ns > 0:
-            for i in range(n_sensors):
-                sensor_stats[i, 21] = float(len(sensor_times_list[i]))
-
-    return sensor_positions, sensor_stats
+    if neighbors_column is not None:
+        sensor_stats[:, neighbors_column] = np.where(counts >= rule.multiplicity, counts, 0)
+
+    # Override n_pulses with pre-grouping count when grouping is applied
+    if n_pulses_column is not None and grouping_window_ns is not None and grouping_window_ns > 0:
+        for row, hits in enumerate(sensor_hits):
+            sensor_stats[row, n_pulses_column] = float(len(hits))
+
+    pmt_tables = None
+    if pmt_ids is not None:
+        # PMT rows: each sensor's kept hits split by pmt_id, in ascending pmt_id.
+        pmt_hits = []
+        pmt_sensor_rows = []
+        for row, hits in enumerate(sensor_hits):
+            for pmt in np.unique(pmt_ids[hits]):
+                pmt_hits.append(hits[pmt_ids[hits] == pmt])
+                pmt_sensor_rows.append(row)
+        pmt_stats = np.empty((len(pmt_hits), n_stats), dtype=np.float64)
+        for row, hits in enumerate(pmt_hits):
+            pmt_stats[row] = _process_sensor_data_numpy(times[hits], charges[hits], grouping_window_ns,
+                                                        extended, plan)
+            if n_pulses_column is not None and grouping_window_ns is not None and grouping_window_ns > 0:
+                pmt_stats[row, n_pulses_column] = float(len(hits))
+        if neighbors_column is not None:
+            pmt_stats[:, neighbors_column] = sensor_stats[pmt_sensor_rows, neighbors_column]
+        pmt_positions = positions_of(pmt_hits)
+        pmts_per_sensor = np.bincount(np.asarray(pmt_sensor_rows, dtype=np.int64), minlength=len(sensor_hits))
+        pmt_tables = (pmt_positions, pmt_stats, pmts_per_sensor)
+
+    return sensor_positions, sensor_stats, hit_flags, pmt_tables, unique_sensors
+
+
+def _write_output(result: np.ndarray, out: Optional[np.ndarray], name: str) -> np.ndarray:
+    """
+    Copy a NumPy-path result into a caller-provided buffer, mirroring the checks
+    of the native backend. 1D buffers must match exactly; 2D buffers may have
+    more rows than needed, and a view of the leading rows is returned.
+    """
+    if out is None:
+        return result
+    if not isinstance(out, np.ndarray) or out.dtype != result.dtype:
+        raise ValueError(f"{name} must have dtype {result.dtype}")
+    if not out.flags.c_contiguous or not out.flags.writeable:
+        raise ValueError(f"{name} must be a writeable C-contiguous array")
+    if result.ndim == 1:
+        if out.shape != result.shape:
+            raise ValueError(f"{name} must have shape ({result.shape[0]},)")
+        out[...] = result
+        return out
+    n_rows, n_cols = result.shape
+    if out.ndim != 2 or out.shape[1] != n_cols or out.shape[0] < n_rows:
+        raise ValueError(f"{name} must have shape (n, {n_cols}) with n >= {n_rows}")
+    out[:n_rows] = result
+    return out[:n_rows]
 
 
 def _group_hits_by_window(hit_times, hit_charges, time_window, return_counts=False):
@@ -314,12 +903,68 @@ def _group_hits_by_window(hit_times, hit_charges, time_window, return_counts=Fal
         return grouped_times, window_charges
 
 
-def _extract_photons_data(event_data: Dict[str, Any]) -> Dict[str, Any]:
+def _hit_positions(photons: Dict[str, Any],
+                   geometry: Optional[Geometry],
+                   string_ids: np.ndarray,
+                   sensor_ids: np.ndarray) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """Per-hit sensor positions, from the event itself or looked up in a geometry."""
+    if geometry is not None:
+        positions = geometry.hit_positions(string_ids, sensor_ids)
+        return (np.ascontiguousarray(positions[:, 0]),
+                np.ascontiguousarray(positions[:, 1]),
+                np.ascontiguousarray(positions[:, 2]))
+    return (_float_column(photons['sensor_pos_x']),
+            _float_column(photons['sensor_pos_y']),
+            _float_column(photons['sensor_pos_z']))
+
+
+def _float_column(values) -> np.ndarray:
+    """A contiguous float32 or float64 column, keeping float32 input as is."""
+    column = np.ascontiguousarray(values)
+    return column if column.dtype in (np.float32, np.float64) else column.astype(np.float64)
+
+
+def _time_column(values) -> np.ndarray:
+    """A contiguous time column: float32, float64 and int64 kept as is, other integers as int64."""
+    column = np.ascontiguousarray(values)
+    if column.dtype in (np.float32, np.float64, np.int64):
+        return column
+    if column.dtype.kind == "i" or (column.dtype.kind == "u" and column.dtype.itemsize < 8):
+        return column.astype(np.int64)
+    return column.astype(np.float64)
+
+
+def _id_columns(string_ids, sensor_ids) -> Tuple[np.ndarray, np.ndarray]:
+    """Contiguous ID columns of one shared int16 / int32 / int64 dtype, else int32."""
+    strings = np.ascontiguousarray(string_ids)
+    sensors = np.ascontiguousarray(sensor_ids)
+    if strings.dtype == sensors.dtype and strings.dtype in (np.int16, np.int32, np.int64):
+        return strings, sensors
+    return _int32_ids(strings), _int32_ids(sensors)
+
+
+def _pmt_column(photons: Dict[str, Any]) -> np.ndarray:
+    """The ``pmt_id`` photon field as a contiguous int16 / int32 / int64 column, else int32."""
+    if "pmt_id" not in photons:
+        raise ValueError("Missing required photon fields: pmt_id")
+    pmt_ids = np.ascontiguousarray(photons["pmt_id"])
+    return pmt_ids if pmt_ids.dtype in (np.int16, np.int32, np.int64) else pmt_ids.astype(np.int32)
+
+
+def _output_dtype(dtype: DTypeLike) -> np.dtype:
+    dtype = np.dtype(dtype)
+    if dtype not in (np.float32, np.float64):
+        raise ValueError("dtype must be float32 or float64")
+    return dtype
+
+
+def _extract_photons_data(event_data: Dict[str, Any], require_positions: bool = True) -> Dict[str, Any]:
     """
     Retrieve the photon-level dictionary from an event mapping.
 
     The function accepts either an outer dictionary containing a ``"photons"``
-    key or a dictionary that already holds the required photon fields.
+    key or a dictionary that already holds the required photon fields. The
+    ``sensor_pos_*`` fields are only required when ``require_positions`` is set.
     """
     if not isinstance(event_data, dict):
         raise TypeError("event_data must be a dictionary")
@@ -339,6 +984,8 @@ def _extract_photons_data(event_data: Dict[str, Any]) -> Dict[str, Any]:
         "sensor_id",
         "t",
     ]
+    if not require_positions:
+        required_fields = required_fields[3:]
     missing = [field for field in required_fields if field not in photons]
     if missing:
         missing_str = ", ".join(missing)
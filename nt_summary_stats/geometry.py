@@ -0,0 +1,150 @@
+"""
+Registered detector geometry.
+
+A :class:`Geometry` holds the fixed position of every sensor, keyed by
+``(string_id, sensor_id)``. Passing one to :func:`process_event` or
+:func:`process_events_batch` removes the need to ship per-hit sensor positions,
+and its ID grid lays out the dense detector tensors of :func:`process_event_dense`.
+"""
+
+from typing import Tuple, Union
+
+import numpy as np
+
+from . import _backend
+
+# Mirrors the native limit on the dense lookup table (string slots * sensor slots).
+_MAX_TABLE_SIZE = 1 << 24
+
+_INT32 = np.iinfo(np.int32)
+
+
+def _int32_ids(ids) -> np.ndarray:
+    """An ID column as contiguous int32; values outside the int32 range raise instead of wrapping."""
+    ids = np.asarray(ids)
+    if ids.dtype != np.int32 and ids.size and (ids.min() < _INT32.min or ids.max() > _INT32.max):
+        raise ValueError("string_id and sensor_id values must fit in int32")
+    return np.ascontiguousarray(ids, dtype=np.int32)
+
+
+class Geometry:
+    """
+    Fixed detector geometry: sensor positions keyed by ``(string_id, sensor_id)``.
+
+    Lookups go through a dense table spanning both ID ranges, so mapping IDs to
+    a sensor index is O(1). When the native extension is available the table
+    also lives on the native side and is shared by every native entry point.
+
+    Args:
+        string_ids: String ID of each sensor, shape (N,)
+        sensor_ids: Sensor ID of each sensor within its string, shape (N,)
+        x, y, z: Sensor coordinates, each of shape (N,)
+    """
+
+    def __init__(self, string_ids, sensor_ids, x, y, z):
+        string_ids = _int32_ids(string_ids)
+        sensor_ids = _int32_ids(sensor_ids)
+        coords = [np.asarray(c, dtype=np.float64) for c in (x, y, z)]
+        if any(a.ndim != 1 for a in [string_ids, sensor_ids, *coords]):
+            raise ValueError("All geometry arrays must be 1D")
+        if any(len(a) != len(string_ids) for a in [sensor_ids, *coords]):
+            raise ValueError("All geometry arrays must have identical lengths")
+        if len(string_ids) == 0:
+            raise ValueError("geometry must contain at least one sensor")
+
+        self._string_ids = string_ids
+        self._sensor_ids = sensor_ids
+        self._positions = np.column_stack(coords)
+
+        self._min_string_id = int(string_ids.min())
+        self._min_sensor_id = int(sensor_ids.min())
+        self._n_string_slots = int(string_ids.max()) - self._min_string_id + 1
+        self._n_sensor_slots = int(sensor_ids.max()) - self._min_sensor_id + 1
+        if self._n_string_slots * self._n_sensor_slots > _MAX_TABLE_SIZE:
+            raise ValueError("geometry string_id / sensor_id ranges are too sparse for a dense lookup")
+
+        table = np.full(self._n_string_slots * self._n_sensor_slots, -1, dtype=np.int32)
+        slots = self._slots(string_ids, sensor_ids)
+        unique_slots, first = np.unique(slots, return_index=True)
+        if len(unique_slots) != len(slots):
+            duplicate = np.setdiff1d(np.arange(len(slots)), first)[0]
+            raise ValueError(
+                f"geometry lists sensor (string_id={string_ids[duplicate]}, "
+                f"sensor_id={sensor_ids[duplicate]}) more than once"
+            )
+        table[slots] = np.arange(len(slots), dtype=np.int32)
+        self._table = table
+
+        native = _backend.get_native_module()
+        self._native = None if native is None else native.Geometry(
+            string_ids, sensor_ids, self._positions[:, 0], self._positions[:, 1], self._positions[:, 2]
+        )
+
+    @classmethod
+    def from_table(cls, table: Union[np.ndarray, list]) -> "Geometry":
+        """Build a geometry from an (N, 5) table of rows (string_id, sensor_id, x, y, z)."""
+        table = np.asarray(table, dtype=np.float64)
+        if table.ndim != 2 or table.shape[1] != 5:
+            raise ValueError("geometry table must have shape (N, 5)")
+        return cls(table[:, 0], table[:, 1], table[:, 2], table[:, 3], table[:, 4])
+
+    @property
+    def n_sensors(self) -> int:
+        return len(self._string_ids)
+
+    @property
+    def string_ids(self) -> np.ndarray:
+        return self._string_ids
+
+    @property
+    def sensor_ids(self) -> np.ndarray:
+        return self._sensor_ids
+
+    @property
+    def positions(self) -> np.ndarray:
+        """Sensor positions, shape (N, 3), in the order the geometry was built with."""
+        return self._positions
+
+    @property
+    def grid_shape(self) -> Tuple[int, int]:
+        """(n_string_slots, n_sensor_slots) of the dense (string_id, sensor_id) grid the geometry spans."""
+        return (self._n_string_slots, self._n_sensor_slots)
+
+    @property
+    def grid_origin(self) -> Tuple[int, int]:
+        """(string_id, sensor_id) of grid cell (0, 0): the smallest string and sensor IDs."""
+        return (self._min_string_id, self._min_sensor_id)
+
+    def index(self, string_ids, sensor_ids) -> np.ndarray:
+        """Return the geometry row of each sensor, or -1 where it is not part of the geometry."""
+        string_ids = np.asarray(string_ids, dtype=np.int64)
+        sensor_ids = np.asarray(sensor_ids, dtype=np.int64)
+        s = string_ids - self._min_string_id
+        d = sensor_ids - self._min_sensor_id
+        known = (s >= 0) & (s < self._n_string_slots) & (d >= 0) & (d < self._n_sensor_slots)
+        rows = np.full(s.shape, -1, dtype=np.int32)
+        rows[known] = self._table[s[known] * self._n_sensor_slots + d[known]]
+        return rows
+
+    def hit_positions(self, string_ids, sensor_ids) -> np.ndarray:
+        """Positions of the sensors hit, shape (N, 3); raises for sensors outside the geometry."""
+        rows = self.index(string_ids, sensor_ids)
+        missing = np.flatnonzero(rows < 0)
+        if len(missing):
+            i = missing[0]
+            raise ValueError(
+                f"sensor (string_id={np.asarray(string_ids)[i]}, "
+                f"sensor_id={np.asarray(sensor_ids)[i]}) is not part of the geometry"
+            )
+        return self._positions[rows]
+
+    def __len__(self) -> int:
+        return self.n_sensors
+
+    def __reduce__(self):
+        return (Geometry, (self._string_ids, self._sensor_ids,
+                           self._positions[:, 0], self._positions[:, 1], self._positions[:, 2]))
+
+    def _slots(self, string_ids: np.ndarray, sensor_ids: np.ndarray) -> np.ndarray:
+        return ((string_ids.astype(np.int64) - self._min_string_id) * self._n_sensor_slots
+                + (sensor_ids.astype(np.int64) - self._min_sensor_id))
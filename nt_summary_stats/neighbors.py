@@ -0,0 +1,109 @@
+"""
+Neighbor-coincidence rules.
+
+A :class:`NeighborRule` defines the ``n_string_neighbors`` column of the event
+entry points: which sensors count as neighbors of a sensor (same string within
+a sensor-ID distance, or within a spatial radius) and when a neighbor is in
+coincidence with it (some pair of their hits within a time window).
+"""
+
+from typing import List, Optional, Tuple
+
+import numpy as np
+
+from . import _backend
+
+
+class NeighborRule:
+    """
+    Which sensors are neighbors, and when a neighbor is in coincidence.
+
+    Two sensors coincide when a hit of one lies within ``window_ns`` of a hit of
+    the other (pre-grouping times). Neighbors are the sensors on the same string
+    at most ``max_id_distance`` sensor IDs away, however many sensors in between
+    are unhit; with a ``radius`` they are instead all sensors within that
+    distance, which also covers layouts where IDs do not follow the string
+    (e.g. multi-PMT modules). A sensor reports its number of coincident neighbors
+    once it reaches ``multiplicity``, and 0 below that. The default rule is the
+    HLC-style one of ``extended=True``: same string, +-2 sensor IDs, +-1000 ns.
+
+    Args:
+        window_ns: Coincidence window in ns (inclusive), >= 0
+        max_id_distance: Largest sensor-ID distance on the same string, >= 1
+        radius: Optional neighbor radius in position units; replaces the ID rule
+        multiplicity: Fewest coincident neighbors that are reported, >= 1
+    """
+
+    def __init__(self, window_ns: float = 1000.0, max_id_distance: int = 2,
+                 radius: Optional[float] = None, multiplicity: int = 1):
+        window_ns = float(window_ns)
+        max_id_distance = int(max_id_distance)
+        radius = None if radius is None else float(radius)
+        multiplicity = int(multiplicity)
+        if not np.isfinite(window_ns) or window_ns < 0:
+            raise ValueError("window_ns must be finite and non-negative")
+        if max_id_distance < 1:
+            raise ValueError("max_id_distance must be at least 1")
+        if radius is not None and not (np.isfinite(radius) and radius > 0):
+            raise ValueError("radius must be finite and positive")
+        if multiplicity < 1:
+            raise ValueError("multiplicity must be at least 1")
+
+        self.window_ns = window_ns
+        self.max_id_distance = max_id_distance
+        self.radius = radius
+        self.multiplicity = multiplicity
+
+        native = _backend.get_native_module()
+        self._native = None if native is None else native.NeighborRule(
+            window_ns, max_id_distance, radius, multiplicity
+        )
+
+    def __repr__(self) -> str:
+        return (f"NeighborRule(window_ns={self.window_ns}, max_id_distance={self.max_id_distance}, "
+                f"radius={self.radius}, multiplicity={self.multiplicity})")
+
+    def __reduce__(self):
+        return (NeighborRule, (self.window_ns, self.max_id_distance, self.radius, self.multiplicity))
+
+
+def _neighbor_scan_numpy(rule: NeighborRule, sensor_keys: np.ndarray, positions: np.ndarray,
+                         sensor_times: List[np.ndarray]) -> Tuple[np.ndarray, List[np.ndarray]]:
+    """
+    Neighbor pass of an event: the number of neighbors in coincidence with each
+    sensor (before the multiplicity cut), and for each sensor the HLC flags of
+    its hits (coincident with hits on at least ``multiplicity`` neighbors).
+
+    Args:
+        rule: The neighbor rule
+        sensor_keys: (string_id, sensor_id) of each sensor, shape (N, 2)
+        positions: Sensor positions, shape (N, 3)
+        sensor_times: Hit times of each sensor, one array per sensor
+    """
+    n = len(sensor_keys)
+    counts = np.zeros(n, dtype=np.int64)
+    flags = []
+    strings = sensor_keys[:, 0]
+    ids = sensor_keys[:, 1].astype(np.int64)
+    sorted_times = [np.sort(t) for t in sensor_times]
+    for i in range(n):
+        if rule.radius is None:
+            near = (strings == strings[i]) & (np.abs(ids - ids[i]) <= rule.max_id_distance)
+        else:
+            delta = positions - positions[i]
+            near = np.einsum("ij,ij->i", delta, delta) <= rule.radius * rule.radius
+        near[i] = False
+
+        t_a = np.asarray(sensor_times[i], dtype=np.float64)
+        matches = np.zeros(len(t_a), dtype=np.int64)
+        for j in np.flatnonzero(near):
+            t_b = sorted_times[j]
+            # The first hit of b not before t_a - window coincides if it is within t_a + window.
+            k = np.searchsorted(t_b, t_a - rule.window_ns, side="left")
+            inside = k < len(t_b)
+            matched = np.zeros(len(t_a), dtype=bool)
+            matched[inside] = t_b[k[inside]] <= t_a[inside] + rule.window_ns
+            matches += matched
+            counts[i] += bool(matched.any())
+        flags.append(matches >= rule.multiplicity)
+    return counts, flags
@@ -0,0 +1,296 @@
+"""
+Runtime-configurable statistic plans.
+
+A :class:`StatPlan` lists the statistic columns computed for every sensor:
+charge windows of arbitrary widths, charge quantile times at arbitrary levels,
+and optional groups (weighted moments, pulse count, peak charge fraction,
+string-neighbor count, skewness). Build it once and pass it as ``plan=`` to any
+entry point in place of ``extended``. :meth:`StatPlan.select` builds a plan of
+only the named columns; the native kernels then accumulate only what those
+columns read.
+"""
+
+import re
+from typing import Iterable, List, Optional, Sequence, Tuple, Union
+
+import numpy as np
+
+from . import _backend
+
+# Column kinds; the value is the window width (ns) or the charge fraction.
+_TOTAL_CHARGE = "total_charge"
+_WINDOW_CHARGE = "window_charge"
+_FIRST_TIME = "first_pulse_time"
+_LAST_TIME = "last_pulse_time"
+_QUANTILE_TIME = "quantile_time"
+_MEAN_TIME = "charge_weighted_mean_time"
+_STD_TIME = "charge_weighted_std_time"
+_N_PULSES = "n_pulses"
+_Q_MAX_FRAC = "q_max_frac"
+_NEIGHBORS = "n_string_neighbors"
+_SKEWNESS = "t_skewness"
+
+_Column = Tuple[str, float]
+
+_FIXED_KINDS = (_TOTAL_CHARGE, _FIRST_TIME, _LAST_TIME, _MEAN_TIME, _STD_TIME,
+                _N_PULSES, _Q_MAX_FRAC, _NEIGHBORS, _SKEWNESS)
+_WINDOW_NAME = re.compile(r"charge_([0-9][0-9.eE+-]*)ns")
+_QUANTILE_NAME = re.compile(r"charge_([0-9][0-9.eE+-]*)_percent_time")
+
+
+def _format_number(value: float) -> str:
+    # Matches the native naming: up to six decimals, trailing zeros dropped.
+    text = f"{value:.6f}".rstrip("0")
+    return text[:-1] if text.endswith(".") else text
+
+
+def _parse_column(name: str) -> _Column:
+    if name in _FIXED_KINDS:
+        return (name, 0.0)
+    for pattern, kind in ((_QUANTILE_NAME, _QUANTILE_TIME), (_WINDOW_NAME, _WINDOW_CHARGE)):
+        match = pattern.fullmatch(name)
+        if match:
+            try:
+                value = float(match.group(1))
+            except ValueError:
+                break
+            return (kind, value / 100.0 if kind == _QUANTILE_TIME else value)
+    raise ValueError(f"unknown statistic column '{name}'")
+
+
+def _column_name(column: _Column) -> str:
+    kind, value = column
+    if kind == _WINDOW_CHARGE:
+        return f"charge_{_format_number(value)}ns"
+    if kind == _QUANTILE_TIME:
+        return f"charge_{_format_number(100.0 * value)}_percent_time"
+    return kind
+
+
+class StatPlan:
+    """
+    The statistic columns computed for every sensor, compiled once.
+
+    Columns come out in this order: ``total_charge``, ``first_pulse_time``,
+    ``last_pulse_time``, one ``charge_<w>ns`` per window width, one
+    ``charge_<q>_percent_time`` per quantile, then ``charge_weighted_mean_time``
+    and ``charge_weighted_std_time`` (``moments``), ``n_pulses``, ``q_max_frac``,
+    ``n_string_neighbors`` and ``t_skewness`` when enabled. :attr:`names` lists
+    them. ``StatPlan.standard()`` and ``StatPlan.extended()`` give the 9- and
+    25-column layouts of ``extended=False`` / ``extended=True``, and
+    ``StatPlan.select(...)`` any subset of columns in any order.
+
+    Args:
+        windows: Charge window widths in ns after the first pulse (inclusive)
+        quantiles: Charge fractions, each strictly between 0 and 1, at which the
+            collection time is reported
+        moments: Include the charge-weighted mean and standard deviation of time
+        n_pulses: Include the number of pulses (pre-grouping count)
+        q_max_frac: Include the peak charge fraction
+        neighbors: Include the HLC-style neighbor count (filled by the event
+            entry points under their :class:`NeighborRule`, 0 for single sensors)
+        skewness: Include the charge-weighted time skewness
+    """
+
+    def __init__(self,
+                 windows: Iterable[float] = (),
+                 quantiles: Iterable[float] = (),
+                 moments: bool = True,
+                 n_pulses: bool = False,
+                 q_max_frac: bool = False,
+                 neighbors: bool = False,
+                 skewness: bool = False):
+        windows = [float(w) for w in windows]
+        quantiles = [float(q) for q in quantiles]
+        columns: List[_Column] = [(_TOTAL_CHARGE, 0.0), (_FIRST_TIME, 0.0), (_LAST_TIME, 0.0)]
+        columns += [(_WINDOW_CHARGE, w) for w in windows]
+        columns += [(_QUANTILE_TIME, q) for q in quantiles]
+        if moments:
+            columns += [(_MEAN_TIME, 0.0), (_STD_TIME, 0.0)]
+        for enabled, kind in ((n_pulses, _N_PULSES), (q_max_frac, _Q_MAX_FRAC),
+                              (neighbors, _NEIGHBORS), (skewness, _SKEWNESS)):
+            if enabled:
+                columns.append((kind, 0.0))
+        self._init_columns(columns)
+
+        native = _backend.get_native_module()
+        self._native = None if native is None else native.StatPlan(
+            windows, quantiles, moments, n_pulses, q_max_frac, neighbors, skewness
+        )
+        self._reduce = (StatPlan, (windows, quantiles, moments, n_pulses, q_max_frac, neighbors, skewness))
+
+    @classmethod
+    def standard(cls) -> "StatPlan":
+        """The 9-column layout computed by default."""
+        return cls._preset(False)
+
+    @classmethod
+    def extended(cls) -> "StatPlan":
+        """The 25-column layout computed with ``extended=True``."""
+        return cls._preset(True)
+
+    @classmethod
+    def select(cls, columns: Union[Sequence[str], int]) -> "StatPlan":
+        """
+        A plan of only the given columns, output in the given order.
+
+        Args:
+            columns: Column names as listed by :attr:`names` (the fixed names,
+                ``charge_<w>ns`` and ``charge_<p>_percent_time``), or an integer
+                bitmask over the 25 extended columns where bit ``i`` selects
+                ``StatPlan.extended().names[i]`` (selected columns keep that order)
+        """
+        if isinstance(columns, (int, np.integer)) and not isinstance(columns, bool):
+            mask = int(columns)
+            extended_names = cls.extended().names
+            if mask < 0 or mask >> len(extended_names):
+                raise ValueError(f"column mask must only use bits 0-{len(extended_names) - 1}")
+            names = [name for i, name in enumerate(extended_names) if mask >> i & 1]
+        elif isinstance(columns, str):
+            names = [columns]
+        else:
+            names = [str(name) for name in columns]
+        if not names:
+            raise ValueError("a plan must select at least one column")
+
+        plan = cls.__new__(cls)
+        plan._init_columns([_parse_column(name) for name in names])
+        native = _backend.get_native_module()
+        plan._native = None if native is None else native.StatPlan.select(names)
+        plan._reduce = (StatPlan.select, (names,))
+        return plan
+
+    @classmethod
+    def _preset(cls, extended: bool) -> "StatPlan":
+        columns: List[_Column] = [
+            (_TOTAL_CHARGE, 0.0), (_WINDOW_CHARGE, 100.0), (_WINDOW_CHARGE, 500.0),
+            (_FIRST_TIME, 0.0), (_LAST_TIME, 0.0),
+            (_QUANTILE_TIME, 0.2), (_QUANTILE_TIME, 0.5),
+            (_MEAN_TIME, 0.0), (_STD_TIME, 0.0),
+        ]
+        if extended:
+            columns += [(_QUANTILE_TIME, q) for q in (0.05, 0.1, 0.25, 0.75, 0.9, 0.95)]
+            columns += [(_WINDOW_CHARGE, w) for w in (10.0, 20.0, 50.0, 200.0, 1000.0, 2000.0)]
+            columns += [(_N_PULSES, 0.0), (_Q_MAX_FRAC, 0.0), (_NEIGHBORS, 0.0), (_SKEWNESS, 0.0)]
+        plan = cls.__new__(cls)
+        plan._init_columns(columns)
+        native = _backend.get_native_module()
+        if native is None:
+            plan._native = None
+        else:
+            plan._native = native.StatPlan.extended() if extended else native.StatPlan.standard()
+        plan._reduce = (StatPlan._preset, (extended,))
+        return plan
+
+    def _init_columns(self, columns: Sequence[_Column]) -> None:
+        for kind, value in columns:
+            if kind == _WINDOW_CHARGE and not (np.isfinite(value) and value >= 0.0):
+                raise ValueError("charge window widths must be finite and non-negative")
+            if kind == _QUANTILE_TIME and not (0.0 < value < 1.0):
+                raise ValueError("charge quantiles must lie strictly between 0 and 1")
+        self._columns = list(columns)
+        self._names = tuple(_column_name(column) for column in columns)
+
+    @property
+    def n_stats(self) -> int:
+        """Number of statistic columns per sensor."""
+        return len(self._columns)
+
+    @property
+    def names(self) -> Tuple[str, ...]:
+        """Column names, in output order."""
+        return self._names
+
+    def _column_index(self, kind: str) -> Optional[int]:
+        for i, (column_kind, _) in enumerate(self._columns):
+            if column_kind == kind:
+                return i
+        return None
+
+    def __len__(self) -> int:
+        return self.n_stats
+
+    def __repr__(self) -> str:
+        return f"StatPlan({', '.join(self._names)})"
+
+    def __reduce__(self):
+        return self._reduce
+
+
+# What ``plan=`` accepts: a StatPlan, column names, or an extended-column bitmask.
+_PlanArg = Union[StatPlan, Sequence[str], int]
+
+
+def _as_plan(plan: Optional[_PlanArg]) -> Optional[StatPlan]:
+    """Accept a StatPlan, a list of column names or a column bitmask as ``plan=``."""
+    if plan is None or isinstance(plan, StatPlan):
+        return plan
+    return StatPlan.select(plan)
+
+
+def _compute_plan_stats_numpy(times, charges, plan: StatPlan) -> np.ndarray:
+    """NumPy evaluation of ``plan`` for the hits of one sensor."""
+    times = np.asarray(times, dtype=np.float64)
+    charges = np.asarray(charges, dtype=np.float64)
+    if len(times) != len(charges):
+        raise ValueError(f"times and charges must have the same length, got {len(times)} and {len(charges)}")
+
+    result = np.zeros(plan.n_stats, dtype=np.float64)
+    n = len(times)
+    if n == 0:
+        return result
+
+    order = np.argsort(times, kind="mergesort")
+    times_sorted = times[order]
+    charges_sorted = charges[order]
+    first_time = times_sorted[0]
+
+    if n == 1:
+        charge = charges_sorted[0]
+        for i, (kind, _) in enumerate(plan._columns):
+            if kind in (_TOTAL_CHARGE, _WINDOW_CHARGE):
+                result[i] = charge
+            elif kind in (_FIRST_TIME, _LAST_TIME, _QUANTILE_TIME, _MEAN_TIME):
+                result[i] = first_time
+            elif kind in (_N_PULSES, _Q_MAX_FRAC):
+                result[i] = 1.0
+        return result
+
+    total_charge = np.sum(charges_sorted)
+    cumulative_charge = np.cumsum(charges_sorted)
+
+    mean_time = 0.0
+    std_time = 0.0
+    if total_charge > 0:
+        mean_time = np.dot(times_sorted, charges_sorted) / total_charge
+        variance = np.dot(charges_sorted, times_sorted * times_sorted) / total_charge - mean_time * mean_time
+        std_time = np.sqrt(max(0.0, variance))
+
+    for i, (kind, value) in enumerate(plan._columns):
+        if kind == _TOTAL_CHARGE:
+            result[i] = total_charge
+        elif kind == _WINDOW_CHARGE:
+            end = np.searchsorted(times_sorted, first_time + value, side="right")
+            if end == n:
+                result[i] = total_charge
+            else:
+                result[i] = cumulative_charge[end - 1] if end > 0 else 0.0
+        elif kind == _FIRST_TIME:
+            result[i] = first_time
+        elif kind == _LAST_TIME:
+            result[i] = times_sorted[-1]
+        elif kind == _QUANTILE_TIME:
+            reached = np.flatnonzero(cumulative_charge > total_charge * value)
+            result[i] = times_sorted[reached[0]] if len(reached) else first_time
+        elif kind == _MEAN_TIME:
+            result[i] = mean_time
+        elif kind == _STD_TIME:
+            result[i] = std_time
+        elif kind == _N_PULSES:
+            result[i] = float(n)
+        elif kind == _Q_MAX_FRAC:
+            result[i] = np.max(charges_sorted) / total_charge if total_charge > 0 else 0.0
+        elif kind == _SKEWNESS and n >= 3 and std_time > 0.0 and total_charge > 0.0:
+            deviations = times_sorted - mean_time
+            result[i] = np.dot(charges_sorted, deviations ** 3) / (total_charge * std_time ** 3)
+    return result
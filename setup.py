@@ -11,7 +11,7 @@ ext_modules = [
     Pybind11Extension(
         "nt_summary_stats._native",
         ["src/nt_summary_stats.cpp"],
-        extra_compile_args=["-O3"],
+        extra_compile_args=["-O3", "-ffp-contract=off"],
         cxx_std=17,
     ),
 ]
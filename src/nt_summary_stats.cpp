@@ -3,593 +3,4554 @@
 #include <pybind11/stl.h>
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cctype>
 #include <cmath>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <numeric>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
 namespace py = pybind11;
 
 namespace {
 
-constexpr std::size_t kNumStats = 9;
-constexpr std::size_t kNumStatsExtended = 25;
+// Parallel event processing: a worker is only worth spawning when it has at
+// least this many hits to chew on, and each worker gets several chunks so that
+// uneven sensors even out through dynamic scheduling.
+constexpr std::size_t kMinHitsPerWorker = 2048;
+constexpr std::size_t kChunksPerWorker = 4;
+
+// Scheduling cost of a sensor on top of its hits, in hits: the position
+// lookup, row write and kernel setup every sensor pays once.
+constexpr std::size_t kSensorOverheadHits = 8;
+
+// Events with at least this many hits are ordered with the radix sort; below
+// it the comparison sort is faster (crossover measured at 150-200 hits with
+// benchmarks/sort_crossover.cpp).
+constexpr std::size_t kRadixSortMinHits = 192;
+
+// Events whose (string_id, sensor_id) ranges span at most this many sensor
+// slots per hit are grouped by a counting sort over the slots instead; past
+// about five slots per hit, clearing and scanning the histogram costs more
+// than sorting.
+constexpr std::size_t kCountingSortSlotsPerHit = 4;
+
+// A sensor's sums and running charge are formed per block of this many hits
+// and the blocks are combined in order, so a bright sensor can be reduced
+// block by block on several threads with the same result as on one.
+constexpr std::size_t kSensorBlockHits = std::size_t(1) << 14;
+
+// Sensors with at least this many hits (in an event with more than one
+// worker) are sorted and reduced on several threads rather than on one.
+constexpr std::size_t kParallelSensorHits = 4 * kSensorBlockHits;
+
+// ---------------------------------------------------------------------------
+// Scratch arena
+//
+// Kernel temporaries (per-sensor hit slices, sort permutations, running charges,
+// event layouts) are carved from a per-thread bump arena rather than the heap.
+// ScratchScope releases them in LIFO order. When the outermost scope closes, an
+// arena that had to chain several blocks coalesces them into one block of the
+// combined size, so repeated calls of similar size stop touching the heap.
+// ---------------------------------------------------------------------------
+
+// Heap blocks obtained by all scratch arenas; flat once the workload is warm.
+std::atomic<std::size_t> g_scratch_allocations{0};
+
+class ScratchArena {
+public:
+    struct Mark {
+        std::size_t block;
+        std::size_t offset;
+    };
+
+    ScratchArena() = default;
+    ~ScratchArena() { release_blocks(); }
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    Mark mark() const { return {current_, offset_}; }
+
+    // Release everything allocated since `mark` was taken.
+    void rewind(const Mark& mark) {
+        current_ = mark.block;
+        offset_ = mark.offset;
+        if (current_ == 0 && offset_ == 0 && n_blocks_ > 1) {
+            coalesce();
+        }
+    }
+
+    // Uninitialized storage for n objects of type T, aligned to kAlignment.
+    template<typename T>
+    T* allocate(std::size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+                      "scratch storage holds plain data only");
+        static_assert(alignof(T) <= kAlignment, "over-aligned scratch type");
+        return static_cast<T*>(allocate_bytes(n * sizeof(T)));
+    }
+
+private:
+    static constexpr std::size_t kAlignment = 64;
+    static constexpr std::size_t kMinBlockBytes = std::size_t(64) << 10;
+    static constexpr std::size_t kMaxBlocks = 48;  // blocks at least double, so this is never reached
+
+    struct Block {
+        unsigned char* data = nullptr;
+        std::size_t size = 0;
+    };
+
+    void* allocate_bytes(std::size_t bytes) {
+        bytes = (std::max<std::size_t>(bytes, 1) + kAlignment - 1) & ~(kAlignment - 1);
+        if (current_ < n_blocks_ && blocks_[current_].size - offset_ >= bytes) {
+            void* ptr = blocks_[current_].data + offset_;
+            offset_ += bytes;
+            return ptr;
+        }
+        // Move on to the next block, reusing it when it is large enough.
+        // Blocks past the current one hold nothing live.
+        const std::size_t next = (current_ < n_blocks_ && offset_ > 0) ? current_ + 1 : current_;
+        if (next >= n_blocks_ || blocks_[next].size < bytes) {
+            if (next >= kMaxBlocks) {
+                throw std::bad_alloc();
+            }
+            const std::size_t size = std::max({bytes, kMinBlockBytes, 2 * total_bytes()});
+            free_block(blocks_[next]);
+            blocks_[next] = new_block(size);
+            n_blocks_ = std::max(n_blocks_, next + 1);
+        }
+        current_ = next;
+        offset_ = bytes;
+        return blocks_[next].data;
+    }
+
+    std::size_t total_bytes() const {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < n_blocks_; ++i) total += blocks_[i].size;
+        return total;
+    }
+
+    void coalesce() {
+        const std::size_t total = total_bytes();
+        release_blocks();
+        blocks_[0] = new_block(total);
+        n_blocks_ = 1;
+    }
+
+    void release_blocks() {
+        for (std::size_t i = 0; i < n_blocks_; ++i) free_block(blocks_[i]);
+        n_blocks_ = 0;
+    }
+
+    static Block new_block(std::size_t size) {
+        Block block;
+        block.data = static_cast<unsigned char*>(::operator new(size, std::align_val_t(kAlignment)));
+        block.size = size;
+        g_scratch_allocations.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+
+    static void free_block(Block& block) {
+        if (block.data != nullptr) {
+            ::operator delete(block.data, std::align_val_t(kAlignment));
+        }
+        block = Block{};
+    }
+
+    std::array<Block, kMaxBlocks> blocks_{};
+    std::size_t n_blocks_ = 0;
+    std::size_t current_ = 0;  // block being filled (== n_blocks_ before the first allocation)
+    std::size_t offset_ = 0;   // bytes used in the current block
+};
+
+ScratchArena& thread_arena() {
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+// Releases every allocation made from `arena` during its lifetime.
+class ScratchScope {
+public:
+    explicit ScratchScope(ScratchArena& arena) : arena_(arena), mark_(arena.mark()) {}
+    ~ScratchScope() { arena_.rewind(mark_); }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+private:
+    ScratchArena& arena_;
+    const ScratchArena::Mark mark_;
+};
+
+std::size_t scratch_allocations() {
+    return g_scratch_allocations.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+bool is_sorted(const T* values, std::size_t n) {
+    for (std::size_t i = 1; i < n; ++i) {
+        if (values[i - 1] > values[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write the hits in stable time order into sorted_times / sorted_charges,
+// widening them to double as they are copied. Unit charges (charges == nullptr) leave
+// only the times to sort.
+template<typename Time, typename Charge>
+void sort_by_time(
+    const Time* times,
+    const Charge* charges,
+    std::size_t n,
+    double* sorted_times,
+    double* sorted_charges,
+    ScratchArena& arena) {
+    if (charges == nullptr) {
+        std::copy(times, times + n, sorted_times);
+        std::sort(sorted_times, sorted_times + n);
+        return;
+    }
+    ScratchScope scope(arena);
+    std::size_t* order = arena.allocate<std::size_t>(n);
+    std::iota(order, order + n, 0);
+    // Equal times keep their input order: the charge sums depend on the order
+    // the charges are added in, and PartialStats / the event paths sort stably.
+    std::sort(order, order + n, [&](std::size_t a, std::size_t b) {
+        if (times[a] != times[b]) {
+            return times[a] < times[b];
+        }
+        return a < b;
+    });
+    for (std::size_t i = 0; i < n; ++i) {
+        sorted_times[i] = static_cast<double>(times[order[i]]);
+        sorted_charges[i] = static_cast<double>(charges[order[i]]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// First-pass kernels
+//
+// The per-hit sums (charge and charge-weighted time moments) and the maximum
+// charge are accumulated in eight interleaved lanes: hit i
+// goes to lane i % 8, and the lanes are combined by a fixed pairwise tree.
+// The SSE2, AVX2 and AVX-512 kernels fill the lanes two, four or eight at a
+// time and the scalar kernel one at a time, so every ISA gives bit-identical
+// results. The kernel is chosen once, at import, from the CPU features; the
+// NTSS_SIMD environment variable can cap the choice (scalar, sse2, avx2).
+//
+// Every kernel is instantiated for each set of accumulators (a bitmask of
+// Accumulator values), so a plan that needs only some of the sums runs a
+// kernel that computes only those. Hits without charges (photon-level
+// simulation) run the kUnitCharge instantiations, which never read a charge:
+// the charge sum becomes a count and the moments become plain time moments,
+// with the same results as an array of ones would give.
+// ---------------------------------------------------------------------------
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NTSS_VECTOR_KERNELS 1
+#define NTSS_ALWAYS_INLINE inline __attribute__((always_inline))
+#if defined(__x86_64__) || defined(__i386__)
+#define NTSS_X86_DISPATCH 1
+#endif
+#else
+#define NTSS_ALWAYS_INLINE inline
+#endif
+
+constexpr std::size_t kLanes = 8;
+
+enum Accumulator : unsigned {
+    kAccCharge = 1u << 0,        // sum(q)
+    kAccMoments = 1u << 1,       // sum(q t), sum(q t^2)
+    kAccThirdMoment = 1u << 2,   // sum(q t^3)
+    kAccMaxCharge = 1u << 3,     // max(q), floored at 0
+    kUnitCharge = 1u << 4,       // every charge is 1; the charges are not read
+};
+constexpr unsigned kNumAccumulatorSets = 32;
+
+// The charges pointer of hits [k, ...); stays null for unit charges.
+inline const double* charges_from(const double* charges, std::size_t k) {
+    return charges != nullptr ? charges + k : nullptr;
+}
+
+struct FirstPassLanes {
+    double charge[kLanes];
+    double qt[kLanes];
+    double qt2[kLanes];
+    double qt3[kLanes];
+    double max_charge[kLanes];
+};
+
+// Sums not in the kernel's accumulator set stay zero.
+struct FirstPassSums {
+    double total_charge = 0.0;
+    double sum_qt = 0.0;
+    double sum_qt2 = 0.0;
+    double sum_qt3 = 0.0;
+    double max_charge = 0.0;
+};
+
+using FirstPassKernel = FirstPassSums (*)(const double*, const double*, std::size_t);
+
+// Add hit (t, q) to one lane. The vector kernels perform the same operations.
+template<unsigned Acc>
+NTSS_ALWAYS_INLINE void accumulate_hit(FirstPassLanes& lanes, std::size_t lane, double t, double q) {
+    if constexpr ((Acc & kAccCharge) != 0) {
+        lanes.charge[lane] += q;
+    }
+    if constexpr ((Acc & (kAccMoments | kAccThirdMoment)) != 0) {
+        const double qt = (Acc & kUnitCharge) != 0 ? t : q * t;
+        const double qt2 = qt * t;
+        if constexpr ((Acc & kAccMoments) != 0) {
+            lanes.qt[lane] += qt;
+            lanes.qt2[lane] += qt2;
+        }
+        if constexpr ((Acc & kAccThirdMoment) != 0) {
+            lanes.qt3[lane] += qt2 * t;
+        }
+    }
+    if constexpr ((Acc & kAccMaxCharge) != 0) {
+        lanes.max_charge[lane] = q > lanes.max_charge[lane] ? q : lanes.max_charge[lane];
+    }
+}
+
+// Pairwise combination of the lanes: ((l0 + l4) + (l2 + l6)) + ((l1 + l5) + (l3 + l7)).
+NTSS_ALWAYS_INLINE double reduce_lanes(const double (&lanes)[kLanes]) {
+    return ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+}
+
+template<unsigned Acc>
+NTSS_ALWAYS_INLINE FirstPassSums reduce_first_pass(const FirstPassLanes& lanes) {
+    FirstPassSums sums;
+    if constexpr ((Acc & kAccCharge) != 0) {
+        sums.total_charge = reduce_lanes(lanes.charge);
+    }
+    if constexpr ((Acc & kAccMoments) != 0) {
+        sums.sum_qt = reduce_lanes(lanes.qt);
+        sums.sum_qt2 = reduce_lanes(lanes.qt2);
+    }
+    if constexpr ((Acc & kAccThirdMoment) != 0) {
+        sums.sum_qt3 = reduce_lanes(lanes.qt3);
+    }
+    if constexpr ((Acc & kAccMaxCharge) != 0) {
+        for (const double m : lanes.max_charge) {
+            sums.max_charge = m > sums.max_charge ? m : sums.max_charge;
+        }
+    }
+    return sums;
+}
+
+// Accumulate all n hits, one hit at a time.
+template<unsigned Acc>
+FirstPassSums first_pass_scalar(
+    const double* times,
+    const double* charges,
+    std::size_t n) {
+    FirstPassLanes lanes{};
+    for (std::size_t i = 0; i < n; ++i) {
+        accumulate_hit<Acc>(lanes, i % kLanes, times[i], (Acc & kUnitCharge) != 0 ? 1.0 : charges[i]);
+    }
+    return reduce_first_pass<Acc>(lanes);
+}
+
+#ifdef NTSS_VECTOR_KERNELS
+template<std::size_t Width>
+struct VectorTypes {
+    typedef double Float __attribute__((vector_size(8 * Width)));
+    typedef int64_t Mask __attribute__((vector_size(8 * Width)));
+};
+
+template<typename Vec>
+NTSS_ALWAYS_INLINE void load_vector(Vec& v, const double* ptr) {
+    std::memcpy(&v, ptr, sizeof(Vec));
+}
+
+template<typename Vec>
+NTSS_ALWAYS_INLINE void store_vector(double* ptr, const Vec& v) {
+    std::memcpy(ptr, &v, sizeof(Vec));
+}
+
+// Accumulate all n hits: full blocks of kLanes hits Width lanes per vector,
+// the remainder one hit at a time. Inlined into the ISA-specific wrappers
+// below, which set the instruction set.
+template<std::size_t Width, unsigned Acc>
+NTSS_ALWAYS_INLINE FirstPassSums first_pass_vector(
+    const double* times,
+    const double* charges,
+    std::size_t n) {
+    using Float = typename VectorTypes<Width>::Float;
+    using Mask = typename VectorTypes<Width>::Mask;
+    constexpr std::size_t R = kLanes / Width;  // vectors per accumulator
+
+    Float charge[R] = {}, qt[R] = {}, qt2[R] = {}, qt3[R] = {}, max_charge[R] = {};
+    const Float ones = Float{} + 1.0;
+
+    const std::size_t n_full = n - n % kLanes;
+    for (std::size_t i = 0; i < n_full; i += kLanes) {
+        for (std::size_t r = 0; r < R; ++r) {
+            Float t, q = ones;
+            load_vector(t, times + i + r * Width);
+            if constexpr ((Acc & kUnitCharge) == 0) {
+                load_vector(q, charges + i + r * Width);
+            }
+            if constexpr ((Acc & kAccCharge) != 0) {
+                charge[r] += q;
+            }
+            if constexpr ((Acc & (kAccMoments | kAccThirdMoment)) != 0) {
+                Float x = t;
+                if constexpr ((Acc & kUnitCharge) == 0) {
+                    x = q * t;
+                }
+                const Float x2 = x * t;
+                if constexpr ((Acc & kAccMoments) != 0) {
+                    qt[r] += x;
+                    qt2[r] += x2;
+                }
+                if constexpr ((Acc & kAccThirdMoment) != 0) {
+                    qt3[r] += x2 * t;
+                }
+            }
+            if constexpr ((Acc & kAccMaxCharge) != 0) {
+                const Mask greater = q > max_charge[r];
+                max_charge[r] = (Float)(((Mask)q & greater) | ((Mask)max_charge[r] & ~greater));
+            }
+        }
+    }
+
+    FirstPassLanes lanes;
+    for (std::size_t r = 0; r < R; ++r) {
+        store_vector(lanes.charge + r * Width, charge[r]);
+        store_vector(lanes.qt + r * Width, qt[r]);
+        store_vector(lanes.qt2 + r * Width, qt2[r]);
+        store_vector(lanes.qt3 + r * Width, qt3[r]);
+        store_vector(lanes.max_charge + r * Width, max_charge[r]);
+    }
+    for (std::size_t i = n_full; i < n; ++i) {
+        accumulate_hit<Acc>(lanes, i - n_full, times[i], (Acc & kUnitCharge) != 0 ? 1.0 : charges[i]);
+    }
+    return reduce_first_pass<Acc>(lanes);
+}
+#endif
+
+#ifdef NTSS_X86_DISPATCH
+template<unsigned Acc>
+__attribute__((target("sse2"))) FirstPassSums first_pass_sse2(
+    const double* times, const double* charges, std::size_t n) {
+    return first_pass_vector<2, Acc>(times, charges, n);
+}
+
+template<unsigned Acc>
+__attribute__((target("avx2"))) FirstPassSums first_pass_avx2(
+    const double* times, const double* charges, std::size_t n) {
+    return first_pass_vector<4, Acc>(times, charges, n);
+}
+
+template<unsigned Acc>
+__attribute__((target("avx512f"))) FirstPassSums first_pass_avx512(
+    const double* times, const double* charges, std::size_t n) {
+    return first_pass_vector<8, Acc>(times, charges, n);
+}
+#elif defined(NTSS_VECTOR_KERNELS) && (defined(__aarch64__) || defined(__ARM_NEON))
+template<unsigned Acc>
+FirstPassSums first_pass_neon(
+    const double* times, const double* charges, std::size_t n) {
+    return first_pass_vector<2, Acc>(times, charges, n);
+}
+#endif
+
+using FirstPassTable = std::array<FirstPassKernel, kNumAccumulatorSets>;
+
+// One kernel per accumulator set; make(std::integral_constant<unsigned, Acc>)
+// returns the kernel for set Acc.
+template<typename Make, std::size_t... Acc>
+auto first_pass_table(Make make, std::index_sequence<Acc...>) {
+    using Kernel = decltype(make(std::integral_constant<unsigned, 0>{}));
+    return std::array<Kernel, kNumAccumulatorSets>{make(std::integral_constant<unsigned, Acc>{})...};
+}
+
+template<typename Make>
+auto first_pass_table(Make make) {
+    return first_pass_table(make, std::make_index_sequence<kNumAccumulatorSets>{});
+}
+
+struct FirstPassKernels {
+    const char* isa;
+    FirstPassTable kernels;
+};
+
+FirstPassKernels select_first_pass_kernels() {
+    const FirstPassKernels scalar{
+        "scalar", first_pass_table([](auto acc) -> FirstPassKernel { return &first_pass_scalar<acc>; })};
+    const char* requested = std::getenv("NTSS_SIMD");
+    const std::string cap = requested != nullptr ? requested : "";
+    if (cap == "scalar") {
+        return scalar;
+    }
+#ifdef NTSS_X86_DISPATCH
+    __builtin_cpu_init();
+    if (cap != "sse2" && cap != "avx2" && __builtin_cpu_supports("avx512f")) {
+        return {"avx512", first_pass_table([](auto acc) -> FirstPassKernel { return &first_pass_avx512<acc>; })};
+    }
+    if (cap != "sse2" && __builtin_cpu_supports("avx2")) {
+        return {"avx2", first_pass_table([](auto acc) -> FirstPassKernel { return &first_pass_avx2<acc>; })};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {"sse2", first_pass_table([](auto acc) -> FirstPassKernel { return &first_pass_sse2<acc>; })};
+    }
+#elif defined(NTSS_VECTOR_KERNELS) && (defined(__aarch64__) || defined(__ARM_NEON))
+    return {"neon", first_pass_table([](auto acc) -> FirstPassKernel { return &first_pass_neon<acc>; })};
+#endif
+    return scalar;
+}
+
+const FirstPassKernels& first_pass_kernels() {
+    static const FirstPassKernels kernels = select_first_pass_kernels();
+    return kernels;
+}
+
+const char* simd_isa() {
+    return first_pass_kernels().isa;
+}
+
+// reduce_lanes over 1 <= n < kLanes lanes holding one hit each. The empty
+// lanes are zero and drop out of the tree; the final + 0.0 turns a -0.0 sum
+// into the +0.0 the zero-initialised lanes would give.
+NTSS_ALWAYS_INLINE double reduce_hits(const double* v, std::size_t n) {
+    const auto pair = [&](std::size_t a, std::size_t b) { return b < n ? v[a] + v[b] : v[a]; };
+    const double even = n > 2 ? pair(0, 4) + pair(2, 6) : pair(0, 4);
+    if (n == 1) {
+        return even + 0.0;
+    }
+    const double odd = n > 3 ? pair(1, 5) + pair(3, 7) : pair(1, 5);
+    return (even + odd) + 0.0;
+}
+
+// First pass for fewer than kLanes hits, without the lane arrays.
+template<unsigned Acc>
+FirstPassSums first_pass_small(const double* times, const double* charges, std::size_t n) {
+    double q_[kLanes], qt[kLanes], qt2[kLanes], qt3[kLanes];
+    FirstPassSums sums;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double t = times[i];
+        const double q = (Acc & kUnitCharge) != 0 ? 1.0 : charges[i];
+        q_[i] = q;
+        qt[i] = (Acc & kUnitCharge) != 0 ? t : q * t;
+        qt2[i] = qt[i] * t;
+        qt3[i] = qt2[i] * t;
+        if constexpr ((Acc & kAccMaxCharge) != 0) {
+            sums.max_charge = q > sums.max_charge ? q : sums.max_charge;
+        }
+    }
+    if constexpr ((Acc & kAccCharge) != 0) {
+        sums.total_charge = reduce_hits(q_, n);
+    }
+    if constexpr ((Acc & kAccMoments) != 0) {
+        sums.sum_qt = reduce_hits(qt, n);
+        sums.sum_qt2 = reduce_hits(qt2, n);
+    }
+    if constexpr ((Acc & kAccThirdMoment) != 0) {
+        sums.sum_qt3 = reduce_hits(qt3, n);
+    }
+    return sums;
+}
+
+// Sums over at most kSensorBlockHits hits, for the accumulator set `accumulators`
+// (with kUnitCharge, `charges` is not read and may be null).
+FirstPassSums first_pass_block(unsigned accumulators, const double* times, const double* charges, std::size_t n) {
+    if (n > 0 && n < kLanes) {
+        static const FirstPassTable small =
+            first_pass_table([](auto acc) -> FirstPassKernel { return &first_pass_small<acc>; });
+        return small[accumulators](times, charges, n);
+    }
+    return first_pass_kernels().kernels[accumulators](times, charges, n);
+}
+
+// Fold the sums of the next block into the sums of the blocks before it.
+inline void add_block_sums(FirstPassSums& sums, const FirstPassSums& block) {
+    sums.total_charge += block.total_charge;
+    sums.sum_qt += block.sum_qt;
+    sums.sum_qt2 += block.sum_qt2;
+    sums.sum_qt3 += block.sum_qt3;
+    sums.max_charge = block.max_charge > sums.max_charge ? block.max_charge : sums.max_charge;
+}
+
+// Sums over the hits of one sensor, block by block.
+FirstPassSums first_pass(unsigned accumulators, const double* times, const double* charges, std::size_t n) {
+    FirstPassSums sums = first_pass_block(accumulators, times, charges, std::min(n, kSensorBlockHits));
+    for (std::size_t begin = kSensorBlockHits; begin < n; begin += kSensorBlockHits) {
+        const std::size_t size = std::min(n - begin, kSensorBlockHits);
+        add_block_sums(sums, first_pass_block(accumulators, times + begin, charges_from(charges, begin), size));
+    }
+    return sums;
+}
+
+// The first pass fed one hit at a time, for hits that arrive as a stream.
+template<unsigned Acc>
+class StreamingFirstPass {
+public:
+    void add(double t, double q) {
+        accumulate_hit<Acc>(lanes_, count_ % kLanes, t, q);
+        if (++count_ % kSensorBlockHits == 0) {
+            const FirstPassSums block = reduce_first_pass<Acc>(lanes_);
+            if (count_ == kSensorBlockHits) {
+                sums_ = block;
+            } else {
+                add_block_sums(sums_, block);
+            }
+            lanes_ = FirstPassLanes{};
+        }
+    }
+
+    // The sums first_pass gives for the hits added so far.
+    FirstPassSums sums() const {
+        if (count_ % kSensorBlockHits == 0 && count_ > 0) {
+            return sums_;
+        }
+        const FirstPassSums partial = reduce_first_pass<Acc>(lanes_);
+        if (count_ < kSensorBlockHits) {
+            return partial;
+        }
+        FirstPassSums sums = sums_;
+        add_block_sums(sums, partial);
+        return sums;
+    }
+
+private:
+    FirstPassLanes lanes_{};
+    FirstPassSums sums_;
+    std::size_t count_ = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Charge windows and percentile times
+//
+// Both read a cumulative-charge array built in one pass over the time-ordered
+// hits: the charge within a window is the cumulative charge at the window's
+// upper_bound in time, and a percentile time is the time of the first hit
+// whose cumulative charge exceeds the threshold. Each lookup is a binary
+// search, so adding windows or percentiles does not add passes over the hits.
+// ---------------------------------------------------------------------------
+
+// The running charge of time-ordered hits, one hit at a time. It is summed hit
+// by hit within each block of kSensorBlockHits hits; a later block adds its
+// running charge to the running charge at the end of the block before it.
+class RunningCharge {
+public:
+    void add(double q) {
+        if (count_ > 0 && count_ % kSensorBlockHits == 0) {
+            offset_ = count_ == kSensorBlockHits ? local_ : offset_ + local_;
+            local_ = 0.0;
+        }
+        local_ += q;
+        ++count_;
+    }
+
+    double value() const { return count_ <= kSensorBlockHits ? local_ : offset_ + local_; }
+
+private:
+    double offset_ = 0.0;
+    double local_ = 0.0;
+    std::size_t count_ = 0;
+};
+
+// Running charge of hits [begin, end), starting from zero, into cumulative.
+// Returns whether none of the charges is negative or NaN.
+inline bool block_running_charge(const double* charges, std::size_t begin, std::size_t end, double* cumulative) {
+    double running = 0.0;
+    bool non_negative = true;
+    for (std::size_t i = begin; i < end; ++i) {
+        running += charges[i];
+        cumulative[i] = running;
+        non_negative &= charges[i] >= 0.0;
+    }
+    return non_negative;
+}
+
+// Offset the running charge of one block by that at the end of the block before.
+inline void add_block_offset(double* cumulative, std::size_t begin, std::size_t end, double offset) {
+    for (std::size_t i = begin; i < end; ++i) {
+        cumulative[i] = offset + cumulative[i];
+    }
+}
+
+// Running charge of the time-ordered hits: element i is the charge of hits
+// [0, i], as RunningCharge sums it. A percentile time is therefore the same
+// hit a scan of the running charge would stop at. With non-negative charges
+// the running charge never decreases, which is what lets the lookups binary
+// search it.
+class CumulativeCharge {
+public:
+    CumulativeCharge(const double* times, const double* charges, std::size_t n, ScratchArena& arena)
+        : times_(times), n_(n) {
+        double* cumulative = arena.allocate<double>(n);
+        bool non_negative = true;
+        for (std::size_t begin = 0; begin < n; begin += kSensorBlockHits) {
+            const std::size_t end = std::min(n, begin + kSensorBlockHits);
+            non_negative &= block_running_charge(charges, begin, end, cumulative);
+            if (begin > 0) {
+                add_block_offset(cumulative, begin, end, cumulative[begin - 1]);
+            }
+        }
+        cumulative_ = cumulative;
+        monotone_ = non_negative;
+    }
+
+    // A running charge already summed hit by hit; `monotone` if no charge was
+    // negative or NaN.
+    CumulativeCharge(const double* times, const double* cumulative, std::size_t n, bool monotone)
+        : times_(times), cumulative_(cumulative), n_(n), monotone_(monotone) {}
+
+    // Unit charges: the running charge at hit i is i + 1, exactly, so nothing
+    // is stored, window charges are hit counts and a percentile is an index.
+    CumulativeCharge(const double* times, std::size_t n) : times_(times), n_(n) {}
+
+    // Charge of the hits with time <= cutoffs[k], for ascending cutoffs. A
+    // cutoff past the last hit gives total_charge, the first pass's (pairwise)
+    // sum, rather than the running charge's last element, so a window that
+    // covers every hit reports exactly the total_charge column.
+    void charges_until(const double* cutoffs, std::size_t count, double total_charge, double* charges) const {
+        const double* begin = times_;
+        for (std::size_t k = 0; k < count; ++k) {
+            begin = std::upper_bound(begin, times_ + n_, cutoffs[k]);
+            const auto end = static_cast<std::size_t>(begin - times_);
+            if (end == n_) {
+                charges[k] = total_charge;
+            } else if (cumulative_ == nullptr) {
+                charges[k] = static_cast<double>(end);
+            } else {
+                charges[k] = end > 0 ? cumulative_[end - 1] : 0.0;
+            }
+        }
+    }
+
+    // Time of the first hit at which the running charge exceeds thresholds[k],
+    // or `otherwise` if it never does. Negative or NaN charges make the running
+    // charge non-monotone; it is then scanned from the start instead. The
+    // thresholds are fractions of the pairwise total_charge while the running
+    // charge is summed hit by hit, so the two may differ in the last bits and a
+    // fraction close enough to 1 may never be exceeded (the NumPy
+    // implementation compares np.cumsum with np.sum alike).
+    void times_exceeding(const double* thresholds, std::size_t count, double otherwise, double* times) const {
+        for (std::size_t k = 0; k < count; ++k) {
+            const double threshold = thresholds[k];
+            if (cumulative_ == nullptr) {
+                // First i with i + 1 > threshold.
+                std::size_t i = n_;
+                if (threshold < static_cast<double>(n_)) {
+                    i = threshold < 0.0 ? 0 : static_cast<std::size_t>(threshold);
+                }
+                times[k] = i < n_ ? times_[i] : otherwise;
+                continue;
+            }
+            const double* reached;
+            if (monotone_) {
+                reached = std::upper_bound(cumulative_, cumulative_ + n_, threshold);
+            } else {
+                reached = std::find_if(cumulative_, cumulative_ + n_, [&](double c) { return c > threshold; });
+            }
+            const auto i = static_cast<std::size_t>(reached - cumulative_);
+            times[k] = i < n_ ? times_[i] : otherwise;
+        }
+    }
+
+private:
+    const double* times_;
+    const double* cumulative_ = nullptr;
+    std::size_t n_;
+    bool monotone_ = true;
+};
+
+// ---------------------------------------------------------------------------
+// Statistic plans
+//
+// A StatPlan lists the output columns of every sensor row. It is compiled once
+// into the quantities the kernels evaluate: window widths and charge fractions
+// in ascending order (as the lookups want them), the first-pass accumulators
+// the columns read, and for each output column where its value comes from. The
+// kernels only consult the plan per sensor, never per hit. The standard and
+// extended layouts are built-in plans; select() builds a plan from column
+// names, in the order given.
+// ---------------------------------------------------------------------------
+
+enum class Stat : uint8_t {
+    TotalCharge,
+    WindowCharge,  // charge within `value` ns of the first pulse
+    FirstTime,
+    LastTime,
+    QuantileTime,  // time at which a fraction `value` of the charge is collected
+    MeanTime,
+    StdTime,
+    NPulses,
+    QMaxFrac,
+    StringNeighbors,
+    Skewness,
+};
 
-template<std::size_t N>
-std::array<double, N> empty_stats() {
-    std::array<double, N> stats{};
-    stats.fill(0.0);
-    return stats;
+struct StatColumn {
+    Stat stat;
+    double value = 0.0;  // window width or charge fraction
+};
+
+class StatPlan {
+public:
+    // Columns total_charge, first_pulse_time, last_pulse_time, one charge
+    // window per width, one quantile time per fraction, then the optional groups.
+    StatPlan(const std::vector<double>& windows,
+             const std::vector<double>& quantiles,
+             bool moments,
+             bool n_pulses,
+             bool q_max_frac,
+             bool neighbors,
+             bool skewness) {
+        std::vector<StatColumn> columns = {{Stat::TotalCharge}, {Stat::FirstTime}, {Stat::LastTime}};
+        for (const double width : windows) columns.push_back({Stat::WindowCharge, width});
+        for (const double fraction : quantiles) columns.push_back({Stat::QuantileTime, fraction});
+        if (moments) {
+            columns.push_back({Stat::MeanTime});
+            columns.push_back({Stat::StdTime});
+        }
+        if (n_pulses) columns.push_back({Stat::NPulses});
+        if (q_max_frac) columns.push_back({Stat::QMaxFrac});
+        if (neighbors) columns.push_back({Stat::StringNeighbors});
+        if (skewness) columns.push_back({Stat::Skewness});
+        compile(columns);
+    }
+
+    explicit StatPlan(const std::vector<StatColumn>& columns) { compile(columns); }
+
+    // A plan with the named columns, in the given order. Names are those of
+    // names(): the fixed column names, charge_<w>ns and charge_<p>_percent_time.
+    static StatPlan select(const std::vector<std::string>& names) {
+        if (names.empty()) {
+            throw std::invalid_argument("a plan must select at least one column");
+        }
+        std::vector<StatColumn> columns;
+        columns.reserve(names.size());
+        for (const std::string& name : names) {
+            columns.push_back(parse_column(name));
+        }
+        return StatPlan(columns);
+    }
+
+    // The 9-column layout.
+    static const StatPlan& standard() {
+        static const StatPlan plan({
+            {Stat::TotalCharge}, {Stat::WindowCharge, 100.0}, {Stat::WindowCharge, 500.0},
+            {Stat::FirstTime}, {Stat::LastTime},
+            {Stat::QuantileTime, 0.2}, {Stat::QuantileTime, 0.5},
+            {Stat::MeanTime}, {Stat::StdTime},
+        });
+        return plan;
+    }
+
+    // The 25-column layout: the standard columns, then the extended ones.
+    static const StatPlan& extended() {
+        static const StatPlan plan({
+            {Stat::TotalCharge}, {Stat::WindowCharge, 100.0}, {Stat::WindowCharge, 500.0},
+            {Stat::FirstTime}, {Stat::LastTime},
+            {Stat::QuantileTime, 0.2}, {Stat::QuantileTime, 0.5},
+            {Stat::MeanTime}, {Stat::StdTime},
+            {Stat::QuantileTime, 0.05}, {Stat::QuantileTime, 0.1}, {Stat::QuantileTime, 0.25},
+            {Stat::QuantileTime, 0.75}, {Stat::QuantileTime, 0.9}, {Stat::QuantileTime, 0.95},
+            {Stat::WindowCharge, 10.0}, {Stat::WindowCharge, 20.0}, {Stat::WindowCharge, 50.0},
+            {Stat::WindowCharge, 200.0}, {Stat::WindowCharge, 1000.0}, {Stat::WindowCharge, 2000.0},
+            {Stat::NPulses}, {Stat::QMaxFrac}, {Stat::StringNeighbors}, {Stat::Skewness},
+        });
+        return plan;
+    }
+
+    static const StatPlan& preset(bool extended) { return extended ? StatPlan::extended() : standard(); }
+
+    std::size_t num_stats() const { return columns_.size(); }
+    const std::vector<StatColumn>& columns() const { return columns_; }
+    const std::vector<std::string>& names() const { return names_; }
+
+    // Ascending, distinct window widths and charge fractions to evaluate;
+    // columns_[c] reads slot source_[c] of the evaluated windows or quantiles.
+    const std::vector<double>& windows() const { return windows_; }
+    const std::vector<double>& quantiles() const { return quantiles_; }
+    std::size_t source(std::size_t column) const { return source_[column]; }
+
+    // Accumulator bitmask of the first pass the columns read from.
+    unsigned accumulators() const { return accumulators_; }
+
+    // Output column of n_pulses / n_string_neighbors, or -1 if not in the plan.
+    std::ptrdiff_t n_pulses_column() const { return n_pulses_column_; }
+    std::ptrdiff_t neighbors_column() const { return neighbors_column_; }
+
+private:
+    void compile(const std::vector<StatColumn>& columns) {
+        columns_ = columns;
+        for (const StatColumn& column : columns) {
+            if (column.stat == Stat::WindowCharge) {
+                if (!(column.value >= 0.0) || !std::isfinite(column.value)) {
+                    throw std::invalid_argument("charge window widths must be finite and non-negative");
+                }
+                windows_.push_back(column.value);
+            } else if (column.stat == Stat::QuantileTime) {
+                if (!(column.value > 0.0 && column.value < 1.0)) {
+                    throw std::invalid_argument("charge quantiles must lie strictly between 0 and 1");
+                }
+                quantiles_.push_back(column.value);
+            }
+        }
+        for (std::vector<double>* values : {&windows_, &quantiles_}) {
+            std::sort(values->begin(), values->end());
+            values->erase(std::unique(values->begin(), values->end()), values->end());
+        }
+
+        source_.assign(columns.size(), 0);
+        names_.clear();
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            const StatColumn& column = columns[c];
+            if (column.stat == Stat::WindowCharge) {
+                source_[c] = static_cast<std::size_t>(
+                    std::lower_bound(windows_.begin(), windows_.end(), column.value) - windows_.begin());
+            } else if (column.stat == Stat::QuantileTime) {
+                source_[c] = static_cast<std::size_t>(
+                    std::lower_bound(quantiles_.begin(), quantiles_.end(), column.value) - quantiles_.begin());
+            }
+            accumulators_ |= accumulators_for(column.stat);
+            if (column.stat == Stat::NPulses) n_pulses_column_ = static_cast<std::ptrdiff_t>(c);
+            if (column.stat == Stat::StringNeighbors) neighbors_column_ = static_cast<std::ptrdiff_t>(c);
+            names_.push_back(column_name(column));
+        }
+    }
+
+    static unsigned accumulators_for(Stat stat) {
+        switch (stat) {
+            case Stat::TotalCharge:
+            case Stat::WindowCharge:  // a window covering every hit reports total_charge
+            case Stat::QuantileTime: return kAccCharge;
+            case Stat::MeanTime:
+            case Stat::StdTime: return kAccCharge | kAccMoments;
+            case Stat::QMaxFrac: return kAccCharge | kAccMaxCharge;
+            case Stat::Skewness: return kAccCharge | kAccMoments | kAccThirdMoment;
+            default: return 0;
+        }
+    }
+
+    static StatColumn parse_column(const std::string& name) {
+        static const std::pair<const char*, Stat> fixed[] = {
+            {"total_charge", Stat::TotalCharge},
+            {"first_pulse_time", Stat::FirstTime},
+            {"last_pulse_time", Stat::LastTime},
+            {"charge_weighted_mean_time", Stat::MeanTime},
+            {"charge_weighted_std_time", Stat::StdTime},
+            {"n_pulses", Stat::NPulses},
+            {"q_max_frac", Stat::QMaxFrac},
+            {"n_string_neighbors", Stat::StringNeighbors},
+            {"t_skewness", Stat::Skewness},
+        };
+        for (const auto& [fixed_name, stat] : fixed) {
+            if (name == fixed_name) return {stat};
+        }
+        const std::string prefix = "charge_";
+        const std::string window_suffix = "ns";
+        const std::string quantile_suffix = "_percent_time";
+        const auto ends_with = [&](const std::string& suffix) {
+            return name.size() > prefix.size() + suffix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+                   name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        const auto number = [&](std::size_t suffix_size, double& value) {
+            const std::string text = name.substr(prefix.size(), name.size() - prefix.size() - suffix_size);
+            char* end = nullptr;
+            value = std::strtod(text.c_str(), &end);
+            return !text.empty() && std::isdigit(static_cast<unsigned char>(text[0])) &&
+                   text.find_first_not_of("0123456789.eE+-") == std::string::npos &&
+                   end == text.c_str() + text.size();
+        };
+        double value = 0.0;
+        if (ends_with(quantile_suffix) && number(quantile_suffix.size(), value)) {
+            return {Stat::QuantileTime, value / 100.0};
+        }
+        if (ends_with(window_suffix) && number(window_suffix.size(), value)) {
+            return {Stat::WindowCharge, value};
+        }
+        throw std::invalid_argument("unknown statistic column '" + name + "'");
+    }
+
+    static std::string format_number(double value) {
+        std::string text = std::to_string(value);
+        text.erase(text.find_last_not_of('0') + 1);
+        if (text.back() == '.') text.pop_back();
+        return text;
+    }
+
+    static std::string column_name(const StatColumn& column) {
+        switch (column.stat) {
+            case Stat::TotalCharge: return "total_charge";
+            case Stat::WindowCharge: return "charge_" + format_number(column.value) + "ns";
+            case Stat::FirstTime: return "first_pulse_time";
+            case Stat::LastTime: return "last_pulse_time";
+            case Stat::QuantileTime: return "charge_" + format_number(100.0 * column.value) + "_percent_time";
+            case Stat::MeanTime: return "charge_weighted_mean_time";
+            case Stat::StdTime: return "charge_weighted_std_time";
+            case Stat::NPulses: return "n_pulses";
+            case Stat::QMaxFrac: return "q_max_frac";
+            case Stat::StringNeighbors: return "n_string_neighbors";
+            case Stat::Skewness: return "t_skewness";
+        }
+        return "";
+    }
+
+    std::vector<StatColumn> columns_;
+    std::vector<std::string> names_;
+    std::vector<double> windows_;
+    std::vector<double> quantiles_;
+    std::vector<std::size_t> source_;
+    unsigned accumulators_ = 0;
+    std::ptrdiff_t n_pulses_column_ = -1;
+    std::ptrdiff_t neighbors_column_ = -1;
+};
+
+// The row of a sensor with a single hit.
+void write_single_hit_row(const StatPlan& plan, double time, double charge, double* row) {
+    const std::vector<StatColumn>& columns = plan.columns();
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        switch (columns[c].stat) {
+            case Stat::TotalCharge:
+            case Stat::WindowCharge: row[c] = charge; break;
+            case Stat::FirstTime:
+            case Stat::LastTime:
+            case Stat::QuantileTime:
+            case Stat::MeanTime: row[c] = time; break;
+            case Stat::NPulses:
+            case Stat::QMaxFrac: row[c] = 1.0; break;  // single pulse: max == total
+            case Stat::StdTime:
+            case Stat::StringNeighbors:  // filled by process_event
+            case Stat::Skewness: row[c] = 0.0; break;  // undefined for n < 3
+        }
+    }
+}
+
+// The charge of every plan window and the time of every plan quantile, looked
+// up in the running charge of hits starting at first_time.
+void evaluate_windows_and_quantiles(
+    const StatPlan& plan,
+    const CumulativeCharge& cumulative,
+    double first_time,
+    double total_charge,
+    ScratchArena& arena,
+    double* window_charge,
+    double* quantile_time) {
+    ScratchScope scope(arena);
+    const std::vector<double>& widths = plan.windows();
+    const std::vector<double>& fractions = plan.quantiles();
+    double* cutoffs = arena.allocate<double>(widths.size());
+    for (std::size_t w = 0; w < widths.size(); ++w) {
+        cutoffs[w] = first_time + widths[w];
+    }
+    double* thresholds = arena.allocate<double>(fractions.size());
+    for (std::size_t p = 0; p < fractions.size(); ++p) {
+        thresholds[p] = total_charge * fractions[p];
+    }
+    cumulative.charges_until(cutoffs, widths.size(), total_charge, window_charge);
+    cumulative.times_exceeding(thresholds, fractions.size(), first_time, quantile_time);
+}
+
+// The row of a sensor with n >= 2 time-ordered hits, from their first-pass sums
+// and the evaluated windows (plan.windows() order) and quantiles (plan.quantiles() order).
+void write_stats_row(
+    const StatPlan& plan,
+    const FirstPassSums& sums,
+    const double* window_charge,
+    const double* quantile_time,
+    double first_time,
+    double last_time,
+    std::size_t n,
+    double* row) {
+    const std::vector<StatColumn>& columns = plan.columns();
+    const double total_charge = sums.total_charge;
+
+    double weighted_mean = 0.0;
+    double weighted_std = 0.0;
+    if (total_charge > 0.0) {
+        weighted_mean = sums.sum_qt / total_charge;
+        const double variance = (sums.sum_qt2 / total_charge) - (weighted_mean * weighted_mean);
+        weighted_std = variance > 0.0 ? std::sqrt(variance) : 0.0;
+    }
+
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        double value = 0.0;
+        switch (columns[c].stat) {
+            case Stat::TotalCharge: value = total_charge; break;
+            case Stat::WindowCharge: value = window_charge[plan.source(c)]; break;
+            case Stat::FirstTime: value = first_time; break;
+            case Stat::LastTime: value = last_time; break;
+            case Stat::QuantileTime: value = quantile_time[plan.source(c)]; break;
+            case Stat::MeanTime: value = weighted_mean; break;
+            case Stat::StdTime: value = weighted_std; break;
+            case Stat::NPulses: value = static_cast<double>(n); break;
+            case Stat::QMaxFrac: value = total_charge > 0.0 ? sums.max_charge / total_charge : 0.0; break;
+            case Stat::StringNeighbors: break;  // filled by process_event
+            case Stat::Skewness:
+                // From raw moments.
+                if (n >= 3 && weighted_std > 0.0 && total_charge > 0.0) {
+                    const double mu = weighted_mean;
+                    const double e_x2 = sums.sum_qt2 / total_charge;
+                    const double e_x3 = sums.sum_qt3 / total_charge;
+                    const double sigma3 = weighted_std * weighted_std * weighted_std;
+                    value = (e_x3 - 3.0 * mu * e_x2 + 2.0 * mu * mu * mu) / sigma3;
+                }
+                break;
+        }
+        row[c] = value;
+    }
+}
+
+// Statistics of one sensor, evaluated for time-ordered hits per `plan`;
+// writes plan.num_stats() values to row. charges == nullptr means unit charges.
+void compute_stats_from_sorted(
+    const StatPlan& plan,
+    const double* times,
+    const double* charges,
+    std::size_t n,
+    ScratchArena& arena,
+    double* row) {
+    if (n == 0) {
+        std::fill(row, row + plan.num_stats(), 0.0);
+        return;
+    }
+    if (n == 1) {
+        write_single_hit_row(plan, times[0], charges != nullptr ? charges[0] : 1.0, row);
+        return;
+    }
+
+    // First pass: only the sums the plan's columns read.
+    const unsigned unit = charges == nullptr ? kUnitCharge : 0u;
+    const FirstPassSums sums = first_pass(plan.accumulators() | unit, times, charges, n);
+
+    // Window charges and quantile times from the cumulative charge.
+    ScratchScope scope(arena);
+    double* window_charge = arena.allocate<double>(plan.windows().size());
+    double* quantile_time = arena.allocate<double>(plan.quantiles().size());
+    if (!plan.windows().empty() || !plan.quantiles().empty()) {
+        const CumulativeCharge cumulative =
+            unit != 0 ? CumulativeCharge(times, n) : CumulativeCharge(times, charges, n, arena);
+        evaluate_windows_and_quantiles(plan, cumulative, times[0], sums.total_charge, arena,
+                                       window_charge, quantile_time);
+    }
+    write_stats_row(plan, sums, window_charge, quantile_time, times[0], times[n - 1], n, row);
+}
+
+// Calls visit(time, charge) for each non-empty window of `window_ns` over
+// time-sorted hits, in order: the time of its first hit and its summed charge
+// (its hit count when Unit, which does not read `charges`). Windows are
+// aligned to the first hit. Returns the number of windows.
+template<bool Unit, typename Visit>
+NTSS_ALWAYS_INLINE std::size_t for_each_group(
+    const double* times,
+    const double* charges,
+    std::size_t n,
+    double window_ns,
+    Visit&& visit) {
+    if (n == 0) {
+        return 0;
+    }
+    std::size_t n_groups = 0;
+
+    const double base_time = times[0];
+    double bin_time = times[0];
+    double bin_charge = Unit ? 1.0 : charges[0];
+    double current_bin_end = base_time + window_ns;  // end of current bin (exclusive)
+
+    for (std::size_t i = 1; i < n; ++i) {
+        const double time = times[i];
+        const double charge = Unit ? 1.0 : charges[i];
+        if (time < current_bin_end) {
+            bin_charge += charge;
+        } else {
+            // Finish the current non-empty bin.
+            visit(bin_time, bin_charge);
+            ++n_groups;
+            // Jump directly to the bin containing this time without iterating per empty bin.
+            const auto new_bin = static_cast<long long>(std::floor((time - base_time) / window_ns));
+            current_bin_end = base_time + (static_cast<double>(new_bin) + 1.0) * window_ns;
+            bin_time = time;
+            bin_charge = charge;
+        }
+    }
+
+    // Flush the final bin
+    visit(bin_time, bin_charge);
+    return n_groups + 1;
+}
+
+struct GroupedPass {
+    FirstPassSums sums;
+    std::size_t n_groups = 0;
+    double last_time = 0.0;
+    double first_charge = 0.0;
+};
+
+// First pass over the windows of for_each_group, fed straight into the lanes
+// (window g to lane g % 8, as first_pass would place it). The running charge
+// is tracked on the way, so the charge of every window cutoff (ascending) is
+// resolved in the same pass. kUnitCharge in Acc applies to the hits; the
+// windows carry their hit counts.
+template<unsigned Acc>
+GroupedPass grouped_first_pass(
+    const double* times,
+    const double* charges,
+    std::size_t n,
+    double window_ns,
+    const double* cutoffs,
+    std::size_t n_cutoffs,
+    double* window_charge) {
+    StreamingFirstPass<Acc & ~kUnitCharge> first_pass;
+    RunningCharge running;
+    GroupedPass pass;
+    std::size_t w = 0;
+    pass.n_groups = for_each_group<(Acc & kUnitCharge) != 0>(times, charges, n, window_ns, [&](double t, double q) {
+        for (; w < n_cutoffs && t > cutoffs[w]; ++w) {
+            window_charge[w] = running.value();
+        }
+        first_pass.add(t, q);
+        running.add(q);
+        pass.first_charge = pass.n_groups == 0 ? q : pass.first_charge;
+        pass.last_time = t;
+        ++pass.n_groups;
+    });
+    // Windows past the last group hold every hit: total_charge, as in
+    // CumulativeCharge::charges_until.
+    pass.sums = first_pass.sums();
+    for (; w < n_cutoffs; ++w) {
+        window_charge[w] = pass.sums.total_charge;
+    }
+    return pass;
+}
+
+using GroupedPassKernel = GroupedPass (*)(
+    const double*, const double*, std::size_t, double, const double*, std::size_t, double*);
+
+// Statistics of time-sorted hits grouped into windows of window_ns, without
+// materialising the grouped hits: one pass feeds the windows into the first-pass
+// lanes and the window charges, and a second, only if the plan has quantiles,
+// streams the windows again against the now known charge thresholds. The
+// results are those of compute_stats_from_sorted over the grouped hits.
+void compute_grouped_stats(
+    const StatPlan& plan,
+    const double* times,
+    const double* charges,
+    std::size_t n,
+    double window_ns,
+    ScratchArena& arena,
+    double* row) {
+    static const auto kernels =
+        first_pass_table([](auto acc) -> GroupedPassKernel { return &grouped_first_pass<acc>; });
+
+    ScratchScope scope(arena);
+    const std::vector<double>& widths = plan.windows();
+    const std::vector<double>& fractions = plan.quantiles();
+    const double first_time = times[0];
+    double* cutoffs = arena.allocate<double>(widths.size());
+    for (std::size_t w = 0; w < widths.size(); ++w) {
+        cutoffs[w] = first_time + widths[w];
+    }
+    double* window_charge = arena.allocate<double>(widths.size());
+    const unsigned unit = charges == nullptr ? kUnitCharge : 0u;
+    const GroupedPass pass = kernels[plan.accumulators() | unit](
+        times, charges, n, window_ns, cutoffs, widths.size(), window_charge);
+
+    if (pass.n_groups == 1) {
+        write_single_hit_row(plan, first_time, pass.first_charge, row);
+        return;
+    }
+
+    // Quantile times: the first window whose running charge exceeds each
+    // threshold. Thresholds are visited in ascending order (fractions are
+    // ascending, so this is reversed when the total charge is negative).
+    const double total_charge = pass.sums.total_charge;
+    const std::size_t n_quantiles = fractions.size();
+    double* quantile_time = arena.allocate<double>(n_quantiles);
+    if (n_quantiles > 0) {
+        const bool descending = total_charge < 0.0;
+        const auto slot = [&](std::size_t k) { return descending ? n_quantiles - 1 - k : k; };
+        RunningCharge running;
+        std::size_t k = 0;
+        const auto visit = [&](double t, double q) {
+            running.add(q);
+            for (; k < n_quantiles && running.value() > total_charge * fractions[slot(k)]; ++k) {
+                quantile_time[slot(k)] = t;
+            }
+        };
+        if (unit != 0) {
+            for_each_group<true>(times, charges, n, window_ns, visit);
+        } else {
+            for_each_group<false>(times, charges, n, window_ns, visit);
+        }
+        for (; k < n_quantiles; ++k) {
+            quantile_time[slot(k)] = first_time;
+        }
+    }
+    write_stats_row(plan, pass.sums, window_charge, quantile_time, first_time, pass.last_time, pass.n_groups, row);
+}
+
+// Statistics for one sensor whose hits are read in place: times as float32,
+// float64 or int64, charges as float32 or float64. Sorted float64 hits go
+// straight to the kernels; anything else is copied once into arena storage,
+// sorted and widened to double in the same pass. charges == nullptr means
+// unit charges, which are never materialised.
+template<typename Time, typename Charge>
+void compute_stats_single_sensor_impl(
+    const StatPlan& plan,
+    const Time* times,
+    const Charge* charges,
+    std::size_t n,
+    const std::optional<double>& grouping_window_ns,
+    ScratchArena& arena,
+    double* row) {
+    if (n == 0) {
+        std::fill(row, row + plan.num_stats(), 0.0);
+        return;
+    }
+
+    ScratchScope scope(arena);
+    const double* sorted_times = nullptr;
+    const double* sorted_charges = nullptr;
+    const bool sorted = is_sorted(times, n);
+    if constexpr (std::is_same<Time, double>::value && std::is_same<Charge, double>::value) {
+        if (sorted) {
+            sorted_times = times;
+            sorted_charges = charges;
+        }
+    }
+    if (sorted_times == nullptr) {
+        double* times_copy = arena.allocate<double>(n);
+        double* charges_copy = charges != nullptr ? arena.allocate<double>(n) : nullptr;
+        if (sorted) {
+            std::copy(times, times + n, times_copy);
+            if (charges != nullptr) {
+                std::copy(charges, charges + n, charges_copy);
+            }
+        } else {
+            sort_by_time(times, charges, n, times_copy, charges_copy, arena);
+        }
+        sorted_times = times_copy;
+        sorted_charges = charges_copy;
+    }
+
+    if (grouping_window_ns.has_value() && grouping_window_ns.value() > 0.0) {
+        compute_grouped_stats(plan, sorted_times, sorted_charges, n, grouping_window_ns.value(), arena, row);
+        return;
+    }
+
+    compute_stats_from_sorted(plan, sorted_times, sorted_charges, n, arena, row);
+}
+
+// ---------------------------------------------------------------------------
+// Streaming accumulation
+//
+// A SensorAccumulator takes the hits of one sensor in time order and keeps the
+// state compute_stats_from_sorted would build from the whole array: the
+// first-pass lanes and block sums (hit i still goes to lane i % 8) and the
+// running charge per hit. Adding a hit is O(1) amortized; a snapshot reduces the lanes and does
+// the window and quantile lookups, without revisiting the hits. Snapshots are
+// bit-identical to computing the statistics of all hits added so far.
+//
+// The lookups need every hit's time and running charge, so the state grows by
+// 16 bytes per hit for as long as the accumulator lives; reset() releases it.
+// ---------------------------------------------------------------------------
+
+class SensorAccumulator {
+public:
+    explicit SensorAccumulator(StatPlan plan) : plan_(std::move(plan)) {}
+
+    const StatPlan& plan() const { return plan_; }
+    std::size_t num_hits() const { return times_.size(); }
+
+    // Append hits whose times do not precede the last hit added; they are
+    // widened to double as they are taken in.
+    template<typename Time, typename Charge>
+    void add(const Time* times, const Charge* charges, std::size_t n) {
+        if (n == 0) {
+            return;
+        }
+        if (!is_sorted(times, n) || (!times_.empty() && static_cast<double>(times[0]) < times_.back())) {
+            throw std::invalid_argument("hits must be added in time order");
+        }
+        times_.reserve(times_.size() + n);
+        cumulative_.reserve(cumulative_.size() + n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto t = static_cast<double>(times[i]);
+            const double q = charges != nullptr ? static_cast<double>(charges[i]) : 1.0;
+            if (times_.empty()) {
+                first_charge_ = q;
+            }
+            first_pass_.add(t, q);
+            running_.add(q);
+            monotone_ &= q >= 0.0;
+            times_.push_back(t);
+            cumulative_.push_back(running_.value());
+        }
+    }
+
+    // Statistics of the hits added so far; writes plan().num_stats() values.
+    void snapshot(ScratchArena& arena, double* row) const {
+        const std::size_t n = times_.size();
+        if (n == 0) {
+            std::fill(row, row + plan_.num_stats(), 0.0);
+            return;
+        }
+        if (n == 1) {
+            write_single_hit_row(plan_, times_[0], first_charge_, row);
+            return;
+        }
+        const FirstPassSums sums = first_pass_.sums();
+        const CumulativeCharge cumulative(times_.data(), cumulative_.data(), n, monotone_);
+        ScratchScope scope(arena);
+        double* window_charge = arena.allocate<double>(plan_.windows().size());
+        double* quantile_time = arena.allocate<double>(plan_.quantiles().size());
+        evaluate_windows_and_quantiles(plan_, cumulative, times_[0], sums.total_charge, arena,
+                                       window_charge, quantile_time);
+        write_stats_row(plan_, sums, window_charge, quantile_time, times_[0], times_[n - 1], n, row);
+    }
+
+    void reset() {
+        first_pass_ = StreamingFirstPass<kAllAccumulators>{};
+        std::vector<double>().swap(times_);
+        std::vector<double>().swap(cumulative_);
+        running_ = RunningCharge{};
+        first_charge_ = 0.0;
+        monotone_ = true;
+    }
+
+private:
+    // Every sum is kept, whatever the plan reads; each is independent of the others.
+    static constexpr unsigned kAllAccumulators = kAccCharge | kAccMoments | kAccThirdMoment | kAccMaxCharge;
+
+    StatPlan plan_;
+    StreamingFirstPass<kAllAccumulators> first_pass_;
+    std::vector<double> times_;
+    std::vector<double> cumulative_;
+    RunningCharge running_;
+    double first_charge_ = 0.0;
+    bool monotone_ = true;
+};
+
+// ---------------------------------------------------------------------------
+// Partial statistics
+//
+// A PartialStats is the mergeable state of part of one sensor's hits: the
+// hits themselves, in time order. merge() combines two parts with a stable
+// merge, so merging the parts of any split of a hit array, in order, gives the
+// time order a stable sort of the whole array gives, and evaluating the result
+// is bit-identical to a single pass over it. Merging is associative. Windows
+// and quantiles are measured from the first pulse of the whole sensor and
+// need the individual hits; per-part sums of q, qt, qt^2 and qt^3 would be
+// added in a different order than a single pass adds them, so they are formed
+// when the merged state is evaluated rather than carried along.
+// ---------------------------------------------------------------------------
+
+class PartialStats {
+public:
+    PartialStats() = default;
+
+    // Hits in any order; charges may be null (unit charges), in which case no
+    // charges are stored. The hits are widened to double as they are copied
+    // into the state.
+    template<typename Time, typename Charge>
+    PartialStats(const Time* times, const Charge* charges, std::size_t n)
+        : times_(times, times + n), unit_(charges == nullptr) {
+        if (!unit_) {
+            charges_.assign(charges, charges + n);
+        }
+        if (is_sorted(times, n)) {
+            return;
+        }
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return times[a] < times[b];
+        });
+        for (std::size_t i = 0; i < n; ++i) {
+            times_[i] = static_cast<double>(times[order[i]]);
+            if (!unit_) {
+                charges_[i] = static_cast<double>(charges[order[i]]);
+            }
+        }
+    }
+
+    // The state of this part's hits followed by other's; on equal times this
+    // part's hits come first. Unit charges stay implicit unless only one of
+    // the parts has them.
+    PartialStats merge(const PartialStats& other) const {
+        PartialStats merged;
+        const std::size_t n = times_.size() + other.times_.size();
+        merged.unit_ = unit_ && other.unit_;
+        merged.times_.resize(n);
+        if (!merged.unit_) {
+            merged.charges_.resize(n);
+        }
+        const auto take = [&](const PartialStats& part, std::size_t& i, std::size_t k) {
+            merged.times_[k] = part.times_[i];
+            if (!merged.unit_) {
+                merged.charges_[k] = part.charge(i);
+            }
+            ++i;
+        };
+        std::size_t i = 0, j = 0, k = 0;
+        while (i < times_.size() && j < other.times_.size()) {
+            if (other.times_[j] < times_[i]) {
+                take(other, j, k++);
+            } else {
+                take(*this, i, k++);
+            }
+        }
+        while (i < times_.size()) {
+            take(*this, i, k++);
+        }
+        while (j < other.times_.size()) {
+            take(other, j, k++);
+        }
+        return merged;
+    }
+
+    std::size_t num_hits() const { return times_.size(); }
+    bool unit_charges() const { return unit_; }
+    const std::vector<double>& times() const { return times_; }
+
+    // The charges in time order (ones for unit charges).
+    std::vector<double> charges() const { return unit_ ? std::vector<double>(times_.size(), 1.0) : charges_; }
+
+    // Statistics of the hits of this state; writes plan.num_stats() values.
+    void evaluate(const StatPlan& plan, ScratchArena& arena, double* row) const {
+        compute_stats_from_sorted(plan, times_.data(), unit_ ? nullptr : charges_.data(), times_.size(), arena,
+                                  row);
+    }
+
+private:
+    double charge(std::size_t i) const { return unit_ ? 1.0 : charges_[i]; }
+
+    std::vector<double> times_;
+    std::vector<double> charges_;  // empty for unit charges
+    bool unit_ = true;
+};
+
+// ---------------------------------------------------------------------------
+// Worker pool
+//
+// A module-owned pool of long-lived threads, each with its own task deque.
+// Owners push and pop at the back of their deque; idle threads steal from the
+// front of other deques, so nested work (sensors of one large event inside a
+// batch of events) spreads over whichever threads run out of work first.
+// Callers that are not pool threads push to a shared injection queue and help
+// execute tasks while they wait, so the calling thread always counts as one of
+// the configured threads.
+// ---------------------------------------------------------------------------
+
+class TaskGroup {
+public:
+    explicit TaskGroup(std::size_t n_tasks) : pending_(n_tasks) {}
+
+    bool done() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class ThreadPool;
+    std::atomic<std::size_t> pending_;
+};
+
+struct Task {
+    void (*run)(void* context) = nullptr;
+    void* context = nullptr;
+    TaskGroup* group = nullptr;
+};
+
+// Growable ring buffer of tasks. Unlike std::deque it keeps its storage when
+// drained, so a warmed-up pool queues tasks without touching the heap.
+class TaskDeque {
+public:
+    bool empty() const { return size_ == 0; }
+
+    void push_back(const Task& task) {
+        if (size_ == buffer_.size()) grow();
+        buffer_[(head_ + size_) & (buffer_.size() - 1)] = task;
+        ++size_;
+    }
+
+    Task pop_back() {
+        --size_;
+        return buffer_[(head_ + size_) & (buffer_.size() - 1)];
+    }
+
+    Task pop_front() {
+        const Task task = buffer_[head_];
+        head_ = (head_ + 1) & (buffer_.size() - 1);
+        --size_;
+        return task;
+    }
+
+private:
+    void grow() {
+        // Capacity stays a power of two so that wrapping is a mask.
+        std::vector<Task> grown(std::max<std::size_t>(16, buffer_.size() * 2));
+        for (std::size_t i = 0; i < size_; ++i) {
+            grown[i] = buffer_[(head_ + i) & (buffer_.size() - 1)];
+        }
+        buffer_.swap(grown);
+        head_ = 0;
+    }
+
+    std::vector<Task> buffer_;
+    std::size_t head_ = 0;
+    std::size_t size_ = 0;
+};
+
+class ThreadPool {
+public:
+    // n_threads counts the calling thread, so n_threads - 1 workers are started.
+    explicit ThreadPool(std::size_t n_threads) : n_threads_(std::max<std::size_t>(1, n_threads)) {
+        const std::size_t n_workers = n_threads_ - 1;
+        queues_.reserve(n_workers + 1);
+        for (std::size_t i = 0; i < n_workers + 1; ++i) {
+            queues_.push_back(std::make_unique<WorkerQueue>());
+        }
+        threads_.reserve(n_workers);
+        for (std::size_t i = 0; i < n_workers; ++i) {
+            threads_.emplace_back([this, i]() { worker_loop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        sleep_cv_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t num_threads() const { return n_threads_; }
+
+    // The pool the current thread works for, or nullptr outside any pool.
+    static ThreadPool* current() { return tls_pool_; }
+
+    void push(const Task& task) {
+        WorkerQueue& queue = tls_pool_ == this ? *queues_[tls_queue_] : *queues_.back();
+        // Count the task before it becomes visible, so a thief that takes it
+        // right away never drives queued_ below zero.
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            ++queued_;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(task);
+        }
+        sleep_cv_.notify_one();
+    }
+
+    // Execute queued tasks until every task of `group` has finished.
+    void wait(TaskGroup& group) {
+        while (!group.done()) {
+            Task task;
+            if (try_take(task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.wait(lock, [&]() { return group.done() || queued_ > 0; });
+        }
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        TaskDeque tasks;
+    };
+
+    void worker_loop(std::size_t index) {
+        tls_pool_ = this;
+        tls_queue_ = index;
+        for (;;) {
+            Task task;
+            if (try_take(task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.wait(lock, [&]() { return stop_ || queued_ > 0; });
+            if (stop_) return;
+        }
+    }
+
+    bool try_take(Task& task) {
+        const std::size_t n_queues = queues_.size();
+        const std::size_t home = tls_pool_ == this ? tls_queue_ : n_queues - 1;
+        {
+            WorkerQueue& queue = *queues_[home];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = queue.tasks.pop_back();
+                --queued_;
+                return true;
+            }
+        }
+        for (std::size_t k = 1; k < n_queues; ++k) {
+            WorkerQueue& victim = *queues_[(home + k) % n_queues];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.pop_front();
+                --queued_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(const Task& task) {
+        task.run(task.context);
+        if (task.group->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // Wake the thread waiting on this group.
+            { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+            sleep_cv_.notify_all();
+        }
+    }
+
+    const std::size_t n_threads_;
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;  // one per worker, then the injection queue
+    std::vector<std::thread> threads_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<std::size_t> queued_{0};
+    bool stop_ = false;
+
+    static thread_local ThreadPool* tls_pool_;
+    static thread_local std::size_t tls_queue_;
+};
+
+thread_local ThreadPool* ThreadPool::tls_pool_ = nullptr;
+thread_local std::size_t ThreadPool::tls_queue_ = 0;
+
+std::size_t default_num_threads() {
+    const unsigned hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : static_cast<std::size_t>(hardware);
+}
+
+std::mutex g_pool_mutex;
+std::shared_ptr<ThreadPool> g_pool;
+std::size_t g_num_threads = 0;  // 0 until configured or first used
+
+#if defined(__unix__) || defined(__APPLE__)
+// Worker threads do not survive fork(). The child cannot join the inherited
+// pool's workers, so it drops (and deliberately leaks) the pool and builds a
+// fresh one on first use, which keeps the module usable inside forked
+// DataLoader workers. The leak is bounded: at most one pool per fork, and only
+// if the parent had started one. That is the ThreadPool object with its
+// n_threads task queues (each at its high-water capacity), plus what the dead
+// workers owned: their scratch arena blocks and stack mappings. All of it is
+// inherited copy-on-write and never touched again by the child, so it costs
+// address space rather than resident memory.
+void pool_prepare_fork() { g_pool_mutex.lock(); }
+void pool_parent_after_fork() { g_pool_mutex.unlock(); }
+void pool_child_after_fork() {
+    if (g_pool) {
+        new std::shared_ptr<ThreadPool>(std::move(g_pool));
+    }
+    g_pool_mutex.unlock();
+}
+#endif
+
+std::size_t get_num_threads() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    if (g_num_threads == 0) g_num_threads = default_num_threads();
+    return g_num_threads;
+}
+
+// Resize the pool. Running computations keep the pool they started on; the
+// new size applies to work submitted afterwards.
+void set_num_threads(int n_threads) {
+    if (n_threads < 1) {
+        throw std::invalid_argument("n_threads must be a positive integer");
+    }
+    std::shared_ptr<ThreadPool> retired;
+    {
+        std::lock_guard<std::mutex> lock(g_pool_mutex);
+        g_num_threads = static_cast<std::size_t>(n_threads);
+        if (g_pool && g_pool->num_threads() != g_num_threads) {
+            retired = std::move(g_pool);
+        }
+    }
+    // Join the old workers without holding the lock (with the GIL released).
+    py::gil_scoped_release release;
+    retired.reset();
+}
+
+std::shared_ptr<ThreadPool> acquire_pool() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    if (!g_pool) {
+#if defined(__unix__) || defined(__APPLE__)
+        static const bool fork_handlers_installed = [] {
+            pthread_atfork(pool_prepare_fork, pool_parent_after_fork, pool_child_after_fork);
+            return true;
+        }();
+        (void)fork_handlers_installed;
+#endif
+        if (g_num_threads == 0) g_num_threads = default_num_threads();
+        g_pool = std::make_shared<ThreadPool>(g_num_threads);
+    }
+    return g_pool;
+}
+
+std::size_t resolve_num_threads(const std::optional<int>& n_threads) {
+    if (n_threads.has_value()) {
+        if (n_threads.value() < 1) {
+            throw std::invalid_argument("n_threads must be a positive integer");
+        }
+        return static_cast<std::size_t>(n_threads.value());
+    }
+    return get_num_threads();
+}
+
+// Shared state of one parallel_for: tasks are claimed dynamically by up to
+// n_workers runners, and the first exception stops the remaining tasks.
+template<typename Fn>
+struct ParallelLoop {
+    Fn& fn;
+    const std::size_t n_tasks;
+    std::atomic<std::size_t> next_task{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    ParallelLoop(Fn& fn_, std::size_t n_tasks_) : fn(fn_), n_tasks(n_tasks_) {}
+
+    void run_runner() {
+        try {
+            for (std::size_t task = next_task.fetch_add(1, std::memory_order_relaxed);
+                 task < n_tasks;
+                 task = next_task.fetch_add(1, std::memory_order_relaxed)) {
+                fn(task);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+            next_task.store(n_tasks, std::memory_order_relaxed);
+        }
+    }
+
+    static void run_runner_task(void* context) {
+        static_cast<ParallelLoop*>(context)->run_runner();
+    }
+};
+
+// Run fn(task) for every task in [0, n_tasks) on up to n_workers threads of the
+// pool, the calling thread included. Tasks are handed out dynamically; the
+// first exception raised by any task is rethrown on the calling thread. Nested
+// calls from inside a task reuse the pool that task runs on.
+template<typename Fn>
+void parallel_for(std::size_t n_tasks, std::size_t n_workers, Fn&& fn) {
+    n_workers = std::min(n_workers, n_tasks);
+    std::shared_ptr<ThreadPool> pool_holder;
+    ThreadPool* pool = ThreadPool::current();
+    if (n_workers > 1 && pool == nullptr) {
+        pool_holder = acquire_pool();
+        pool = pool_holder.get();
+    }
+    if (n_workers <= 1 || pool->num_threads() <= 1) {
+        for (std::size_t task = 0; task < n_tasks; ++task) {
+            fn(task);
+        }
+        return;
+    }
+
+    ParallelLoop<std::remove_reference_t<Fn>> loop(fn, n_tasks);
+    TaskGroup group(n_workers - 1);
+    for (std::size_t i = 0; i + 1 < n_workers; ++i) {
+        pool->push(Task{&decltype(loop)::run_runner_task, &loop, &group});
+    }
+    loop.run_runner();
+    pool->wait(group);
+    if (loop.error) {
+        std::rethrow_exception(loop.error);
+    }
+}
+
+// Splits the ranges [offsets[i], offsets[i + 1]) for i < n_ranges into at most
+// n_chunks contiguous groups carrying roughly equal numbers of hits. Chunk
+// boundaries are range indices, computed on demand; some chunks may be empty.
+template<typename Offset>
+class HitBalancedChunks {
+public:
+    HitBalancedChunks(const Offset* offsets, std::size_t n_ranges, std::size_t n_chunks)
+        : offsets_(offsets),
+          n_ranges_(n_ranges),
+          n_chunks_(std::max<std::size_t>(1, std::min(n_chunks, n_ranges))),
+          first_hit_(static_cast<std::size_t>(offsets[0])),
+          n_hits_(static_cast<std::size_t>(offsets[n_ranges]) - first_hit_) {}
+
+    std::size_t size() const { return n_chunks_; }
+    std::size_t begin(std::size_t chunk) const { return boundary(chunk); }
+    std::size_t end(std::size_t chunk) const { return boundary(chunk + 1); }
+
+private:
+    std::size_t boundary(std::size_t c) const {
+        if (c == 0) return 0;
+        if (c >= n_chunks_) return n_ranges_;
+        const auto target_hit = static_cast<Offset>(first_hit_ + n_hits_ * c / n_chunks_);
+        const Offset* it = std::lower_bound(offsets_, offsets_ + n_ranges_ + 1, target_hit);
+        return std::min(static_cast<std::size_t>(it - offsets_), n_ranges_);
+    }
+
+    const Offset* offsets_;
+    std::size_t n_ranges_;
+    std::size_t n_chunks_;
+    std::size_t first_hit_;
+    std::size_t n_hits_;
+};
+
+// The sensors of an event as pool tasks, most expensive first. Sensor costs
+// are very uneven (most see one or two hits, a few see thousands), so a
+// sensor costs its hits plus kSensorOverheadHits, runs of cheap sensors are
+// batched into tasks of about total / n_tasks, and a sensor costing more than
+// that is a task of its own. Handing the tasks out in decreasing cost
+// (longest-processing-time-first) leaves only small tasks for the end of the
+// loop. Each task is a contiguous range of sensors; the task list lives in
+// `arena`.
+class SensorSchedule {
+public:
+    SensorSchedule(const std::size_t* sensor_offsets, std::size_t n_sensors, std::size_t n_tasks,
+                   ScratchArena& arena)
+        : starts_(whole_), order_(whole_) {
+        whole_[0] = 0;
+        whole_[1] = n_sensors;
+        if (n_tasks <= 1 || n_sensors <= 1) {
+            return;
+        }
+        const auto cost = [&](std::size_t s) {
+            return sensor_offsets[s + 1] - sensor_offsets[s] + kSensorOverheadHits;
+        };
+        const std::size_t total = sensor_offsets[n_sensors] - sensor_offsets[0] + kSensorOverheadHits * n_sensors;
+        const std::size_t target = std::max<std::size_t>(1, total / n_tasks);
+
+        std::size_t* starts = arena.allocate<std::size_t>(n_sensors + 1);
+        std::size_t* costs = arena.allocate<std::size_t>(n_sensors);
+        std::size_t task_cost = 0;
+        size_ = 0;
+        starts[0] = 0;
+        for (std::size_t s = 0; s < n_sensors; ++s) {
+            const std::size_t c = cost(s);
+            if (c >= target && task_cost > 0) {
+                costs[size_] = task_cost;
+                starts[++size_] = s;
+                task_cost = 0;
+            }
+            task_cost += c;
+            if (task_cost >= target) {
+                costs[size_] = task_cost;
+                starts[++size_] = s + 1;
+                task_cost = 0;
+            }
+        }
+        if (task_cost > 0) {
+            costs[size_] = task_cost;
+            starts[++size_] = n_sensors;
+        }
+
+        std::size_t* order = arena.allocate<std::size_t>(size_);
+        std::iota(order, order + size_, 0);
+        std::sort(order, order + size_, [&](std::size_t a, std::size_t b) {
+            return costs[a] != costs[b] ? costs[a] > costs[b] : a < b;
+        });
+        starts_ = starts;
+        order_ = order;
+    }
+
+    SensorSchedule(const SensorSchedule&) = delete;
+    SensorSchedule& operator=(const SensorSchedule&) = delete;
+
+    std::size_t size() const { return size_; }
+    std::size_t begin(std::size_t task) const { return starts_[order_[task]]; }
+    std::size_t end(std::size_t task) const { return starts_[order_[task] + 1]; }
+
+private:
+    std::size_t whole_[2];
+    const std::size_t* starts_;
+    const std::size_t* order_;
+    std::size_t size_ = 1;
+};
+
+// ---------------------------------------------------------------------------
+// Bright sensors
+//
+// A sensor near a bright cascade or a flasher can carry most of an event's
+// hits, and as a single task it would set the event's latency. Such sensors
+// are sorted and reduced on several threads instead: the time sort becomes a
+// parallel merge sort, and the first pass and the running charge, which are
+// defined block by block (kSensorBlockHits), are formed per block in parallel
+// and combined in block order. Results do not depend on the thread count.
+// ---------------------------------------------------------------------------
+
+// Sort [first, last) by `less` on up to n_workers threads: slices are sorted in
+// parallel, then merged pairwise, each round of merges in parallel. `less`
+// must order every pair of distinct elements, so that the result does not
+// depend on how the range was sliced.
+template<typename T, typename Less>
+void parallel_sort(T* first, T* last, Less less, std::size_t n_workers, ScratchArena& arena) {
+    const auto n = static_cast<std::size_t>(last - first);
+    const std::size_t n_slices = std::min(n_workers, n / kSensorBlockHits);
+    if (n_slices <= 1) {
+        std::sort(first, last, less);
+        return;
+    }
+
+    ScratchScope scope(arena);
+    T* buffer = arena.allocate<T>(n);
+    const auto bound = [&](std::size_t slice) { return n * std::min(slice, n_slices) / n_slices; };
+    parallel_for(n_slices, n_workers, [&](std::size_t slice) {
+        std::sort(first + bound(slice), first + bound(slice + 1), less);
+    });
+
+    T* source = first;
+    T* target = buffer;
+    for (std::size_t width = 1; width < n_slices; width *= 2) {
+        const std::size_t n_merges = (n_slices + 2 * width - 1) / (2 * width);
+        parallel_for(n_merges, n_workers, [&](std::size_t m) {
+            const std::size_t lo = bound(2 * m * width);
+            const std::size_t mid = bound(2 * m * width + width);
+            const std::size_t hi = bound(2 * m * width + 2 * width);
+            std::merge(source + lo, source + mid, source + mid, source + hi, target + lo, less);
+        });
+        std::swap(source, target);
+    }
+    if (source != first) {
+        std::copy(source, source + n, first);
+    }
+}
+
+// compute_stats_from_sorted with the blocks of the first pass and of the
+// running charge reduced on up to n_workers threads; the result is the same.
+// Unit charges (charges == nullptr) have no running charge to form.
+void compute_stats_from_sorted_parallel(
+    const StatPlan& plan,
+    const double* times,
+    const double* charges,
+    std::size_t n,
+    std::size_t n_workers,
+    ScratchArena& arena,
+    double* row) {
+    const std::size_t n_blocks = (n + kSensorBlockHits - 1) / kSensorBlockHits;
+    if (n_blocks <= 1 || n_workers <= 1) {
+        compute_stats_from_sorted(plan, times, charges, n, arena, row);
+        return;
+    }
+
+    ScratchScope scope(arena);
+    const bool unit = charges == nullptr;
+    const unsigned accumulators = plan.accumulators() | (unit ? kUnitCharge : 0u);
+    const bool lookups = !plan.windows().empty() || !plan.quantiles().empty();
+    auto* block_sums = arena.allocate<FirstPassSums>(n_blocks);
+    auto* block_non_negative = arena.allocate<uint8_t>(n_blocks);
+    double* cumulative = arena.allocate<double>(lookups && !unit ? n : 0);
+    parallel_for(n_blocks, n_workers, [&](std::size_t b) {
+        const std::size_t begin = b * kSensorBlockHits;
+        const std::size_t end = std::min(n, begin + kSensorBlockHits);
+        block_sums[b] = first_pass_block(accumulators, times + begin, charges_from(charges, begin), end - begin);
+        if (lookups && !unit) {
+            block_non_negative[b] = block_running_charge(charges, begin, end, cumulative);
+        }
+    });
+
+    FirstPassSums sums = block_sums[0];
+    for (std::size_t b = 1; b < n_blocks; ++b) {
+        add_block_sums(sums, block_sums[b]);
+    }
+
+    double* window_charge = arena.allocate<double>(plan.windows().size());
+    double* quantile_time = arena.allocate<double>(plan.quantiles().size());
+    if (lookups && unit) {
+        evaluate_windows_and_quantiles(plan, CumulativeCharge(times, n), times[0], sums.total_charge, arena,
+                                       window_charge, quantile_time);
+    } else if (lookups) {
+        // Offset of block b: the running charge at the end of block b - 1,
+        // summed over the block ends in order as the serial pass sums it.
+        double* offsets = arena.allocate<double>(n_blocks);
+        bool monotone = block_non_negative[0] != 0;
+        offsets[0] = 0.0;
+        for (std::size_t b = 1; b < n_blocks; ++b) {
+            const double block_end = cumulative[b * kSensorBlockHits - 1];
+            offsets[b] = b == 1 ? block_end : offsets[b - 1] + block_end;
+            monotone = monotone && block_non_negative[b] != 0;
+        }
+        parallel_for(n_blocks - 1, n_workers, [&](std::size_t k) {
+            const std::size_t begin = (k + 1) * kSensorBlockHits;
+            add_block_offset(cumulative, begin, std::min(n, begin + kSensorBlockHits), offsets[k + 1]);
+        });
+        const CumulativeCharge running(times, cumulative, n, monotone);
+        evaluate_windows_and_quantiles(plan, running, times[0], sums.total_charge, arena,
+                                       window_charge, quantile_time);
+    }
+    write_stats_row(plan, sums, window_charge, quantile_time, times[0], times[n - 1], n, row);
+}
+
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+using Int32Array = py::array_t<int32_t, py::array::c_style | py::array::forcecast>;
+using Int64Array = py::array_t<int64_t, py::array::c_style | py::array::forcecast>;
+using UInt8Array = py::array_t<uint8_t, py::array::c_style | py::array::forcecast>;
+
+template<typename T>
+const char* dtype_name() {
+    return std::is_same<T, float>::value ? "float32" : "float64";
+}
+
+// Check a caller-provided output buffer and return a pointer to its data. The
+// buffer must be a writeable, C-contiguous array of T (float64 unless single
+// precision output was asked for); with n_cols == 0 it must have shape
+// (n_rows,), otherwise shape (>= n_rows, n_cols).
+template<typename T = double>
+T* checked_output(py::array& out, const char* name, std::size_t n_rows, std::size_t n_cols) {
+    const std::string arg(name);
+    if (!out.dtype().is(py::dtype::of<T>())) {
+        throw std::invalid_argument(arg + " must have dtype " + dtype_name<T>());
+    }
+    if (!(out.flags() & py::array::c_style) || !out.writeable()) {
+        throw std::invalid_argument(arg + " must be a writeable C-contiguous array");
+    }
+    if (n_cols == 0) {
+        if (out.ndim() != 1 || out.shape(0) != static_cast<py::ssize_t>(n_rows)) {
+            throw std::invalid_argument(arg + " must have shape (" + std::to_string(n_rows) + ",)");
+        }
+    } else if (out.ndim() != 2 || out.shape(1) != static_cast<py::ssize_t>(n_cols) ||
+               out.shape(0) < static_cast<py::ssize_t>(n_rows)) {
+        throw std::invalid_argument(
+            arg + " must have shape (n, " + std::to_string(n_cols) + ") with n >= " + std::to_string(n_rows));
+    }
+    return static_cast<T*>(out.mutable_data());
+}
+
+// Use `out_obj` as the output array when given, otherwise allocate one of
+// exactly the required shape. Returns the data pointer of the chosen array.
+template<typename T = double>
+T* output_array(
+    const py::object& out_obj,
+    const char* name,
+    std::size_t n_rows,
+    std::size_t n_cols,
+    py::array& out) {
+    if (out_obj.is_none()) {
+        if (n_cols == 0) {
+            out = py::array_t<T>(py::array::ShapeContainer{static_cast<py::ssize_t>(n_rows)});
+        } else {
+            out = py::array_t<T>(py::array::ShapeContainer{
+                static_cast<py::ssize_t>(n_rows),
+                static_cast<py::ssize_t>(n_cols)});
+        }
+        return static_cast<T*>(out.mutable_data());
+    }
+    out = out_obj.cast<py::array>();
+    return checked_output<T>(out, name, n_rows, n_cols);
+}
+
+// The first n_rows rows of a C-contiguous 2D array, sharing its memory.
+py::array leading_rows(const py::array& array, std::size_t n_rows) {
+    if (array.shape(0) == static_cast<py::ssize_t>(n_rows)) {
+        return array;
+    }
+    return py::array(
+        array.dtype(),
+        py::array::ShapeContainer{static_cast<py::ssize_t>(n_rows), array.shape(1)},
+        py::array::StridesContainer{array.strides(0), array.strides(1)},
+        array.data(),
+        array);
+}
+
+// The plan an entry point evaluates: `plan` when given, else the built-in
+// standard or extended layout.
+const StatPlan& resolve_plan(const std::shared_ptr<StatPlan>& plan, bool extended) {
+    return plan ? *plan : StatPlan::preset(extended);
+}
+
+py::array_t<double> vector_to_array(const std::vector<double>& values) {
+    py::array_t<double> array(py::array::ShapeContainer{static_cast<py::ssize_t>(values.size())});
+    std::copy(values.begin(), values.end(), static_cast<double*>(array.mutable_data()));
+    return array;
+}
+
+// Fixed detector geometry: the position of every sensor, keyed by
+// (string_id, sensor_id). A dense table spanning both ID ranges maps IDs to
+// the sensor's row in O(1); detectors number their strings and modules
+// compactly, so the table stays small.
+class Geometry {
+public:
+    // Upper bound on the lookup table size (n_string_slots * n_sensor_slots).
+    static constexpr std::size_t kMaxTableSize = std::size_t(1) << 24;
+
+    Geometry(const int32_t* string_ids,
+             const int32_t* sensor_ids,
+             const double* x,
+             const double* y,
+             const double* z,
+             std::size_t n_sensors)
+        : string_ids_(string_ids, string_ids + n_sensors),
+          sensor_ids_(sensor_ids, sensor_ids + n_sensors),
+          positions_(3 * n_sensors) {
+        if (n_sensors == 0) {
+            throw std::invalid_argument("geometry must contain at least one sensor");
+        }
+        const auto [min_string, max_string] = std::minmax_element(string_ids, string_ids + n_sensors);
+        const auto [min_sensor, max_sensor] = std::minmax_element(sensor_ids, sensor_ids + n_sensors);
+        min_string_id_ = *min_string;
+        min_sensor_id_ = *min_sensor;
+        n_string_slots_ = static_cast<std::size_t>(int64_t(*max_string) - *min_string + 1);
+        n_sensor_slots_ = static_cast<std::size_t>(int64_t(*max_sensor) - *min_sensor + 1);
+        if (n_string_slots_ > kMaxTableSize / n_sensor_slots_) {
+            throw std::invalid_argument("geometry string_id / sensor_id ranges are too sparse for a dense lookup");
+        }
+
+        table_.assign(n_string_slots_ * n_sensor_slots_, -1);
+        for (std::size_t i = 0; i < n_sensors; ++i) {
+            int32_t& slot = table_[slot_of(string_ids[i], sensor_ids[i])];
+            if (slot != -1) {
+                throw std::invalid_argument(
+                    "geometry lists sensor (string_id=" + std::to_string(string_ids[i]) +
+                    ", sensor_id=" + std::to_string(sensor_ids[i]) + ") more than once");
+            }
+            slot = static_cast<int32_t>(i);
+            positions_[3 * i + 0] = x[i];
+            positions_[3 * i + 1] = y[i];
+            positions_[3 * i + 2] = z[i];
+        }
+    }
+
+    std::size_t n_sensors() const { return string_ids_.size(); }
+
+    // Row of the sensor in the geometry table, or -1 if it is not part of it.
+    int32_t index(int32_t string_id, int32_t sensor_id) const {
+        const auto s = static_cast<uint64_t>(int64_t(string_id) - min_string_id_);
+        const auto d = static_cast<uint64_t>(int64_t(sensor_id) - min_sensor_id_);
+        if (s >= n_string_slots_ || d >= n_sensor_slots_) {
+            return -1;
+        }
+        return table_[s * n_sensor_slots_ + d];
+    }
+
+    // x, y, z of the sensor in row `index`.
+    const double* position(int32_t index) const { return positions_.data() + 3 * static_cast<std::size_t>(index); }
+
+    // The (string_id, sensor_id) grid the lookup table spans: sensor
+    // (string_id, sensor_id) sits in cell (string_id - min_string_id,
+    // sensor_id - min_sensor_id), and grid_slot() numbers the cells row-major.
+    // Only valid for sensors of the geometry.
+    std::size_t n_string_slots() const { return n_string_slots_; }
+    std::size_t n_sensor_slots() const { return n_sensor_slots_; }
+    int32_t min_string_id() const { return min_string_id_; }
+    int32_t min_sensor_id() const { return min_sensor_id_; }
+    std::size_t grid_slot(int32_t string_id, int32_t sensor_id) const { return slot_of(string_id, sensor_id); }
+
+    const std::vector<int32_t>& string_ids() const { return string_ids_; }
+    const std::vector<int32_t>& sensor_ids() const { return sensor_ids_; }
+    const std::vector<double>& positions() const { return positions_; }
+
+private:
+    std::size_t slot_of(int32_t string_id, int32_t sensor_id) const {
+        return static_cast<std::size_t>(int64_t(string_id) - min_string_id_) * n_sensor_slots_ +
+               static_cast<std::size_t>(int64_t(sensor_id) - min_sensor_id_);
+    }
+
+    std::vector<int32_t> string_ids_;
+    std::vector<int32_t> sensor_ids_;
+    std::vector<double> positions_;  // n_sensors x 3
+    std::vector<int32_t> table_;     // n_string_slots x n_sensor_slots rows, -1 where absent
+    int32_t min_string_id_ = 0;
+    int32_t min_sensor_id_ = 0;
+    std::size_t n_string_slots_ = 0;
+    std::size_t n_sensor_slots_ = 0;
+};
+
+std::string unknown_sensor_message(int32_t string_id, int32_t sensor_id) {
+    return "sensor (string_id=" + std::to_string(string_id) + ", sensor_id=" + std::to_string(sensor_id) +
+           ") is not part of the geometry";
+}
+
+constexpr const char* kIdRangeMessage = "string_id and sensor_id values must fit in int32";
+
+// Element types the event columns are read in: charges and positions as
+// float32 or float64, times as float32, float64 or int64, IDs as int16, int32
+// or int64.
+enum class ElementType : uint8_t { Float32, Float64, Int16, Int32, Int64 };
+
+template<typename T>
+constexpr ElementType element_type_of() {
+    static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value ||
+                  std::is_same<T, int16_t>::value || std::is_same<T, int32_t>::value ||
+                  std::is_same<T, int64_t>::value, "unsupported column element type");
+    if (std::is_same<T, float>::value) return ElementType::Float32;
+    if (std::is_same<T, double>::value) return ElementType::Float64;
+    if (std::is_same<T, int16_t>::value) return ElementType::Int16;
+    if (std::is_same<T, int32_t>::value) return ElementType::Int32;
+    return ElementType::Int64;
+}
+
+// One input column, read in place in its own element type.
+struct Column {
+    const void* data = nullptr;
+    ElementType type = ElementType::Float64;
+
+    Column() = default;
+    Column(std::nullptr_t) {}
+    template<typename T>
+    Column(const T* values) : data(values), type(element_type_of<T>()) {}
+
+    bool empty() const { return data == nullptr; }
+
+    template<typename T>
+    const T* as() const { return static_cast<const T*>(data); }
+
+    // The column from element k on; an empty column stays empty.
+    Column offset(std::size_t k) const {
+        Column view = *this;
+        if (data != nullptr) {
+            view.data = static_cast<const unsigned char*>(data) + k * element_size();
+        }
+        return view;
+    }
+
+    std::size_t element_size() const {
+        switch (type) {
+            case ElementType::Float32: return sizeof(float);
+            case ElementType::Int16: return sizeof(int16_t);
+            case ElementType::Int32: return sizeof(int32_t);
+            case ElementType::Float64:
+            case ElementType::Int64: break;
+        }
+        return 8;
+    }
+
+    // Element i as a double, for reads once per sensor rather than per hit.
+    double value(std::size_t i) const {
+        switch (type) {
+            case ElementType::Float32: return as<float>()[i];
+            case ElementType::Float64: return as<double>()[i];
+            case ElementType::Int16: return as<int16_t>()[i];
+            case ElementType::Int32: return as<int32_t>()[i];
+            case ElementType::Int64: return static_cast<double>(as<int64_t>()[i]);
+        }
+        return 0.0;
+    }
+};
+
+// Raw, GIL-independent view of the hit columns of one event. Both ID columns
+// share one element type.
+struct EventInputs {
+    Column string_ids;
+    Column sensor_ids;
+    Column times;
+    Column pos_x;  // per-hit positions, unused with a geometry
+    Column pos_y;
+    Column pos_z;
+    Column charges;  // empty means unit charge for every hit
+    Column pmt_ids;  // PMT within the sensor (module); empty without a PMT level
+    const Geometry* geometry = nullptr;  // sensor positions, when registered
+    std::size_t n_hits = 0;
+
+    EventInputs slice(std::size_t begin, std::size_t end) const {
+        EventInputs view = *this;
+        view.string_ids = string_ids.offset(begin);
+        view.sensor_ids = sensor_ids.offset(begin);
+        view.times = times.offset(begin);
+        if (view.geometry == nullptr) {
+            view.pos_x = pos_x.offset(begin);
+            view.pos_y = pos_y.offset(begin);
+            view.pos_z = pos_z.offset(begin);
+        }
+        view.charges = charges.offset(begin);
+        view.pmt_ids = pmt_ids.offset(begin);
+        view.n_hits = end - begin;
+        return view;
+    }
+};
+
+// The per-hit columns of an event as typed pointers. The per-hit loops of the
+// event pipeline are instantiated for each combination of element types, so
+// float32 times or int64 IDs are read in place and converted as they are
+// loaded; statistics are still accumulated in double.
+template<typename Id, typename Time, typename Charge>
+struct HitColumns {
+    using IdType = Id;
+
+    explicit HitColumns(const EventInputs& event)
+        : string_ids(event.string_ids.as<Id>()),
+          sensor_ids(event.sensor_ids.as<Id>()),
+          times(event.times.as<Time>()),
+          charges(event.charges.as<Charge>()),
+          n_hits(event.n_hits) {}
+
+    double time(std::size_t i) const { return static_cast<double>(times[i]); }
+    double charge(std::size_t i) const { return charges != nullptr ? static_cast<double>(charges[i]) : 1.0; }
+
+    const Id* string_ids;
+    const Id* sensor_ids;
+    const Time* times;
+    const Charge* charges;  // nullptr means unit charges
+    std::size_t n_hits;
+};
+
+template<typename Id, typename Time, typename Fn>
+void with_charge_column(const EventInputs& event, Fn& fn) {
+    if (event.charges.type == ElementType::Float32) {
+        fn(HitColumns<Id, Time, float>(event));
+    } else {
+        fn(HitColumns<Id, Time, double>(event));
+    }
+}
+
+template<typename Id, typename Fn>
+void with_time_column(const EventInputs& event, Fn& fn) {
+    switch (event.times.type) {
+        case ElementType::Float32: with_charge_column<Id, float>(event, fn); break;
+        case ElementType::Int64: with_charge_column<Id, int64_t>(event, fn); break;
+        default: with_charge_column<Id, double>(event, fn); break;
+    }
+}
+
+// Call fn(HitColumns<Id, Time, Charge>) with the event's element types.
+template<typename Fn>
+void with_hit_columns(const EventInputs& event, Fn&& fn) {
+    switch (event.string_ids.type) {
+        case ElementType::Int16: with_time_column<int16_t>(event, fn); break;
+        case ElementType::Int64: with_time_column<int64_t>(event, fn); break;
+        default: with_time_column<int32_t>(event, fn); break;
+    }
+}
+
+// As with_hit_columns, for the hits of one sensor: only the times and charges
+// are read, so the ID type is not dispatched on.
+template<typename Fn>
+void with_sensor_columns(const EventInputs& hits, Fn&& fn) {
+    with_time_column<int32_t>(hits, fn);
+}
+
+// Hit ordering and sensor segmentation of one event. Building the layout is
+// separated from computing statistics so that the number of output rows is
+// known before any output is written. The arrays live in scratch storage sized
+// for the event's hit count (see LayoutBuffers).
+struct EventLayout {
+    std::size_t* order = nullptr;           // hit indices sorted by (string_id, sensor_id, time)
+    std::size_t* sensor_offsets = nullptr;  // n_sensors + 1 offsets into order
+    int32_t* sensor_string_ids = nullptr;
+    int32_t* sensor_sensor_ids = nullptr;
+    std::size_t* neighbor_counts = nullptr;  // per sensor, when the neighbor pass ran ahead of the statistics
+    std::size_t n_sensors = 0;
+};
+
+// Arena storage for the layouts of a run of events with n_hits hits in total.
+// An event starting at hit first_hit uses every array from that slot on; its
+// offsets start one slot later per preceding event, as each event needs one
+// more offset than it has hits. Room for neighbor counts is only allocated on
+// request; a layout points at its counts once they are filled.
+struct LayoutBuffers {
+    std::size_t* order;
+    std::size_t* sensor_offsets;
+    int32_t* sensor_string_ids;
+    int32_t* sensor_sensor_ids;
+    std::size_t* neighbor_counts;
+
+    LayoutBuffers(ScratchArena& arena, std::size_t n_hits, std::size_t n_events, bool with_neighbor_counts = false)
+        : order(arena.allocate<std::size_t>(n_hits)),
+          sensor_offsets(arena.allocate<std::size_t>(n_hits + n_events)),
+          sensor_string_ids(arena.allocate<int32_t>(n_hits)),
+          sensor_sensor_ids(arena.allocate<int32_t>(n_hits)),
+          neighbor_counts(with_neighbor_counts ? arena.allocate<std::size_t>(n_hits) : nullptr) {}
+
+    EventLayout layout(std::size_t first_hit, std::size_t event_index) const {
+        EventLayout layout;
+        layout.order = order + first_hit;
+        layout.sensor_offsets = sensor_offsets + first_hit + event_index;
+        layout.sensor_string_ids = sensor_string_ids + first_hit;
+        layout.sensor_sensor_ids = sensor_sensor_ids + first_hit;
+        return layout;
+    }
+
+    // Room for the neighbor counts of the event starting at hit first_hit.
+    std::size_t* neighbor_counts_at(std::size_t first_hit) const { return neighbor_counts + first_hit; }
+};
+
+// The PMT level of a multi-PMT event: each module's hits regrouped by pmt_id,
+// in (string_id, sensor_id, pmt_id, time) order, as a layout of its own whose
+// sensors are the PMTs (keyed by their module). The PMT rows of module m are
+// module_pmts[m] to module_pmts[m + 1].
+struct PmtLayout {
+    EventLayout pmts;
+    std::size_t* module_pmts = nullptr;  // n_modules + 1 offsets into the PMT rows
+};
+
+// Arena storage for the PMT layouts of a run of events, laid out as in
+// LayoutBuffers, with room for the neighbor counts of both levels.
+struct PmtLayoutBuffers {
+    LayoutBuffers pmts;
+    std::size_t* module_pmts;
+    std::size_t* module_neighbor_counts;
+
+    PmtLayoutBuffers(ScratchArena& arena, std::size_t n_hits, std::size_t n_events)
+        : pmts(arena, n_hits, n_events, true),
+          module_pmts(arena.allocate<std::size_t>(n_hits + n_events)),
+          module_neighbor_counts(arena.allocate<std::size_t>(n_hits)) {}
+
+    PmtLayout layout(std::size_t first_hit, std::size_t event_index) const {
+        PmtLayout layout;
+        layout.pmts = pmts.layout(first_hit, event_index);
+        layout.module_pmts = module_pmts + first_hit + event_index;
+        return layout;
+    }
+
+    // Room for the neighbor counts of the event starting at hit first_hit.
+    std::size_t* module_neighbor_counts_at(std::size_t first_hit) const { return module_neighbor_counts + first_hit; }
+    std::size_t* pmt_neighbor_counts_at(std::size_t first_hit) const { return pmts.neighbor_counts_at(first_hit); }
+};
+
+// Validate the per-hit columns shared by the event entry points and return the hit count.
+std::size_t check_hit_columns(std::initializer_list<const py::array*> columns) {
+    for (const py::array* column : columns) {
+        if (column->ndim() != 1) {
+            throw std::invalid_argument("All event arrays must be 1D");
+        }
+    }
+    const auto n_hits = (*columns.begin())->shape(0);
+    for (const py::array* column : columns) {
+        if (column->shape(0) != n_hits) {
+            throw std::invalid_argument("All event arrays must have identical lengths");
+        }
+    }
+    return static_cast<std::size_t>(n_hits);
+}
+
+template<typename T>
+bool is_column_of(const py::array& array) {
+    return py::isinstance<py::array_t<T, py::array::c_style>>(array);
+}
+
+// A string_id / sensor_id column converted to int32. Values outside the int32
+// range raise instead of wrapping, as they do when read in place.
+Int32Array int32_id_column(const py::array& ids) {
+    if (is_column_of<int32_t>(ids)) {
+        return ids;
+    }
+    const Int64Array wide = ids;
+    const int64_t* data = wide.data();
+    for (py::ssize_t i = 0; i < wide.size(); ++i) {
+        if (data[i] < std::numeric_limits<int32_t>::min() || data[i] > std::numeric_limits<int32_t>::max()) {
+            throw std::invalid_argument(kIdRangeMessage);
+        }
+    }
+    return wide;
+}
+
+// A floating-point hit column, read in place when it is a C-contiguous
+// float32 or float64 array; anything else is converted to float64 into
+// `storage`, which keeps it alive.
+Column float_column(const py::array& array, py::array& storage) {
+    if (is_column_of<float>(array)) {
+        return Column(static_cast<const float*>(array.data()));
+    }
+    if (is_column_of<double>(array)) {
+        return Column(static_cast<const double*>(array.data()));
+    }
+    DoubleArray converted = array;
+    storage = converted;
+    return Column(converted.data());
+}
+
+// A time column: read in place like float_column, and also as int64 (integer
+// clock ticks), which is widened to double as it is loaded.
+Column time_column(const py::array& array, py::array& storage) {
+    if (is_column_of<int64_t>(array)) {
+        return Column(static_cast<const int64_t*>(array.data()));
+    }
+    return float_column(array, storage);
+}
+
+// The string_id / sensor_id columns, read in place when both are C-contiguous
+// arrays of the same type among int16, int32 and int64; otherwise both are
+// converted to int32 into the storage arrays.
+void id_columns(const py::array& string_ids, const py::array& sensor_ids, EventInputs& event,
+                py::array& string_storage, py::array& sensor_storage) {
+    if (is_column_of<int16_t>(string_ids) && is_column_of<int16_t>(sensor_ids)) {
+        event.string_ids = Column(static_cast<const int16_t*>(string_ids.data()));
+        event.sensor_ids = Column(static_cast<const int16_t*>(sensor_ids.data()));
+    } else if (is_column_of<int32_t>(string_ids) && is_column_of<int32_t>(sensor_ids)) {
+        event.string_ids = Column(static_cast<const int32_t*>(string_ids.data()));
+        event.sensor_ids = Column(static_cast<const int32_t*>(sensor_ids.data()));
+    } else if (is_column_of<int64_t>(string_ids) && is_column_of<int64_t>(sensor_ids)) {
+        event.string_ids = Column(static_cast<const int64_t*>(string_ids.data()));
+        event.sensor_ids = Column(static_cast<const int64_t*>(sensor_ids.data()));
+    } else {
+        Int32Array strings = int32_id_column(string_ids);
+        Int32Array sensors = int32_id_column(sensor_ids);
+        string_storage = strings;
+        sensor_storage = sensors;
+        event.string_ids = Column(strings.data());
+        event.sensor_ids = Column(sensors.data());
+    }
+}
+
+// Resolve an optional per-hit charges argument. Returns an empty column for
+// None; a converted array is kept alive in `storage`.
+Column optional_charges(const py::object& charges_obj, std::size_t n_hits, py::array& storage) {
+    if (charges_obj.is_none()) {
+        return Column();
+    }
+    const auto charges = charges_obj.cast<py::array>();
+    if (charges.ndim() != 1 || charges.shape(0) != static_cast<py::ssize_t>(n_hits)) {
+        throw std::invalid_argument("charges must be 1D and match times length");
+    }
+    return float_column(charges, storage);
+}
+
+// The hit columns every event entry point takes, checked and read in place
+// where their types allow; `storage` keeps converted columns alive.
+struct EventArrays {
+    EventInputs event;
+    py::array storage[8];
+
+    EventArrays(const py::array& string_ids, const py::array& sensor_ids, const py::array& times,
+                const py::object& charges_obj) {
+        event.n_hits = check_hit_columns({&times, &string_ids, &sensor_ids});
+        id_columns(string_ids, sensor_ids, event, storage[0], storage[1]);
+        event.times = time_column(times, storage[2]);
+        event.charges = optional_charges(charges_obj, event.n_hits, storage[3]);
+    }
+
+    void set_positions(const py::array& pos_x, const py::array& pos_y, const py::array& pos_z) {
+        if (check_hit_columns({&pos_x, &pos_y, &pos_z}) != event.n_hits) {
+            throw std::invalid_argument("All event arrays must have identical lengths");
+        }
+        event.pos_x = float_column(pos_x, storage[4]);
+        event.pos_y = float_column(pos_y, storage[5]);
+        event.pos_z = float_column(pos_z, storage[6]);
+    }
+
+    // The optional pmt_ids column, read in place as int16, int32 or int64,
+    // else converted to int32.
+    void set_pmt_ids(const py::object& pmt_ids_obj) {
+        if (pmt_ids_obj.is_none()) {
+            return;
+        }
+        const auto pmt_ids = pmt_ids_obj.cast<py::array>();
+        if (pmt_ids.ndim() != 1 || pmt_ids.shape(0) != static_cast<py::ssize_t>(event.n_hits)) {
+            throw std::invalid_argument("pmt_ids must be 1D and match times length");
+        }
+        if (is_column_of<int16_t>(pmt_ids)) {
+            event.pmt_ids = Column(static_cast<const int16_t*>(pmt_ids.data()));
+        } else if (is_column_of<int32_t>(pmt_ids)) {
+            event.pmt_ids = Column(static_cast<const int32_t*>(pmt_ids.data()));
+        } else if (is_column_of<int64_t>(pmt_ids)) {
+            event.pmt_ids = Column(static_cast<const int64_t*>(pmt_ids.data()));
+        } else {
+            Int32Array converted = pmt_ids;
+            storage[7] = converted;
+            event.pmt_ids = Column(converted.data());
+        }
+    }
+};
+
+// Whether an entry point's `dtype` argument asks for float32 output; None
+// and float64 mean float64.
+bool single_precision_output(const py::object& dtype_obj) {
+    if (dtype_obj.is_none()) {
+        return false;
+    }
+    const py::dtype dtype = py::dtype::from_args(dtype_obj);
+    if (dtype.kind() == 'f' && dtype.itemsize() == 4) {
+        return true;
+    }
+    if (dtype.kind() == 'f' && dtype.itemsize() == 8) {
+        return false;
+    }
+    throw std::invalid_argument("dtype must be float32 or float64");
+}
+
+// The hit columns of the single-sensor, streaming and partial-state entry
+// points, read in place as EventArrays reads an event's; the arrays must be
+// 1D and, with charges, of equal length (checked by the caller).
+struct SensorArrays {
+    EventInputs hits;
+    py::array storage[2];
+
+    SensorArrays(const py::array& times, const py::object& charges_obj) {
+        hits.n_hits = static_cast<std::size_t>(times.shape(0));
+        hits.times = time_column(times, storage[0]);
+        if (!charges_obj.is_none()) {
+            hits.charges = float_column(charges_obj.cast<py::array>(), storage[1]);
+        }
+    }
+};
+
+// The statistics row of a single-sensor entry point in the requested dtype:
+// write(row) fills a double row, the output itself for float64 or a scratch
+// row that is then rounded into it for float32.
+template<typename Write>
+py::array stats_row_output(const py::object& out_obj, std::size_t num_stats, bool single_precision, Write&& write) {
+    py::array result;
+    if (!single_precision) {
+        write(output_array(out_obj, "out", num_stats, 0, result));
+        return result;
+    }
+    float* out = output_array<float>(out_obj, "out", num_stats, 0, result);
+    ScratchArena& arena = thread_arena();
+    ScratchScope scope(arena);
+    double* row = arena.allocate<double>(num_stats);
+    write(row);
+    std::copy(row, row + num_stats, out);
+    return result;
+}
+
+py::array compute_summary_stats_py(
+    py::array times,
+    py::array charges,
+    bool extended,
+    py::object out_obj,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj) {
+    const StatPlan& plan = resolve_plan(plan_ptr, extended);
+    if (times.ndim() != 1 || charges.ndim() != 1) {
+        throw std::invalid_argument("times and charges must be 1D arrays");
+    }
+    if (times.shape(0) != charges.shape(0)) {
+        throw std::invalid_argument("times and charges must have the same length");
+    }
+
+    // The kernels read the numpy buffers in place and write into the output.
+    const SensorArrays arrays(times, charges);
+    return stats_row_output(out_obj, plan.num_stats(), single_precision_output(dtype_obj), [&](double* out) {
+        // Heavy compute section; allow other Python threads to run.
+        py::gil_scoped_release release;
+        with_sensor_columns(arrays.hits, [&](const auto& hits) {
+            compute_stats_single_sensor_impl(plan, hits.times, hits.charges, hits.n_hits, std::nullopt,
+                                             thread_arena(), out);
+        });
+    });
+}
+
+py::array process_sensor_data_py(
+    py::array times,
+    py::object charges_obj,
+    std::optional<double> grouping_window_ns,
+    bool extended,
+    py::object out_obj,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj) {
+    const StatPlan& plan = resolve_plan(plan_ptr, extended);
+    if (times.ndim() != 1) {
+        throw std::invalid_argument("sensor_times must be a 1D array");
+    }
+    if (!charges_obj.is_none()) {
+        const auto charges = charges_obj.cast<py::array>();
+        if (charges.ndim() != 1 || charges.shape(0) != times.shape(0)) {
+            throw std::invalid_argument("sensor_charges must be 1D and match sensor_times length");
+        }
+    }
+
+    const SensorArrays arrays(times, charges_obj);
+    const std::size_t n = arrays.hits.n_hits;
+    return stats_row_output(out_obj, plan.num_stats(), single_precision_output(dtype_obj), [&](double* out) {
+        py::gil_scoped_release release;
+        with_sensor_columns(arrays.hits, [&](const auto& hits) {
+            compute_stats_single_sensor_impl(plan, hits.times, hits.charges, n, grouping_window_ns, thread_arena(),
+                                             out);
+        });
+        // Override n_pulses with pre-grouping count when grouping is applied
+        if (plan.n_pulses_column() >= 0 && grouping_window_ns.has_value() && grouping_window_ns.value() > 0.0) {
+            out[plan.n_pulses_column()] = static_cast<double>(n);
+        }
+    });
+}
+
+// Check the times / charges arguments of SensorAccumulator.add and
+// PartialStats and read them in place.
+SensorArrays sensor_arrays(const py::array& times, const py::object& charges_obj) {
+    if (times.ndim() != 1) {
+        throw std::invalid_argument("times must be a 1D array");
+    }
+    if (!charges_obj.is_none()) {
+        const auto charges = charges_obj.cast<py::array>();
+        if (charges.ndim() != 1 || charges.shape(0) != times.shape(0)) {
+            throw std::invalid_argument("charges must be 1D and match times length");
+        }
+    }
+    return SensorArrays(times, charges_obj);
+}
+
+std::shared_ptr<SensorAccumulator> make_sensor_accumulator(bool extended, std::shared_ptr<StatPlan> plan_ptr) {
+    return std::make_shared<SensorAccumulator>(resolve_plan(plan_ptr, extended));
+}
+
+void sensor_accumulator_add_py(SensorAccumulator& accumulator, py::array times, py::object charges_obj) {
+    const SensorArrays arrays = sensor_arrays(times, charges_obj);
+    with_sensor_columns(arrays.hits, [&](const auto& hits) {
+        accumulator.add(hits.times, hits.charges, hits.n_hits);
+    });
+}
+
+py::array sensor_accumulator_stats_py(const SensorAccumulator& accumulator, py::object out_obj, py::object dtype_obj) {
+    return stats_row_output(out_obj, accumulator.plan().num_stats(), single_precision_output(dtype_obj),
+                            [&](double* out) { accumulator.snapshot(thread_arena(), out); });
+}
+
+std::shared_ptr<PartialStats> make_partial_stats(py::array times, py::object charges_obj) {
+    const SensorArrays arrays = sensor_arrays(times, charges_obj);
+    std::shared_ptr<PartialStats> partial;
+    with_sensor_columns(arrays.hits, [&](const auto& hits) {
+        partial = std::make_shared<PartialStats>(hits.times, hits.charges, hits.n_hits);
+    });
+    return partial;
+}
+
+py::array partial_stats_stats_py(
+    const PartialStats& partial,
+    bool extended,
+    py::object out_obj,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj) {
+    const StatPlan& plan = resolve_plan(plan_ptr, extended);
+    return stats_row_output(out_obj, plan.num_stats(), single_precision_output(dtype_obj), [&](double* out) {
+        py::gil_scoped_release release;
+        partial.evaluate(plan, thread_arena(), out);
+    });
+}
+
+// The position and statistics tables of an event entry point. float64 tables
+// are filled in place by the kernels; for float32 output the kernels fill
+// scratch rows, which narrow() rounds into the returned tables.
+class EventTables {
+public:
+    EventTables(const py::object& out_obj, const py::object& out_positions_obj, std::size_t n_rows,
+                std::size_t num_stats, bool single_precision, ScratchArena& arena)
+        : n_rows_(n_rows), num_stats_(num_stats) {
+        if (single_precision) {
+            positions_single_ = output_array<float>(out_positions_obj, "out_positions", n_rows, 3, positions_array_);
+            stats_single_ = output_array<float>(out_obj, "out", n_rows, num_stats, stats_array_);
+            positions_ = arena.allocate<double>(n_rows * 3);
+            stats_ = arena.allocate<double>(n_rows * num_stats);
+        } else {
+            positions_ = output_array(out_positions_obj, "out_positions", n_rows, 3, positions_array_);
+            stats_ = output_array(out_obj, "out", n_rows, num_stats, stats_array_);
+        }
+    }
+
+    double* positions() const { return positions_; }
+    double* stats() const { return stats_; }
+
+    // Round rows [begin, end) into the float32 tables; no-op for float64 ones.
+    void narrow(std::size_t begin, std::size_t end) const {
+        if (stats_single_ == nullptr) {
+            return;
+        }
+        std::copy(positions_ + begin * 3, positions_ + end * 3, positions_single_ + begin * 3);
+        std::copy(stats_ + begin * num_stats_, stats_ + end * num_stats_, stats_single_ + begin * num_stats_);
+    }
+
+    py::array positions_array() const { return leading_rows(positions_array_, n_rows_); }
+    py::array stats_array() const { return leading_rows(stats_array_, n_rows_); }
+
+private:
+    std::size_t n_rows_;
+    std::size_t num_stats_;
+    py::array positions_array_;
+    py::array stats_array_;
+    double* positions_ = nullptr;
+    double* stats_ = nullptr;
+    float* positions_single_ = nullptr;
+    float* stats_single_ = nullptr;
+};
+
+// Unsigned key whose natural order matches the order of (string_id, sensor_id).
+inline uint64_t sensor_sort_key(int32_t string_id, int32_t sensor_id) {
+    const auto str = static_cast<uint32_t>(string_id) ^ 0x80000000u;
+    const auto sen = static_cast<uint32_t>(sensor_id) ^ 0x80000000u;
+    return (static_cast<uint64_t>(str) << 32) | sen;
+}
+
+struct RadixItem {
+    uint64_t sensor_key;
+    double time;
+    std::size_t index;
+};
+
+// Order hit indices by (string_id, sensor_id, time) in two levels: an LSD
+// radix sort on the 64-bit sensor key, one byte per pass, then a sort by time
+// within each sensor's now contiguous run. All byte histograms are gathered in
+// a single read of the hits and passes whose byte is the same for every hit
+// (typically the high bytes of the IDs) are skipped, so a detector with a few
+// thousand sensors costs two scatter passes. Runs that are already in time
+// order, as they usually are, are not sorted again; a bright sensor's run is
+// sorted on up to max_threads threads. Ties keep input order.
+template<typename Hits>
+void radix_sort_hits(const Hits& hits, std::size_t* order, std::size_t max_threads, ScratchArena& arena) {
+    constexpr std::size_t kKeyBytes = sizeof(uint64_t);
+    const std::size_t n = hits.n_hits;
+
+    ScratchScope scope(arena);
+    RadixItem* items = arena.allocate<RadixItem>(n);
+    RadixItem* swap = arena.allocate<RadixItem>(n);
+    auto* counts = arena.allocate<std::array<std::size_t, 256>>(kKeyBytes);
+    std::fill(counts, counts + kKeyBytes, std::array<std::size_t, 256>{});
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const uint64_t key = sensor_sort_key(static_cast<int32_t>(hits.string_ids[i]),
+                                             static_cast<int32_t>(hits.sensor_ids[i]));
+        items[i] = RadixItem{key, hits.time(i), i};
+        for (std::size_t b = 0; b < kKeyBytes; ++b) {
+            ++counts[b][(key >> (8 * b)) & 0xff];
+        }
+    }
+
+    for (std::size_t pass = 0; pass < kKeyBytes; ++pass) {
+        const std::size_t shift = 8 * pass;
+        std::array<std::size_t, 256>& bucket = counts[pass];
+        if (bucket[(items[0].sensor_key >> shift) & 0xff] == n) {
+            continue;
+        }
+        std::size_t offset = 0;
+        for (std::size_t& count : bucket) {
+            const std::size_t c = count;
+            count = offset;
+            offset += c;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            swap[bucket[(items[i].sensor_key >> shift) & 0xff]++] = items[i];
+        }
+        std::swap(items, swap);
+    }
+
+    std::size_t start = 0;
+    bool run_sorted = true;
+    for (std::size_t i = 1; i <= n; ++i) {
+        if (i < n && items[i].sensor_key == items[start].sensor_key) {
+            run_sorted = run_sorted && !(items[i].time < items[i - 1].time);
+            continue;
+        }
+        if (!run_sorted) {
+            const std::size_t n_workers = i - start >= kParallelSensorHits ? max_threads : 1;
+            parallel_sort(items + start, items + i, [](const RadixItem& a, const RadixItem& b) {
+                if (a.time != b.time) {
+                    return a.time < b.time;
+                }
+                return a.index < b.index;
+            }, n_workers, arena);
+        }
+        start = i;
+        run_sorted = true;
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+        order[i] = items[i].index;
+    }
+}
+
+// The (string_id, sensor_id) ranges spanned by the hits of an event. Slots
+// number every pair in the ranges in (string_id, sensor_id) order. IDs read
+// from wider columns must fit in int32.
+struct SensorIdRange {
+    int32_t min_string_id = 0;
+    int32_t min_sensor_id = 0;
+    uint64_t n_string_slots = 0;
+    uint64_t n_sensor_slots = 0;
+
+    template<typename Hits>
+    explicit SensorIdRange(const Hits& hits) {
+        using Id = typename Hits::IdType;
+        const std::size_t n = hits.n_hits;
+        if (n == 0) return;
+        Id min_string = hits.string_ids[0];
+        Id max_string = min_string;
+        Id min_sensor = hits.sensor_ids[0];
+        Id max_sensor = min_sensor;
+        for (std::size_t i = 1; i < n; ++i) {
+            min_string = std::min(min_string, hits.string_ids[i]);
+            max_string = std::max(max_string, hits.string_ids[i]);
+            min_sensor = std::min(min_sensor, hits.sensor_ids[i]);
+            max_sensor = std::max(max_sensor, hits.sensor_ids[i]);
+        }
+        if constexpr (sizeof(Id) > sizeof(int32_t)) {
+            constexpr Id lowest = std::numeric_limits<int32_t>::min();
+            constexpr Id highest = std::numeric_limits<int32_t>::max();
+            if (min_string < lowest || max_string > highest || min_sensor < lowest || max_sensor > highest) {
+                throw std::invalid_argument(kIdRangeMessage);
+            }
+        }
+        min_string_id = static_cast<int32_t>(min_string);
+        min_sensor_id = static_cast<int32_t>(min_sensor);
+        n_string_slots = static_cast<uint64_t>(int64_t(max_string) - min_string + 1);
+        n_sensor_slots = static_cast<uint64_t>(int64_t(max_sensor) - min_sensor + 1);
+    }
+
+    // Whether the ranges span at most max_slots slots.
+    bool fits(std::size_t max_slots) const {
+        return n_string_slots != 0 && n_string_slots <= max_slots / n_sensor_slots;
+    }
+
+    std::size_t n_slots() const { return static_cast<std::size_t>(n_string_slots * n_sensor_slots); }
+
+    std::size_t slot(int32_t string_id, int32_t sensor_id) const {
+        return static_cast<std::size_t>(int64_t(string_id) - min_string_id) * n_sensor_slots +
+               static_cast<std::size_t>(int64_t(sensor_id) - min_sensor_id);
+    }
+};
+
+// Order hit indices by (string_id, sensor_id, time) without comparing IDs: a
+// counting sort over the sensor slots (histogram, prefix sum, stable scatter)
+// groups the hits by sensor in O(n + slots), then each sensor's run is sorted
+// by time unless it already is in time order (on up to max_threads threads for
+// a bright sensor). Ties keep input order.
+template<typename Hits>
+void counting_sort_hits(
+    const Hits& hits,
+    const SensorIdRange& range,
+    std::size_t* order,
+    std::size_t max_threads,
+    ScratchArena& arena) {
+    const std::size_t n = hits.n_hits;
+    const std::size_t n_slots = range.n_slots();
+    const auto* times = hits.times;
+
+    ScratchScope scope(arena);
+    auto* slots = arena.allocate<uint32_t>(n);
+    std::size_t* starts = arena.allocate<std::size_t>(n_slots + 1);
+    std::fill(starts, starts + n_slots + 1, 0);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto slot = static_cast<uint32_t>(range.slot(static_cast<int32_t>(hits.string_ids[i]),
+                                                           static_cast<int32_t>(hits.sensor_ids[i])));
+        slots[i] = slot;
+        ++starts[slot + 1];
+    }
+    for (std::size_t k = 0; k < n_slots; ++k) {
+        starts[k + 1] += starts[k];
+    }
+    // Scatter, leaving starts[k] at the end of slot k's run.
+    for (std::size_t i = 0; i < n; ++i) {
+        order[starts[slots[i]]++] = i;
+    }
+
+    std::size_t run_start = 0;
+    for (std::size_t k = 0; k < n_slots; ++k) {
+        const std::size_t run_end = starts[k];
+        if (run_end - run_start > 1) {
+            std::size_t* first = order + run_start;
+            std::size_t* last = order + run_end;
+            const bool sorted = std::adjacent_find(first, last, [&](std::size_t a, std::size_t b) {
+                return times[b] < times[a];
+            }) == last;
+            if (!sorted) {
+                const std::size_t n_workers = run_end - run_start >= kParallelSensorHits ? max_threads : 1;
+                parallel_sort(first, last, [&](std::size_t a, std::size_t b) {
+                    if (times[a] != times[b]) {
+                        return times[a] < times[b];
+                    }
+                    return a < b;
+                }, n_workers, arena);
+            }
+        }
+        run_start = run_end;
+    }
+}
+
+// Order hit indices by (string_id, sensor_id, time) with one comparison sort
+// over all three keys; ties keep input order. The fastest engine for small
+// events.
+template<typename Hits>
+void comparison_sort_hits(const Hits& hits, std::size_t* order) {
+    const auto* string_ptr = hits.string_ids;
+    const auto* sensor_ptr = hits.sensor_ids;
+    const auto* times_ptr = hits.times;
+    std::iota(order, order + hits.n_hits, 0);
+    std::sort(order, order + hits.n_hits, [&](std::size_t a, std::size_t b) {
+        if (string_ptr[a] != string_ptr[b]) {
+            return string_ptr[a] < string_ptr[b];
+        }
+        if (sensor_ptr[a] != sensor_ptr[b]) {
+            return sensor_ptr[a] < sensor_ptr[b];
+        }
+        if (times_ptr[a] != times_ptr[b]) {
+            return times_ptr[a] < times_ptr[b];
+        }
+        return a < b;
+    });
+}
+
+// Sort the hits of one event by (string_id, sensor_id, time) and split them
+// into per-sensor segments. Hits that tie on all three keep their input
+// order. With a geometry, every sensor must be part of it. Bright sensors are
+// sorted on up to max_threads threads. Runs without the GIL.
+template<typename Hits>
+void build_event_layout(const EventInputs& event, const Hits& hits, EventLayout& layout, std::size_t max_threads) {
+    const std::size_t n_hits = hits.n_hits;
+    const auto* string_ptr = hits.string_ids;
+    const auto* sensor_ptr = hits.sensor_ids;
+
+    std::size_t* order = layout.order;
+    layout.sensor_offsets[0] = 0;
+    layout.n_sensors = 0;
+    if (n_hits == 0) {
+        return;
+    }
+
+    // Pick the grouping engine: a counting sort when the event's ID ranges are
+    // compact, else a radix sort for large events and a comparison sort for
+    // small ones. All three produce the same order.
+    const SensorIdRange range(hits);
+    const std::size_t max_slots =
+        std::min<std::size_t>(kCountingSortSlotsPerHit * n_hits, std::numeric_limits<uint32_t>::max());
+    if (range.fits(max_slots)) {
+        counting_sort_hits(hits, range, order, max_threads, thread_arena());
+    } else if (n_hits >= kRadixSortMinHits) {
+        radix_sort_hits(hits, order, max_threads, thread_arena());
+    } else {
+        comparison_sort_hits(hits, order);
+    }
+
+    std::size_t n_sensors = 0;
+    for (std::size_t i = 0; i < n_hits; ++i) {
+        const auto idx = order[i];
+        if (i == 0 || string_ptr[idx] != string_ptr[order[i - 1]] || sensor_ptr[idx] != sensor_ptr[order[i - 1]]) {
+            const auto string_id = static_cast<int32_t>(string_ptr[idx]);
+            const auto sensor_id = static_cast<int32_t>(sensor_ptr[idx]);
+            if (event.geometry != nullptr && event.geometry->index(string_id, sensor_id) < 0) {
+                throw std::invalid_argument(unknown_sensor_message(string_id, sensor_id));
+            }
+            if (i != 0) layout.sensor_offsets[n_sensors] = i;
+            layout.sensor_string_ids[n_sensors] = string_id;
+            layout.sensor_sensor_ids[n_sensors] = sensor_id;
+            ++n_sensors;
+        }
+    }
+    layout.sensor_offsets[n_sensors] = n_hits;
+    layout.n_sensors = n_sensors;
+}
+
+void build_event_layout(const EventInputs& event, EventLayout& layout, std::size_t max_threads) {
+    with_hit_columns(event, [&](const auto& hits) { build_event_layout(event, hits, layout, max_threads); });
+}
+
+struct PmtItem {
+    int64_t pmt_id;
+    std::size_t position;  // in the module's time-ordered run
+};
+
+// Regroup the hits of every module by pmt_id. A module's run is already in
+// (time, input index) order, so ordering it by (pmt_id, position in the run)
+// gives each PMT's hits in that order too; runs from a single PMT, the common
+// case, are copied as they are. Runs without the GIL.
+template<typename Pmt>
+void build_pmt_layout(const EventLayout& modules, const Pmt* pmt_ids, PmtLayout& out) {
+    EventLayout& pmts = out.pmts;
+    ScratchArena& arena = thread_arena();
+    ScratchScope scope(arena);
+    PmtItem* items = arena.allocate<PmtItem>(modules.sensor_offsets[modules.n_sensors]);
+
+    std::size_t n_pmts = 0;
+    for (std::size_t m = 0; m < modules.n_sensors; ++m) {
+        const std::size_t start = modules.sensor_offsets[m];
+        const std::size_t end = modules.sensor_offsets[m + 1];
+        const std::size_t n = end - start;
+        out.module_pmts[m] = n_pmts;
+
+        bool grouped = true;
+        for (std::size_t k = 0; k < n; ++k) {
+            items[k] = PmtItem{static_cast<int64_t>(pmt_ids[modules.order[start + k]]), k};
+            grouped = grouped && (k == 0 || !(items[k].pmt_id < items[k - 1].pmt_id));
+        }
+        if (!grouped) {
+            std::sort(items, items + n, [](const PmtItem& a, const PmtItem& b) {
+                return a.pmt_id != b.pmt_id ? a.pmt_id < b.pmt_id : a.position < b.position;
+            });
+        }
+        for (std::size_t k = 0; k < n; ++k) {
+            pmts.order[start + k] = modules.order[start + items[k].position];
+            if (k == 0 || items[k].pmt_id != items[k - 1].pmt_id) {
+                pmts.sensor_offsets[n_pmts] = start + k;
+                pmts.sensor_string_ids[n_pmts] = modules.sensor_string_ids[m];
+                pmts.sensor_sensor_ids[n_pmts] = modules.sensor_sensor_ids[m];
+                ++n_pmts;
+            }
+        }
+    }
+    pmts.sensor_offsets[n_pmts] = modules.sensor_offsets[modules.n_sensors];
+    pmts.n_sensors = n_pmts;
+    pmts.neighbor_counts = nullptr;
+    out.module_pmts[modules.n_sensors] = n_pmts;
+}
+
+// Which sensors of an event are neighbors, and when two of them coincide:
+// some hit of one lies within window_ns of a hit of the other. Neighbors are
+// the sensors of the same string at most max_id_distance sensor IDs apart or,
+// with a radius, all sensors within that distance of each other. A sensor's
+// neighbor count is reported once it reaches multiplicity, else 0.
+struct NeighborRule {
+    double window_ns = 1000.0;
+    int32_t max_id_distance = 2;
+    double radius = 0.0;  // 0: neighbors by sensor ID
+    std::size_t multiplicity = 1;
+
+    NeighborRule() = default;
+
+    NeighborRule(double window, int32_t id_distance, std::optional<double> radius_opt, int64_t min_count)
+        : window_ns(window), max_id_distance(id_distance), radius(radius_opt.value_or(0.0)) {
+        if (!std::isfinite(window) || window < 0.0) {
+            throw std::invalid_argument("window_ns must be finite and non-negative");
+        }
+        if (id_distance < 1) {
+            throw std::invalid_argument("max_id_distance must be at least 1");
+        }
+        if (radius_opt && !(std::isfinite(*radius_opt) && *radius_opt > 0.0)) {
+            throw std::invalid_argument("radius must be finite and positive");
+        }
+        if (min_count < 1) {
+            throw std::invalid_argument("multiplicity must be at least 1");
+        }
+        multiplicity = static_cast<std::size_t>(min_count);
+    }
+
+    bool spatial() const { return radius > 0.0; }
+};
+
+// The neighbors of every hit sensor of an event under a NeighborRule. By ID
+// they are read off the layout, where one string's sensors are contiguous and
+// ordered by ID, so the scan stops at the first sensor too many IDs away
+// however many are unhit. By radius they come from a uniform grid over the
+// sensor positions with cells one radius wide, hashed into buckets: only the
+// 27 cells around a sensor can hold its neighbors. Built once per event,
+// then read concurrently.
+class SensorNeighbors {
+public:
+    SensorNeighbors(const NeighborRule& rule, const EventLayout& layout, const double* positions, ScratchArena& arena)
+        : rule_(rule), layout_(layout), positions_(positions) {
+        if (!rule.spatial()) {
+            return;
+        }
+        const std::size_t n = layout.n_sensors;
+        mask_ = 1;
+        while (mask_ < 2 * n) mask_ <<= 1;
+        cells_ = arena.allocate<Cell>(n);
+        bucket_starts_ = arena.allocate<std::size_t>(mask_ + 1);
+        members_ = arena.allocate<uint32_t>(n);
+        --mask_;
+
+        // Counting sort of the sensors by bucket.
+        std::fill(bucket_starts_, bucket_starts_ + mask_ + 2, 0);
+        for (std::size_t s = 0; s < n; ++s) {
+            for (std::size_t d = 0; d < 3; ++d) {
+                const double c = std::floor(positions[s * 3 + d] / rule.radius);
+                cells_[s][d] = std::isnan(c) ? 0 : static_cast<int64_t>(std::clamp(c, -kMaxCell, kMaxCell));
+            }
+            ++bucket_starts_[bucket(cells_[s]) + 1];
+        }
+        for (std::size_t b = 0; b <= mask_; ++b) {
+            bucket_starts_[b + 1] += bucket_starts_[b];
+        }
+        for (std::size_t s = 0; s < n; ++s) {
+            members_[bucket_starts_[bucket(cells_[s])]++] = static_cast<uint32_t>(s);
+        }
+        // The scatter left each start at the end of its bucket; shift back.
+        for (std::size_t b = mask_ + 1; b > 0; --b) {
+            bucket_starts_[b] = bucket_starts_[b - 1];
+        }
+        bucket_starts_[0] = 0;
+    }
+
+    SensorNeighbors(const SensorNeighbors&) = delete;
+    SensorNeighbors& operator=(const SensorNeighbors&) = delete;
+
+    // Call visit(other) for every neighbor of sensor s.
+    template<typename Visit>
+    void for_each(std::size_t s, Visit&& visit) const {
+        if (!rule_.spatial()) {
+            const int32_t string_id = layout_.sensor_string_ids[s];
+            const int64_t sensor_id = layout_.sensor_sensor_ids[s];
+            const auto near = [&](std::size_t other) {
+                return layout_.sensor_string_ids[other] == string_id &&
+                       std::abs(layout_.sensor_sensor_ids[other] - sensor_id) <= rule_.max_id_distance;
+            };
+            for (std::size_t other = s; other > 0 && near(other - 1); --other) {
+                visit(other - 1);
+            }
+            for (std::size_t other = s + 1; other < layout_.n_sensors && near(other); ++other) {
+                visit(other);
+            }
+            return;
+        }
+
+        const double r2 = rule_.radius * rule_.radius;
+        const double* p = positions_ + s * 3;
+        for (int64_t dx = -1; dx <= 1; ++dx) {
+            for (int64_t dy = -1; dy <= 1; ++dy) {
+                for (int64_t dz = -1; dz <= 1; ++dz) {
+                    const Cell cell{cells_[s][0] + dx, cells_[s][1] + dy, cells_[s][2] + dz};
+                    const std::size_t b = bucket(cell);
+                    for (std::size_t k = bucket_starts_[b]; k < bucket_starts_[b + 1]; ++k) {
+                        const std::size_t other = members_[k];
+                        // Buckets are shared by colliding cells; keep this cell's sensors.
+                        if (other == s || cells_[other] != cell) continue;
+                        const double* q = positions_ + other * 3;
+                        const double ex = q[0] - p[0], ey = q[1] - p[1], ez = q[2] - p[2];
+                        if (ex * ex + ey * ey + ez * ez <= r2) visit(other);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    using Cell = std::array<int64_t, 3>;
+    static constexpr double kMaxCell = 1e15;  // cell coordinates stay far from int64 overflow
+
+    std::size_t bucket(const Cell& cell) const {
+        const auto h = static_cast<uint64_t>(cell[0]) * 0x9E3779B97F4A7C15ull ^
+                       static_cast<uint64_t>(cell[1]) * 0xC2B2AE3D27D4EB4Full ^
+                       static_cast<uint64_t>(cell[2]) * 0x165667B19E3779F9ull;
+        return static_cast<std::size_t>(h ^ (h >> 29)) & mask_;
+    }
+
+    const NeighborRule& rule_;
+    const EventLayout& layout_;
+    const double* positions_;
+    std::size_t mask_ = 0;
+    Cell* cells_ = nullptr;
+    std::size_t* bucket_starts_ = nullptr;
+    uint32_t* members_ = nullptr;
+};
+
+// Whether a hit of sensor run [a, a_end) lies within window_ns of one of run
+// [b, b_end). Both runs are in time order, so one merge-scan decides it:
+// a hit more than the window before the other run's current hit cannot match
+// any later one either.
+template<typename Hits>
+bool runs_coincide(const Hits& hits, const std::size_t* order, std::size_t a, std::size_t a_end,
+                   std::size_t b, std::size_t b_end, double window_ns) {
+    if (hits.time(order[b]) - hits.time(order[a_end - 1]) > window_ns ||
+        hits.time(order[a]) - hits.time(order[b_end - 1]) > window_ns) {
+        return false;
+    }
+    while (a < a_end && b < b_end) {
+        const double ta = hits.time(order[a]);
+        const double tb = hits.time(order[b]);
+        if (std::abs(ta - tb) <= window_ns) return true;
+        if (ta < tb) ++a; else ++b;
+    }
+    return false;
+}
+
+// Add 1 to matches[i - a] for every hit i of run [a, a_end) with a hit of run
+// [b, b_end) within window_ns, under the same test as runs_coincide; returns
+// whether any hit matched. One pointer sweeps each time-ordered run: the b
+// hits more than the window before one a hit are before every later one too.
+template<typename Hits>
+bool match_coincident_hits(const Hits& hits, const std::size_t* order, std::size_t a, std::size_t a_end,
+                           std::size_t b, std::size_t b_end, double window_ns, uint32_t* matches) {
+    if (hits.time(order[b]) - hits.time(order[a_end - 1]) > window_ns ||
+        hits.time(order[a]) - hits.time(order[b_end - 1]) > window_ns) {
+        return false;
+    }
+    bool any = false;
+    for (std::size_t i = a; i < a_end; ++i) {
+        const double ta = hits.time(order[i]);
+        while (b < b_end && hits.time(order[b]) < ta && ta - hits.time(order[b]) > window_ns) {
+            ++b;
+        }
+        if (b == b_end) break;
+        if (std::abs(ta - hits.time(order[b])) <= window_ns) {
+            ++matches[i - a];
+            any = true;
+        }
+    }
+    return any;
+}
+
+// Position of sensor s of an event: from the geometry, or else from its earliest hit.
+void write_sensor_position(const EventInputs& event, const EventLayout& layout, std::size_t s, double* out) {
+    if (event.geometry != nullptr) {
+        const double* position = event.geometry->position(
+            event.geometry->index(layout.sensor_string_ids[s], layout.sensor_sensor_ids[s]));
+        std::copy(position, position + 3, out);
+        return;
+    }
+    const std::size_t first_idx = layout.order[layout.sensor_offsets[s]];
+    out[0] = event.pos_x.value(first_idx);
+    out[1] = event.pos_y.value(first_idx);
+    out[2] = event.pos_z.value(first_idx);
+}
+
+// The neighbor pass of an event: counts[s] receives the number of neighbors
+// of sensor s in coincidence with it (before the multiplicity cut) and, when
+// given, flags[i] (input order) whether hit i coincides with hits on at least
+// multiplicity neighbors, i.e. is an HLC hit. Each sensor's pairs are
+// merge-scanned by the task owning it, and it writes only its own counts and
+// flags, so the result is the same for any number of workers. positions holds
+// the sensor positions for a spatial rule.
+template<typename Hits>
+void scan_neighbors(
+    const Hits& hits,
+    const EventLayout& layout,
+    const NeighborRule& rule,
+    const double* positions,
+    std::size_t max_threads,
+    std::size_t* counts,
+    uint8_t* flags) {
+    const std::size_t n_sensors = layout.n_sensors;
+    const std::size_t* order = layout.order;
+    const std::size_t* offsets = layout.sensor_offsets;
+    const std::size_t n_workers = std::min(max_threads, std::max<std::size_t>(1, hits.n_hits / kMinHitsPerWorker));
+
+    ScratchScope scope(thread_arena());
+    const SensorNeighbors neighbors(rule, layout, positions, thread_arena());
+    const SensorSchedule tasks(offsets, n_sensors, n_workers == 1 ? 1 : n_workers * kChunksPerWorker, thread_arena());
+    parallel_for(tasks.size(), n_workers, [&](std::size_t task) {
+        ScratchArena& arena = thread_arena();
+        for (std::size_t s = tasks.begin(task); s < tasks.end(task); ++s) {
+            const std::size_t start = offsets[s];
+            const std::size_t end = offsets[s + 1];
+            std::size_t count = 0;
+            if (flags == nullptr) {
+                neighbors.for_each(s, [&](std::size_t other) {
+                    count += runs_coincide(hits, order, start, end, offsets[other], offsets[other + 1], rule.window_ns);
+                });
+                counts[s] = count;
+                continue;
+            }
+
+            ScratchScope sensor_scope(arena);
+            uint32_t* matches = arena.allocate<uint32_t>(end - start);
+            std::fill(matches, matches + (end - start), 0u);
+            neighbors.for_each(s, [&](std::size_t other) {
+                count += match_coincident_hits(hits, order, start, end, offsets[other], offsets[other + 1],
+                                               rule.window_ns, matches);
+            });
+            counts[s] = count;
+            for (std::size_t i = start; i < end; ++i) {
+                flags[order[i]] = matches[i - start] >= rule.multiplicity ? 1 : 0;
+            }
+        }
+    });
+}
+
+// Noise cleaning of an event's hits ahead of the statistics. Seeded RT
+// cleaning starts from the HLC hits and repeatedly adds every hit within
+// srt_time_ns of a hit already kept on a sensor at most srt_radius away (its
+// own sensor included), until a round adds nothing or srt_iterations rounds
+// have run. Time-window cleaning then keeps only the hits in the densest
+// time_window_ns window, the earliest one on ties.
+struct HitCleaning {
+    double time_window_ns = 0.0;     // 0: no time-window cleaning
+    double srt_radius = 0.0;         // 0: no seeded RT cleaning
+    double srt_time_ns = 1000.0;
+    std::size_t srt_iterations = 0;  // 0: until a round adds no hit
+
+    HitCleaning() = default;
+
+    HitCleaning(std::optional<double> window, std::optional<double> radius, double srt_time,
+                std::optional<int64_t> iterations)
+        : time_window_ns(window.value_or(0.0)), srt_radius(radius.value_or(0.0)), srt_time_ns(srt_time) {
+        if (window && !(std::isfinite(*window) && *window > 0.0)) {
+            throw std::invalid_argument("time_window_ns must be finite and positive");
+        }
+        if (radius && !(std::isfinite(*radius) && *radius > 0.0)) {
+            throw std::invalid_argument("srt_radius must be finite and positive");
+        }
+        if (!std::isfinite(srt_time) || srt_time < 0.0) {
+            throw std::invalid_argument("srt_time_ns must be finite and non-negative");
+        }
+        if (iterations && *iterations < 1) {
+            throw std::invalid_argument("srt_iterations must be at least 1");
+        }
+        srt_iterations = iterations ? static_cast<std::size_t>(*iterations) : 0;
+    }
+
+    bool seeded_rt() const { return srt_radius > 0.0; }
+    bool time_window() const { return time_window_ns > 0.0; }
+    bool active() const { return seeded_rt() || time_window(); }
+};
+
+// Per-hit selection requested from an event entry point: HLC flags, and
+// which hits enter the statistics.
+struct HitSelection {
+    bool return_flags = false;              // return the HLC flag of every hit
+    bool hlc_only = false;                  // keep only the HLC hits
+    const HitCleaning* cleaning = nullptr;  // noise cleaning, if any
+
+    bool cleans() const { return cleaning != nullptr && cleaning->active(); }
+    bool needs_hlc() const { return return_flags || hlc_only || (cleaning != nullptr && cleaning->seeded_rt()); }
+    bool drops_hits() const { return hlc_only || cleans(); }
+    bool active() const { return return_flags || drops_hits(); }
+};
+
+// Set added[i - a] for every hit i of run [a, a_end) with a kept hit of run
+// [b, b_end) within window_ns (kept is indexed by input hit). The pointer into
+// the b run only moves forward: hits more than the window before one a hit
+// are before every later one too.
+template<typename Hits>
+void match_kept_hits(const Hits& hits, const std::size_t* order, std::size_t a, std::size_t a_end,
+                     std::size_t b, std::size_t b_end, double window_ns, const uint8_t* kept, uint8_t* added) {
+    for (std::size_t i = a; i < a_end; ++i) {
+        const double ta = hits.time(order[i]);
+        while (b < b_end && hits.time(order[b]) < ta && ta - hits.time(order[b]) > window_ns) {
+            ++b;
+        }
+        if (added[i - a]) continue;
+        for (std::size_t k = b; k < b_end; ++k) {
+            const double tb = hits.time(order[k]);
+            if (!(std::abs(ta - tb) <= window_ns)) {
+                if (!(tb < ta)) break;
+                continue;
+            }
+            if (kept[order[k]]) {
+                added[i - a] = 1;
+                break;
+            }
+        }
+    }
+}
+
+// Seeded RT cleaning: keep (input order) holds the seeds on entry and every
+// hit connected to them on return. Each round reads the previous round's hits
+// only, so the result does not depend on the number of workers.
+template<typename Hits>
+void seeded_rt_cleaning(
+    const Hits& hits,
+    const EventLayout& layout,
+    const HitCleaning& cleaning,
+    const double* positions,
+    std::size_t max_threads,
+    uint8_t* keep) {
+    const std::size_t n_sensors = layout.n_sensors;
+    const std::size_t* order = layout.order;
+    const std::size_t* offsets = layout.sensor_offsets;
+    const std::size_t n_workers = std::min(max_threads, std::max<std::size_t>(1, hits.n_hits / kMinHitsPerWorker));
+
+    ScratchArena& arena = thread_arena();
+    ScratchScope scope(arena);
+    NeighborRule rt_rule;
+    rt_rule.radius = cleaning.srt_radius;
+    const SensorNeighbors neighbors(rt_rule, layout, positions, arena);
+    const SensorSchedule tasks(offsets, n_sensors, n_workers == 1 ? 1 : n_workers * kChunksPerWorker, arena);
+    uint8_t* next = arena.allocate<uint8_t>(hits.n_hits);
+
+    for (std::size_t round = 0; cleaning.srt_iterations == 0 || round < cleaning.srt_iterations; ++round) {
+        std::atomic<bool> grown{false};
+        parallel_for(tasks.size(), n_workers, [&](std::size_t task) {
+            ScratchArena& task_arena = thread_arena();
+            for (std::size_t s = tasks.begin(task); s < tasks.end(task); ++s) {
+                const std::size_t start = offsets[s];
+                const std::size_t end = offsets[s + 1];
+                ScratchScope sensor_scope(task_arena);
+                uint8_t* added = task_arena.allocate<uint8_t>(end - start);
+                bool complete = true;
+                for (std::size_t i = start; i < end; ++i) {
+                    added[i - start] = keep[order[i]];
+                    complete = complete && added[i - start];
+                }
+                if (!complete) {
+                    match_kept_hits(hits, order, start, end, start, end, cleaning.srt_time_ns, keep, added);
+                    neighbors.for_each(s, [&](std::size_t other) {
+                        match_kept_hits(hits, order, start, end, offsets[other], offsets[other + 1],
+                                        cleaning.srt_time_ns, keep, added);
+                    });
+                }
+                bool sensor_grown = false;
+                for (std::size_t i = start; i < end; ++i) {
+                    next[order[i]] = added[i - start];
+                    sensor_grown = sensor_grown || added[i - start] != keep[order[i]];
+                }
+                if (sensor_grown) grown.store(true, std::memory_order_relaxed);
+            }
+        });
+        std::copy(next, next + hits.n_hits, keep);
+        if (!grown.load()) break;
+    }
+}
+
+// Walks the kept, non-NaN hits of an event in time order by a k-way merge of
+// its sensors' runs, which the layout already holds in time order.
+template<typename Hits>
+class KeptHitMerge {
+public:
+    KeptHitMerge(const Hits& hits, const EventLayout& layout, const uint8_t* keep, ScratchArena& arena)
+        : hits_(hits), order_(layout.order), keep_(keep), heads_(arena.allocate<Head>(layout.n_sensors)) {
+        for (std::size_t s = 0; s < layout.n_sensors; ++s) {
+            push(layout.sensor_offsets[s], layout.sensor_offsets[s + 1]);
+        }
+    }
+
+    bool empty() const { return n_heads_ == 0; }
+
+    // Time of the next hit; only valid when not empty().
+    double peek() const { return heads_[0].time; }
+
+    void pop() {
+        std::pop_heap(heads_, heads_ + n_heads_, later);
+        const Head head = heads_[--n_heads_];
+        push(head.position + 1, head.end);
+    }
+
+private:
+    struct Head {
+        double time;
+        std::size_t position;  // in layout.order
+        std::size_t end;       // of the sensor's run
+    };
+
+    static bool later(const Head& a, const Head& b) {
+        return a.time != b.time ? a.time > b.time : a.position > b.position;
+    }
+
+    // Enter the first kept, non-NaN hit of order[position, end), if any.
+    void push(std::size_t position, std::size_t end) {
+        for (; position < end; ++position) {
+            const auto idx = order_[position];
+            const double t = hits_.time(idx);
+            if (keep_[idx] && !std::isnan(t)) {
+                heads_[n_heads_++] = Head{t, position, end};
+                std::push_heap(heads_, heads_ + n_heads_, later);
+                return;
+            }
+        }
+    }
+
+    const Hits& hits_;
+    const std::size_t* order_;
+    const uint8_t* keep_;
+    Head* heads_;
+    std::size_t n_heads_ = 0;
+};
+
+// Time-window cleaning: of the hits set in keep, clear all but those in the
+// window_ns window holding most of them. Candidate windows start at a kept
+// hit; the earliest of equally full ones wins. Two merges over the sensors'
+// time-ordered runs give the start and the end of the sliding window, so the
+// hits are never sorted again.
+template<typename Hits>
+void time_window_cleaning(const Hits& hits, const EventLayout& layout, double window_ns, uint8_t* keep) {
+    ScratchArena& arena = thread_arena();
+    ScratchScope scope(arena);
+    KeptHitMerge<Hits> starts(hits, layout, keep, arena);
+    KeptHitMerge<Hits> ends(hits, layout, keep, arena);
+    if (starts.empty()) {
+        return;
+    }
+    double first = starts.peek();
+    std::size_t best_count = 0;
+    // inside counts the hits from the current start up to the window's end.
+    for (std::size_t inside = 0; !starts.empty(); starts.pop(), --inside) {
+        const double start = starts.peek();
+        const double last = start + window_ns;
+        while (!ends.empty() && ends.peek() <= last) {
+            ends.pop();
+            ++inside;
+        }
+        if (inside > best_count) {
+            best_count = inside;
+            first = start;
+        }
+    }
+    const double last = first + window_ns;
+    for (std::size_t i = 0; i < hits.n_hits; ++i) {
+        const double t = hits.time(i);
+        keep[i] = keep[i] && t >= first && t <= last;
+    }
 }
 
-bool is_sorted(const std::vector<double>& values) {
-    for (std::size_t i = 1; i < values.size(); ++i) {
-        if (values[i - 1] > values[i]) {
-            return false;
+// Drop the hits not set in keep (input order) from the layout in place, with
+// any sensor left without hits. A kept run never starts after its sensor's
+// old run, so one forward sweep suffices.
+void compact_layout(EventLayout& layout, const uint8_t* keep) {
+    std::size_t kept = 0;
+    std::size_t kept_sensors = 0;
+    std::size_t begin = layout.sensor_offsets[0];
+    for (std::size_t s = 0; s < layout.n_sensors; ++s) {
+        const std::size_t end = layout.sensor_offsets[s + 1];
+        const std::size_t first = kept;
+        for (std::size_t i = begin; i < end; ++i) {
+            if (keep[layout.order[i]]) {
+                layout.order[kept++] = layout.order[i];
+            }
         }
+        begin = end;
+        if (kept == first) continue;
+        layout.sensor_offsets[kept_sensors] = first;
+        layout.sensor_string_ids[kept_sensors] = layout.sensor_string_ids[s];
+        layout.sensor_sensor_ids[kept_sensors] = layout.sensor_sensor_ids[s];
+        ++kept_sensors;
     }
-    return true;
+    layout.sensor_offsets[kept_sensors] = kept;
+    layout.n_sensors = kept_sensors;
 }
 
-void sort_by_time(std::vector<double>& times, std::vector<double>& charges) {
-    std::vector<std::size_t> order(times.size());
-    std::iota(order.begin(), order.end(), 0);
-    // Stable ordering is not required here; equal-time elements have identical
-    // timestamps so the chosen representative for a bin is unchanged.
-    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
-        return times[a] < times[b];
-    });
-    std::vector<double> sorted_times(times.size());
-    std::vector<double> sorted_charges(charges.size());
-    for (std::size_t i = 0; i < order.size(); ++i) {
-        sorted_times[i] = times[order[i]];
-        sorted_charges[i] = charges[order[i]];
-    }
-    times.swap(sorted_times);
-    charges.swap(sorted_charges);
-}
-
-std::pair<std::vector<double>, std::vector<double>> group_hits_by_window(
-    const std::vector<double>& times,
-    const std::vector<double>& charges,
-    double window_ns) {
-    if (times.empty()) {
-        return {std::vector<double>{}, std::vector<double>{}};
-    }
-    std::vector<double> grouped_times;
-    std::vector<double> grouped_charges;
-    grouped_times.reserve(times.size());
-    grouped_charges.reserve(times.size());
-
-    const double base_time = times.front();
-    double bin_time = times.front();
-    double bin_charge = charges.front();
-    auto current_bin = static_cast<long long>(0);
-    double current_bin_end = base_time + window_ns;  // end of current bin (exclusive)
-
-    for (std::size_t i = 1; i < times.size(); ++i) {
-        const double time = times[i];
-        if (time < current_bin_end) {
-            bin_charge += charges[i];
-        } else {
-            // Finish the current non-empty bin.
-            grouped_times.push_back(bin_time);
-            grouped_charges.push_back(bin_charge);
-            // Jump directly to the bin containing this time without iterating per empty bin.
-            const auto new_bin = static_cast<long long>(std::floor((time - base_time) / window_ns));
-            current_bin = new_bin;
-            current_bin_end = base_time + (static_cast<double>(current_bin) + 1.0) * window_ns;
-            bin_time = time;
-            bin_charge = charges[i];
+// Run the per-hit stages ahead of the statistics, on the sorted layout:
+// the neighbor pass (HLC flags into flags, input order, or scratch when
+// null; neighbor counts into counts, room for one per hit), then seeded RT,
+// time-window and HLC-only selection on a per-hit mask. Only at the end are
+// the dropped hits removed from the layout, with any sensor left without
+// hits. The layout points at the counts unless hits were dropped, in which
+// case the statistics pass counts neighbors over the kept hits. Runs without
+// the GIL.
+template<typename Hits>
+void select_event_hits(
+    const EventInputs& event,
+    const Hits& hits,
+    EventLayout& layout,
+    const NeighborRule& rule,
+    const HitSelection& selection,
+    std::size_t max_threads,
+    std::size_t* counts,
+    uint8_t* flags) {
+    const std::size_t n_sensors = layout.n_sensors;
+    if (n_sensors == 0) {
+        return;
+    }
+    ScratchArena& arena = thread_arena();
+    ScratchScope scope(arena);
+    const HitCleaning* cleaning = selection.cleans() ? selection.cleaning : nullptr;
+    double* positions = nullptr;
+    if (rule.spatial() || (cleaning != nullptr && cleaning->seeded_rt())) {
+        positions = arena.allocate<double>(n_sensors * 3);
+        for (std::size_t s = 0; s < n_sensors; ++s) {
+            write_sensor_position(event, layout, s, positions + s * 3);
+        }
+    }
+    if (selection.needs_hlc()) {
+        if (flags == nullptr) {
+            flags = arena.allocate<uint8_t>(hits.n_hits);
         }
+        scan_neighbors(hits, layout, rule, positions, max_threads, counts, flags);
+        layout.neighbor_counts = counts;
+    }
+    if (!selection.drops_hits()) {
+        return;
     }
 
-    // Flush the final bin
-    grouped_times.push_back(bin_time);
-    grouped_charges.push_back(bin_charge);
-    return {std::move(grouped_times), std::move(grouped_charges)};
+    uint8_t* keep = arena.allocate<uint8_t>(hits.n_hits);
+    if (cleaning != nullptr && cleaning->seeded_rt()) {
+        std::copy(flags, flags + hits.n_hits, keep);
+        seeded_rt_cleaning(hits, layout, *cleaning, positions, max_threads, keep);
+    } else {
+        std::fill(keep, keep + hits.n_hits, uint8_t{1});
+    }
+    if (cleaning != nullptr && cleaning->time_window()) {
+        time_window_cleaning(hits, layout, cleaning->time_window_ns, keep);
+    }
+    if (selection.hlc_only) {
+        for (std::size_t i = 0; i < hits.n_hits; ++i) {
+            keep[i] = keep[i] && flags[i];
+        }
+    }
+    compact_layout(layout, keep);
+    layout.neighbor_counts = nullptr;
 }
 
-template<bool Extended>
-auto compute_stats_from_sorted(
-    const std::vector<double>& times,
-    const std::vector<double>& charges) {
-    constexpr std::size_t NumStats = Extended ? kNumStatsExtended : kNumStats;
-    const std::size_t n = times.size();
+void select_event_hits(
+    const EventInputs& event,
+    EventLayout& layout,
+    const NeighborRule& rule,
+    const HitSelection& selection,
+    std::size_t max_threads,
+    std::size_t* counts,
+    uint8_t* flags) {
+    with_hit_columns(event, [&](const auto& hits) {
+        select_event_hits(event, hits, layout, rule, selection, max_threads, counts, flags);
+    });
+}
 
-    if (n == 0) {
-        return empty_stats<NumStats>();
+// Compute positions and statistics for every sensor of an event, writing row s
+// of each table straight into positions_out / stats_out; with stat_rows, sensor
+// s writes statistics row stat_rows[s] instead. Runs without the GIL; the
+// per-sensor work is spread over up to max_threads threads and is
+// bit-identical for any count.
+template<typename Hits>
+void compute_event_stats(
+    const EventInputs& event,
+    const Hits& hits,
+    const EventLayout& layout,
+    const std::optional<double>& grouping_window_ns,
+    const StatPlan& plan,
+    const NeighborRule& neighbor_rule,
+    std::size_t max_threads,
+    double* positions_out,
+    double* stats_out,
+    const std::size_t* stat_rows = nullptr) {
+    const std::size_t n_hits = hits.n_hits;
+    const std::size_t n_sensors = layout.n_sensors;
+    if (n_sensors == 0) {
+        return;
     }
+    const std::size_t num_stats = plan.num_stats();
+    const std::size_t* order = layout.order;
+    const std::size_t* sensor_offsets = layout.sensor_offsets;
+    const bool unit_charges = hits.charges == nullptr;
+    const auto stats_row = [&](std::size_t s) {
+        return stats_out + (stat_rows != nullptr ? stat_rows[s] : s) * num_stats;
+    };
 
-    const double time = times.front();
-    const double charge = charges.front();
-
-    if (n == 1) {
-        if constexpr (Extended) {
-            return std::array<double, kNumStatsExtended>{
-                charge, charge, charge, time, time, time, time, time, 0.0,
-                time, time, time, time, time, time,
-                charge, charge, charge, charge, charge, charge,
-                1.0,    // n_pulses
-                1.0,    // q_max_frac (single pulse: max == total)
-                0.0,    // n_string_neighbors (filled by process_event)
-                0.0     // t_skewness (undefined for n < 3)
-            };
-        } else {
-            return std::array<double, kNumStats>{
-                charge, charge, charge, time, time, time, time, time, 0.0
-            };
-        }
-    }
+    // Each task owns a contiguous range of sensors and writes only its
+    // own rows, so the result is identical for any number of workers.
+    const bool grouped = grouping_window_ns.has_value() && grouping_window_ns.value() > 0.0;
+    const std::size_t n_workers = std::min(max_threads, std::max<std::size_t>(1, n_hits / kMinHitsPerWorker));
+    ScratchScope schedule_scope(thread_arena());
+    const SensorSchedule tasks(
+        sensor_offsets, n_sensors, n_workers == 1 ? 1 : n_workers * kChunksPerWorker, thread_arena());
 
-    const double first_time = times.front();
-    const double last_time = times.back();
+    parallel_for(tasks.size(), n_workers, [&](std::size_t task) {
+        ScratchArena& arena = thread_arena();
+        for (std::size_t s = tasks.begin(task); s < tasks.end(task); ++s) {
+            const std::size_t start = sensor_offsets[s];
+            const std::size_t end = sensor_offsets[s + 1];
+            const std::size_t n = end - start;
 
-    // First pass: totals, weighted moments, and fixed-window charges.
-    double total_charge = 0.0;
-    double sum_qt = 0.0;
-    double sum_qt2 = 0.0;
+            write_sensor_position(event, layout, s, positions_out + s * 3);
 
-    // Standard time windows
-    const double cutoff_100 = first_time + 100.0;
-    const double cutoff_500 = first_time + 500.0;
-    double charge_100 = 0.0;
-    double charge_500 = 0.0;
+            // Most sensors see one or two hits; their rows skip the gather.
+            double* row = stats_row(s);
+            if (n == 1 || (n == 2 && !grouped)) {
+                const auto first = order[start];
+                if (n == 1) {
+                    write_single_hit_row(plan, hits.time(first), hits.charge(first), row);
+                } else {
+                    const auto second = order[start + 1];
+                    const double pair_times[2] = {hits.time(first), hits.time(second)};
+                    const double pair_charges[2] = {hits.charge(first), hits.charge(second)};
+                    compute_stats_from_sorted(plan, pair_times, unit_charges ? nullptr : pair_charges, 2, arena,
+                                              row);
+                }
+                continue;
+            }
 
-    // Extended time windows
-    double charge_10 = 0.0, charge_20 = 0.0, charge_50 = 0.0;
-    double charge_200 = 0.0, charge_1000 = 0.0, charge_2000 = 0.0;
+            // Without charges only the times are gathered (unit charges).
+            ScratchScope scope(arena);
+            double* times_slice = arena.allocate<double>(n);
+            double* charges_slice = unit_charges ? nullptr : arena.allocate<double>(n);
+            const auto gather = [&](std::size_t begin, std::size_t end) {
+                if (unit_charges) {
+                    for (std::size_t i = begin; i < end; ++i) {
+                        times_slice[i] = hits.time(order[start + i]);
+                    }
+                    return;
+                }
+                for (std::size_t i = begin; i < end; ++i) {
+                    const auto idx = order[start + i];
+                    times_slice[i] = hits.time(idx);
+                    charges_slice[i] = static_cast<double>(hits.charges[idx]);
+                }
+            };
 
-    // Extended accumulators: max charge and third raw moment
-    double max_charge = 0.0;
-    double sum_qt3 = 0.0;
+            // A bright sensor's hits (already in time order) are gathered and
+            // reduced block by block across the workers.
+            if (n >= kParallelSensorHits && n_workers > 1 && !grouped) {
+                parallel_for((n + kSensorBlockHits - 1) / kSensorBlockHits, n_workers, [&](std::size_t b) {
+                    gather(b * kSensorBlockHits, std::min(n, (b + 1) * kSensorBlockHits));
+                });
+                compute_stats_from_sorted_parallel(plan, times_slice, charges_slice, n, n_workers, arena, row);
+                continue;
+            }
 
-    if constexpr (Extended) {
-        const double cutoff_10 = first_time + 10.0;
-        const double cutoff_20 = first_time + 20.0;
-        const double cutoff_50 = first_time + 50.0;
-        const double cutoff_200 = first_time + 200.0;
-        const double cutoff_1000 = first_time + 1000.0;
-        const double cutoff_2000 = first_time + 2000.0;
+            gather(0, n);
+            compute_stats_single_sensor_impl(plan, times_slice, charges_slice, n, grouping_window_ns, arena, row);
+        }
+    });
 
-        for (std::size_t i = 0; i < n; ++i) {
-            const double t = times[i];
-            const double q = charges[i];
-            total_charge += q;
-            sum_qt += q * t;
-            sum_qt2 += q * t * t;
-            sum_qt3 += q * t * t * t;
-            if (q > max_charge) max_charge = q;
-            if (t <= cutoff_10) charge_10 += q;
-            if (t <= cutoff_20) charge_20 += q;
-            if (t <= cutoff_50) charge_50 += q;
-            if (t <= cutoff_100) charge_100 += q;
-            if (t <= cutoff_200) charge_200 += q;
-            if (t <= cutoff_500) charge_500 += q;
-            if (t <= cutoff_1000) charge_1000 += q;
-            if (t <= cutoff_2000) charge_2000 += q;
+    // Post-processing: n_string_neighbors and n_pulses override
+    const std::ptrdiff_t neighbors_column = plan.neighbors_column();
+    if (neighbors_column >= 0) {
+        // Neighbor count: sensors under the rule with a hit in coincidence,
+        // merge-scanned on the pre-grouping times (time-sorted per sensor),
+        // unless the pass already ran ahead. The spatial grid reads the
+        // positions written above.
+        const std::size_t* counts = layout.neighbor_counts;
+        if (counts == nullptr) {
+            std::size_t* scanned = thread_arena().allocate<std::size_t>(n_sensors);
+            scan_neighbors(hits, layout, neighbor_rule, positions_out, max_threads, scanned, nullptr);
+            counts = scanned;
         }
-    } else {
-        for (std::size_t i = 0; i < n; ++i) {
-            const double t = times[i];
-            const double q = charges[i];
-            total_charge += q;
-            sum_qt += q * t;
-            sum_qt2 += q * t * t;
-            if (t <= cutoff_100) charge_100 += q;
-            if (t <= cutoff_500) charge_500 += q;
-        }
-    }
-
-    // Second pass: times at which charge percentiles are reached
-    double charge_20_time = first_time;
-    double charge_50_time = first_time;
-    double charge_5_time = first_time, charge_10_time = first_time;
-    double charge_25_time = first_time, charge_75_time = first_time;
-    double charge_90_time = first_time, charge_95_time = first_time;
-
-    if constexpr (Extended) {
-        const double threshold_5 = total_charge * 0.05;
-        const double threshold_10 = total_charge * 0.1;
-        const double threshold_20 = total_charge * 0.2;
-        const double threshold_25 = total_charge * 0.25;
-        const double threshold_50 = total_charge * 0.5;
-        const double threshold_75 = total_charge * 0.75;
-        const double threshold_90 = total_charge * 0.9;
-        const double threshold_95 = total_charge * 0.95;
-
-        double running = 0.0;
-        bool have_5 = false, have_10 = false, have_20 = false, have_25 = false;
-        bool have_50 = false, have_75 = false, have_90 = false, have_95 = false;
+        for (std::size_t s = 0; s < n_sensors; ++s) {
+            stats_row(s)[neighbors_column] =
+                counts[s] >= neighbor_rule.multiplicity ? static_cast<double>(counts[s]) : 0.0;
+        }
+    }
 
-        for (std::size_t i = 0; i < n; ++i) {
-            running += charges[i];
-            if (!have_5 && running > threshold_5) { charge_5_time = times[i]; have_5 = true; }
-            if (!have_10 && running > threshold_10) { charge_10_time = times[i]; have_10 = true; }
-            if (!have_20 && running > threshold_20) { charge_20_time = times[i]; have_20 = true; }
-            if (!have_25 && running > threshold_25) { charge_25_time = times[i]; have_25 = true; }
-            if (!have_50 && running > threshold_50) { charge_50_time = times[i]; have_50 = true; }
-            if (!have_75 && running > threshold_75) { charge_75_time = times[i]; have_75 = true; }
-            if (!have_90 && running > threshold_90) { charge_90_time = times[i]; have_90 = true; }
-            if (!have_95 && running > threshold_95) { charge_95_time = times[i]; have_95 = true; break; }
+    // Override n_pulses with pre-grouping count when grouping is applied
+    const std::ptrdiff_t n_pulses_column = plan.n_pulses_column();
+    if (n_pulses_column >= 0 && grouping_window_ns.has_value() && grouping_window_ns.value() > 0.0) {
+        for (std::size_t s = 0; s < n_sensors; ++s) {
+            stats_row(s)[n_pulses_column] = static_cast<double>(sensor_offsets[s + 1] - sensor_offsets[s]);
         }
-    } else {
-        const double threshold_20 = total_charge * 0.2;
-        const double threshold_50 = total_charge * 0.5;
-        double running = 0.0;
-        bool have_20 = false;
-        bool have_50 = false;
+    }
+}
 
-        for (std::size_t i = 0; i < n; ++i) {
-            running += charges[i];
-            if (!have_20 && running > threshold_20) {
-                charge_20_time = times[i];
-                have_20 = true;
-            }
-            if (!have_50 && running > threshold_50) {
-                charge_50_time = times[i];
-                have_50 = true;
-                if (have_20) break;
+void compute_event_stats(
+    const EventInputs& event,
+    const EventLayout& layout,
+    const std::optional<double>& grouping_window_ns,
+    const StatPlan& plan,
+    const NeighborRule& neighbor_rule,
+    std::size_t max_threads,
+    double* positions_out,
+    double* stats_out,
+    const std::size_t* stat_rows = nullptr) {
+    with_hit_columns(event, [&](const auto& hits) {
+        compute_event_stats(event, hits, layout, grouping_window_ns, plan, neighbor_rule, max_threads,
+                            positions_out, stats_out, stat_rows);
+    });
+}
+
+// Build the PMT level of a multi-PMT event from its module layout, after any
+// hit selection. Neighbors stay a module notion: with an n_string_neighbors
+// column every PMT gets its module's count, the neighbor pass running over the
+// modules here unless it already has (the module layout then points at its
+// counts in module_counts). Runs without the GIL.
+void build_pmt_level(
+    const EventInputs& event,
+    EventLayout& modules,
+    const StatPlan& plan,
+    const NeighborRule& rule,
+    std::size_t max_threads,
+    std::size_t* module_counts,
+    std::size_t* pmt_counts,
+    PmtLayout& out) {
+    switch (event.pmt_ids.type) {
+        case ElementType::Int16: build_pmt_layout(modules, event.pmt_ids.as<int16_t>(), out); break;
+        case ElementType::Int64: build_pmt_layout(modules, event.pmt_ids.as<int64_t>(), out); break;
+        default: build_pmt_layout(modules, event.pmt_ids.as<int32_t>(), out); break;
+    }
+    if (plan.neighbors_column() < 0 || modules.n_sensors == 0) {
+        return;
+    }
+    if (modules.neighbor_counts == nullptr) {
+        ScratchArena& arena = thread_arena();
+        ScratchScope scope(arena);
+        double* positions = nullptr;
+        if (rule.spatial()) {
+            positions = arena.allocate<double>(modules.n_sensors * 3);
+            for (std::size_t m = 0; m < modules.n_sensors; ++m) {
+                write_sensor_position(event, modules, m, positions + m * 3);
             }
         }
+        with_hit_columns(event, [&](const auto& hits) {
+            scan_neighbors(hits, modules, rule, positions, max_threads, module_counts, nullptr);
+        });
+        modules.neighbor_counts = module_counts;
     }
-
-    double weighted_mean = 0.0;
-    double weighted_std = 0.0;
-    if (total_charge > 0.0) {
-        weighted_mean = sum_qt / total_charge;
-        const double variance = (sum_qt2 / total_charge) - (weighted_mean * weighted_mean);
-        weighted_std = variance > 0.0 ? std::sqrt(variance) : 0.0;
+    for (std::size_t m = 0; m < modules.n_sensors; ++m) {
+        std::fill(pmt_counts + out.module_pmts[m], pmt_counts + out.module_pmts[m + 1], modules.neighbor_counts[m]);
     }
+    out.pmts.neighbor_counts = pmt_counts;
+}
 
-    // Skewness from raw moments (extended only)
-    double t_skewness = 0.0;
-    if constexpr (Extended) {
-        if (n >= 3 && weighted_std > 0.0 && total_charge > 0.0) {
-            const double mu = weighted_mean;
-            const double e_x2 = sum_qt2 / total_charge;
-            const double e_x3 = sum_qt3 / total_charge;
-            const double sigma3 = weighted_std * weighted_std * weighted_std;
-            t_skewness = (e_x3 - 3.0 * mu * e_x2 + 2.0 * mu * mu * mu) / sigma3;
-        }
-    }
-
-    if constexpr (Extended) {
-        return std::array<double, kNumStatsExtended>{
-            total_charge, charge_100, charge_500,
-            first_time, last_time,
-            charge_20_time, charge_50_time,
-            weighted_mean, weighted_std,
-            charge_5_time, charge_10_time, charge_25_time,
-            charge_75_time, charge_90_time, charge_95_time,
-            charge_10, charge_20, charge_50,
-            charge_200, charge_1000, charge_2000,
-            static_cast<double>(n),                                    // n_pulses
-            (total_charge > 0.0 ? max_charge / total_charge : 0.0),   // q_max_frac
-            0.0,                                                       // n_string_neighbors
-            t_skewness                                                 // t_skewness
-        };
-    } else {
-        return std::array<double, kNumStats>{
-            total_charge, charge_100, charge_500,
-            first_time, last_time,
-            charge_20_time, charge_50_time,
-            weighted_mean, weighted_std
-        };
+// The per-hit flag array returned with return_hlc_flags, or an empty one.
+UInt8Array hit_flags_array(const HitSelection& selection, std::size_t n_hits) {
+    if (!selection.return_flags) {
+        return UInt8Array();
     }
+    return UInt8Array(py::array::ShapeContainer{static_cast<py::ssize_t>(n_hits)});
+}
+
+// The neighbor rule an entry point applies: `rule` when given, else the
+// default same-string rule (+-2 sensor IDs, +-1000 ns).
+const NeighborRule& resolve_neighbor_rule(const std::shared_ptr<NeighborRule>& rule) {
+    static const NeighborRule default_rule;
+    return rule ? *rule : default_rule;
 }
 
-template<bool Extended>
-auto compute_stats_single_sensor_impl(
-    std::vector<double> times,
-    std::vector<double> charges,
-    const std::optional<double>& grouping_window_ns) {
-    constexpr std::size_t NumStats = Extended ? kNumStatsExtended : kNumStats;
+// Shared body of the single-event entry points; `event` points into arrays
+// the caller keeps alive.
+py::tuple process_event(
+    const EventInputs& event,
+    const std::optional<double>& grouping_window_ns,
+    const std::optional<int>& n_threads,
+    const StatPlan& plan,
+    const NeighborRule& neighbor_rule,
+    const HitSelection& selection,
+    const py::object& out_obj,
+    const py::object& out_positions_obj,
+    bool single_precision) {
+    const std::size_t max_threads = resolve_num_threads(n_threads);
+    const std::size_t num_stats = plan.num_stats();
 
-    if (times.empty()) {
-        return empty_stats<NumStats>();
+    // The layout lives in this thread's scratch arena for the whole call.
+    ScratchArena& arena = thread_arena();
+    ScratchScope scope(arena);
+    const LayoutBuffers buffers(arena, event.n_hits, 1, selection.active());
+    EventLayout layout = buffers.layout(0, 0);
+    const bool per_pmt = !event.pmt_ids.empty();
+    const PmtLayoutBuffers pmt_buffers(arena, per_pmt ? event.n_hits : 0, per_pmt ? 1 : 0);
+    PmtLayout pmt_layout = pmt_buffers.layout(0, 0);
+    UInt8Array flags = hit_flags_array(selection, event.n_hits);
+    {
+        py::gil_scoped_release release;
+        build_event_layout(event, layout, max_threads);
+        if (selection.active()) {
+            select_event_hits(event, layout, neighbor_rule, selection, max_threads,
+                              buffers.neighbor_counts_at(0), selection.return_flags ? flags.mutable_data() : nullptr);
+        }
+        if (per_pmt) {
+            build_pmt_level(event, layout, plan, neighbor_rule, max_threads, pmt_buffers.module_neighbor_counts_at(0),
+                            pmt_buffers.pmt_neighbor_counts_at(0), pmt_layout);
+        }
     }
 
-    if (!is_sorted(times)) {
-        sort_by_time(times, charges);
+    // With the GIL held, pick the output arrays; the kernels write into them directly.
+    const std::size_t n_sensors = layout.n_sensors;
+    const EventTables tables(out_obj, out_positions_obj, n_sensors, num_stats, single_precision, arena);
+    const std::size_t n_pmts = per_pmt ? pmt_layout.pmts.n_sensors : 0;
+    std::optional<EventTables> pmt_tables;
+    Int64Array pmt_offsets;
+    if (per_pmt) {
+        pmt_tables.emplace(py::none(), py::none(), n_pmts, num_stats, single_precision, arena);
+        pmt_offsets = Int64Array(py::array::ShapeContainer{static_cast<py::ssize_t>(n_sensors + 1)});
+        std::copy(pmt_layout.module_pmts, pmt_layout.module_pmts + n_sensors + 1, pmt_offsets.mutable_data());
     }
 
-    if (grouping_window_ns.has_value() && grouping_window_ns.value() > 0.0) {
-        auto grouped = group_hits_by_window(times, charges, grouping_window_ns.value());
-        return compute_stats_from_sorted<Extended>(grouped.first, grouped.second);
+    {
+        py::gil_scoped_release release;
+        compute_event_stats(event, layout, grouping_window_ns, plan, neighbor_rule, max_threads,
+                            tables.positions(), tables.stats());
+        tables.narrow(0, n_sensors);
+        if (per_pmt) {
+            compute_event_stats(event, pmt_layout.pmts, grouping_window_ns, plan, neighbor_rule, max_threads,
+                                pmt_tables->positions(), pmt_tables->stats());
+            pmt_tables->narrow(0, n_pmts);
+        }
     }
 
-    return compute_stats_from_sorted<Extended>(times, charges);
-}
-
-template<std::size_t N>
-py::array_t<double> to_array(const std::array<double, N>& stats) {
-    py::array_t<double> result({static_cast<py::ssize_t>(N)});
-    auto buf = result.mutable_unchecked<1>();
-    for (std::size_t i = 0; i < N; ++i) {
-        buf(i) = stats[i];
+    py::list result;
+    result.append(tables.positions_array());
+    result.append(tables.stats_array());
+    if (per_pmt) {
+        result.append(pmt_tables->positions_array());
+        result.append(pmt_tables->stats_array());
+        result.append(pmt_offsets);
     }
-    return result;
+    if (selection.return_flags) {
+        result.append(flags);
+    }
+    return py::tuple(result);
 }
 
-py::array_t<double> compute_summary_stats_py(
-    py::array_t<double, py::array::c_style | py::array::forcecast> times,
-    py::array_t<double, py::array::c_style | py::array::forcecast> charges,
-    bool extended) {
-    if (times.ndim() != 1 || charges.ndim() != 1) {
-        throw std::invalid_argument("times and charges must be 1D arrays");
+// Validate the CSR event offsets of a batch of n_hits hits and return the
+// number of events.
+std::size_t check_event_offsets(const Int64Array& event_offsets, std::size_t n_hits) {
+    if (event_offsets.ndim() != 1 || event_offsets.shape(0) < 1) {
+        throw std::invalid_argument("event_offsets must be a 1D array of length n_events + 1");
     }
-    if (times.shape(0) != charges.shape(0)) {
-        throw std::invalid_argument("times and charges must have the same length");
+    const auto n_events = static_cast<std::size_t>(event_offsets.shape(0) - 1);
+    const int64_t* offsets_ptr = event_offsets.data();
+    if (offsets_ptr[0] != 0 || offsets_ptr[n_events] != static_cast<int64_t>(n_hits)) {
+        throw std::invalid_argument("event_offsets must start at 0 and end at the number of hits");
+    }
+    for (std::size_t e = 0; e < n_events; ++e) {
+        if (offsets_ptr[e + 1] < offsets_ptr[e]) {
+            throw std::invalid_argument("event_offsets must be non-decreasing");
+        }
     }
+    return n_events;
+}
 
-    std::vector<double> times_vec(times.shape(0));
-    std::vector<double> charges_vec(charges.shape(0));
-    std::memcpy(times_vec.data(), times.data(), times.shape(0) * sizeof(double));
-    std::memcpy(charges_vec.data(), charges.data(), charges.shape(0) * sizeof(double));
+// Shared body of the batch entry points.
+py::tuple process_events_batch(
+    const EventInputs& hits,
+    const Int64Array& event_offsets,
+    const std::optional<double>& grouping_window_ns,
+    const std::optional<int>& n_threads,
+    const StatPlan& plan,
+    const NeighborRule& neighbor_rule,
+    const HitSelection& selection,
+    const py::object& out_obj,
+    const py::object& out_positions_obj,
+    bool single_precision) {
+    const std::size_t n_events = check_event_offsets(event_offsets, hits.n_hits);
+    const int64_t* offsets_ptr = event_offsets.data();
 
-    py::array_t<double> result;
+    const std::size_t max_threads = resolve_num_threads(n_threads);
+    const std::size_t num_stats = plan.num_stats();
+
+    auto event_at = [&](std::size_t e) {
+        return hits.slice(static_cast<std::size_t>(offsets_ptr[e]), static_cast<std::size_t>(offsets_ptr[e + 1]));
+    };
+
+    // Events are independent: spread them over the workers in chunks of
+    // roughly equal hit counts. Large events split their sensors into pool
+    // tasks of their own, which idle workers steal once their events finish.
+    const std::size_t n_workers =
+        std::min(max_threads, std::max<std::size_t>(1, hits.n_hits / kMinHitsPerWorker));
+    const HitBalancedChunks<int64_t> chunks(
+        offsets_ptr, n_events, n_workers == 1 ? 1 : n_workers * kChunksPerWorker);
+
+    // Layouts of all events share one set of scratch buffers, indexed by hit.
+    ScratchArena& arena = thread_arena();
+    ScratchScope scope(arena);
+    const LayoutBuffers buffers(arena, hits.n_hits, n_events, selection.active());
+    EventLayout* layouts = arena.allocate<EventLayout>(n_events);
+    const bool per_pmt = !hits.pmt_ids.empty();
+    const PmtLayoutBuffers pmt_buffers(arena, per_pmt ? hits.n_hits : 0, per_pmt ? n_events : 0);
+    PmtLayout* pmt_layouts = arena.allocate<PmtLayout>(per_pmt ? n_events : 0);
+    UInt8Array flags = hit_flags_array(selection, hits.n_hits);
+    uint8_t* flags_ptr = selection.return_flags ? flags.mutable_data() : nullptr;
     {
-        // Heavy compute section; allow other Python threads to run.
         py::gil_scoped_release release;
-        if (extended) {
-            auto stats = compute_stats_single_sensor_impl<true>(std::move(times_vec), std::move(charges_vec), std::nullopt);
-            py::gil_scoped_acquire acquire;
-            result = to_array(stats);
-        } else {
-            auto stats = compute_stats_single_sensor_impl<false>(std::move(times_vec), std::move(charges_vec), std::nullopt);
-            py::gil_scoped_acquire acquire;
-            result = to_array(stats);
-        }
+        parallel_for(chunks.size(), n_workers, [&](std::size_t chunk) {
+            for (std::size_t e = chunks.begin(chunk); e < chunks.end(chunk); ++e) {
+                const auto first_hit = static_cast<std::size_t>(offsets_ptr[e]);
+                layouts[e] = buffers.layout(first_hit, e);
+                build_event_layout(event_at(e), layouts[e], max_threads);
+                if (selection.active()) {
+                    select_event_hits(event_at(e), layouts[e], neighbor_rule, selection, max_threads,
+                                      buffers.neighbor_counts_at(first_hit),
+                                      flags_ptr == nullptr ? nullptr : flags_ptr + first_hit);
+                }
+                if (per_pmt) {
+                    pmt_layouts[e] = pmt_buffers.layout(first_hit, e);
+                    build_pmt_level(event_at(e), layouts[e], plan, neighbor_rule, max_threads,
+                                    pmt_buffers.module_neighbor_counts_at(first_hit),
+                                    pmt_buffers.pmt_neighbor_counts_at(first_hit), pmt_layouts[e]);
+                }
+            }
+        });
     }
-    return result;
-}
 
-py::array_t<double> process_sensor_data_py(
-    py::array_t<double, py::array::c_style | py::array::forcecast> times,
-    py::object charges_obj,
-    std::optional<double> grouping_window_ns,
-    bool extended) {
-    if (times.ndim() != 1) {
-        throw std::invalid_argument("sensor_times must be a 1D array");
+    Int64Array sensor_offsets(py::array::ShapeContainer{static_cast<py::ssize_t>(n_events + 1)});
+    int64_t* sensor_offsets_ptr = sensor_offsets.mutable_data();
+    sensor_offsets_ptr[0] = 0;
+    for (std::size_t e = 0; e < n_events; ++e) {
+        sensor_offsets_ptr[e + 1] = sensor_offsets_ptr[e] + static_cast<int64_t>(layouts[e].n_sensors);
     }
+    const auto n_sensors = static_cast<std::size_t>(sensor_offsets_ptr[n_events]);
 
-    std::vector<double> times_vec(times.shape(0));
-    std::memcpy(times_vec.data(), times.data(), times.shape(0) * sizeof(double));
+    const EventTables tables(out_obj, out_positions_obj, n_sensors, num_stats, single_precision, arena);
 
-    std::vector<double> charges_vec;
-    if (charges_obj.is_none()) {
-        charges_vec.assign(times_vec.size(), 1.0);
-    } else {
-        py::array_t<double, py::array::c_style | py::array::forcecast> charges = charges_obj.cast<py::array>();
-        if (charges.ndim() != 1 || charges.shape(0) != times.shape(0)) {
-            throw std::invalid_argument("sensor_charges must be 1D and match sensor_times length");
+    // PMT rows of event e start at pmt_rows[e]; pmt_offsets maps every module
+    // row of the batch to its PMT rows.
+    std::size_t* pmt_rows = arena.allocate<std::size_t>(per_pmt ? n_events + 1 : 0);
+    std::optional<EventTables> pmt_tables;
+    Int64Array pmt_offsets;
+    int64_t* pmt_offsets_ptr = nullptr;
+    if (per_pmt) {
+        pmt_rows[0] = 0;
+        for (std::size_t e = 0; e < n_events; ++e) {
+            pmt_rows[e + 1] = pmt_rows[e] + pmt_layouts[e].pmts.n_sensors;
         }
-        charges_vec.resize(charges.shape(0));
-        std::memcpy(charges_vec.data(), charges.data(), charges.shape(0) * sizeof(double));
+        pmt_tables.emplace(py::none(), py::none(), pmt_rows[n_events], num_stats, single_precision, arena);
+        pmt_offsets = Int64Array(py::array::ShapeContainer{static_cast<py::ssize_t>(n_sensors + 1)});
+        pmt_offsets_ptr = pmt_offsets.mutable_data();
+        pmt_offsets_ptr[n_sensors] = static_cast<int64_t>(pmt_rows[n_events]);
     }
 
-    const auto pre_grouping_n = static_cast<double>(times_vec.size());
-
-    py::array_t<double> result;
     {
         py::gil_scoped_release release;
-        if (extended) {
-            auto stats = compute_stats_single_sensor_impl<true>(std::move(times_vec), std::move(charges_vec), grouping_window_ns);
-            py::gil_scoped_acquire acquire;
-            result = to_array(stats);
-        } else {
-            auto stats = compute_stats_single_sensor_impl<false>(std::move(times_vec), std::move(charges_vec), grouping_window_ns);
-            py::gil_scoped_acquire acquire;
-            result = to_array(stats);
-        }
+        parallel_for(chunks.size(), n_workers, [&](std::size_t chunk) {
+            for (std::size_t e = chunks.begin(chunk); e < chunks.end(chunk); ++e) {
+                const auto row = static_cast<std::size_t>(sensor_offsets_ptr[e]);
+                compute_event_stats(event_at(e), layouts[e], grouping_window_ns, plan, neighbor_rule, max_threads,
+                                    tables.positions() + row * 3, tables.stats() + row * num_stats);
+                tables.narrow(row, static_cast<std::size_t>(sensor_offsets_ptr[e + 1]));
+                if (!per_pmt) {
+                    continue;
+                }
+                const std::size_t pmt_row = pmt_rows[e];
+                compute_event_stats(event_at(e), pmt_layouts[e].pmts, grouping_window_ns, plan, neighbor_rule,
+                                    max_threads, pmt_tables->positions() + pmt_row * 3,
+                                    pmt_tables->stats() + pmt_row * num_stats);
+                pmt_tables->narrow(pmt_row, pmt_rows[e + 1]);
+                for (std::size_t m = 0; m < layouts[e].n_sensors; ++m) {
+                    pmt_offsets_ptr[row + m] = static_cast<int64_t>(pmt_row + pmt_layouts[e].module_pmts[m]);
+                }
+            }
+        });
     }
 
-    // Override n_pulses with pre-grouping count when grouping is applied
-    if (extended && grouping_window_ns.has_value() && grouping_window_ns.value() > 0.0) {
-        auto buf = result.mutable_unchecked<1>();
-        buf(21) = pre_grouping_n;
+    py::list result;
+    result.append(tables.positions_array());
+    result.append(tables.stats_array());
+    result.append(sensor_offsets);
+    if (per_pmt) {
+        result.append(pmt_tables->positions_array());
+        result.append(pmt_tables->stats_array());
+        result.append(pmt_offsets);
     }
-
-    return result;
+    if (selection.return_flags) {
+        result.append(flags);
+    }
+    return py::tuple(result);
 }
 
-py::tuple process_event_arrays_py(
-    py::array_t<int32_t, py::array::c_style | py::array::forcecast> string_ids,
-    py::array_t<int32_t, py::array::c_style | py::array::forcecast> sensor_ids,
-    py::array_t<double, py::array::c_style | py::array::forcecast> times,
-    py::array_t<double, py::array::c_style | py::array::forcecast> pos_x,
-    py::array_t<double, py::array::c_style | py::array::forcecast> pos_y,
-    py::array_t<double, py::array::c_style | py::array::forcecast> pos_z,
-    py::object charges_obj,
-    std::optional<double> grouping_window_ns,
-    std::optional<int> /*n_threads*/,
-    bool extended) {
-    if (string_ids.ndim() != 1 || sensor_ids.ndim() != 1 || times.ndim() != 1 ||
-        pos_x.ndim() != 1 || pos_y.ndim() != 1 || pos_z.ndim() != 1) {
-        throw std::invalid_argument("All event arrays must be 1D");
+// A dense detector tensor: one cell of num_stats statistics per slot of the
+// geometry's (string_id, sensor_id) grid, shape (n_string_slots,
+// n_sensor_slots, num_stats), with a leading n_events axis for a batch. Each
+// event's cells are filled with fill_value and its hit sensors then write
+// their cells in place. A float32 tensor is filled in float32 and only the rows
+// of the hit sensors pass through a double scratch slab, as EventTables does.
+class DetectorTensor {
+public:
+    DetectorTensor(const py::object& out_obj, const Geometry& geometry, std::size_t n_events, bool batch,
+                   std::size_t num_stats, bool single_precision)
+        : cells_per_event_(geometry.n_string_slots() * geometry.n_sensor_slots() * num_stats),
+          num_stats_(num_stats),
+          single_precision_(single_precision) {
+        py::array::ShapeContainer shape;
+        if (batch) {
+            shape.push_back(static_cast<py::ssize_t>(n_events));
+        }
+        shape.push_back(static_cast<py::ssize_t>(geometry.n_string_slots()));
+        shape.push_back(static_cast<py::ssize_t>(geometry.n_sensor_slots()));
+        shape.push_back(static_cast<py::ssize_t>(num_stats));
+        if (out_obj.is_none()) {
+            array_ = single_precision ? py::array(py::array_t<float>(shape)) : py::array(py::array_t<double>(shape));
+        } else {
+            array_ = out_obj.cast<py::array>();
+            check(shape);
+        }
+        data_ = array_.mutable_data();
     }
 
-    const std::size_t n_hits = times.shape(0);
-    const auto n_hits_ssize = static_cast<py::ssize_t>(n_hits);
-    if (string_ids.shape(0) != n_hits_ssize || sensor_ids.shape(0) != n_hits_ssize ||
-        pos_x.shape(0) != n_hits_ssize || pos_y.shape(0) != n_hits_ssize || pos_z.shape(0) != n_hits_ssize) {
-        throw std::invalid_argument("All event arrays must have identical lengths");
+    // Fill the cells of event e, then let write(stats, rows) store the
+    // statistics of its n_rows hit sensors in double precision, sensor s at
+    // stats + rows[s] * num_stats (at stats + s * num_stats when rows is null).
+    // Sensor s belongs in cell cells[s].
+    template<typename Write>
+    void write_event(std::size_t e, double fill_value, std::size_t n_rows, const std::size_t* cells,
+                     Write&& write) const {
+        if (!single_precision_) {
+            double* event_cells = static_cast<double*>(data_) + e * cells_per_event_;
+            std::fill(event_cells, event_cells + cells_per_event_, fill_value);
+            write(event_cells, cells);
+            return;
+        }
+        float* event_cells = static_cast<float*>(data_) + e * cells_per_event_;
+        std::fill(event_cells, event_cells + cells_per_event_, static_cast<float>(fill_value));
+        ScratchArena& arena = thread_arena();
+        ScratchScope scope(arena);
+        double* rows = arena.allocate<double>(n_rows * num_stats_);
+        write(rows, static_cast<const std::size_t*>(nullptr));
+        for (std::size_t s = 0; s < n_rows; ++s) {
+            std::copy(rows + s * num_stats_, rows + (s + 1) * num_stats_, event_cells + cells[s] * num_stats_);
+        }
     }
 
-    // Snapshot input pointers before releasing the GIL.
-    auto* string_ptr = string_ids.data();
-    auto* sensor_ptr = sensor_ids.data();
-    auto* times_ptr = times.data();
-    auto* pos_x_ptr = pos_x.data();
-    auto* pos_y_ptr = pos_y.data();
-    auto* pos_z_ptr = pos_z.data();
-
-    std::vector<double> charges_vec;
-    if (charges_obj.is_none()) {
-        charges_vec.assign(n_hits, 1.0);
-    } else {
-        py::array_t<double, py::array::c_style | py::array::forcecast> charges = charges_obj.cast<py::array>();
-        if (charges.ndim() != 1 || charges.shape(0) != n_hits_ssize) {
-            throw std::invalid_argument("charges must be 1D and match times length");
+    const py::array& array() const { return array_; }
+
+private:
+    void check(const py::array::ShapeContainer& shape) const {
+        const bool dtype_ok = single_precision_ ? array_.dtype().is(py::dtype::of<float>())
+                                                : array_.dtype().is(py::dtype::of<double>());
+        if (!dtype_ok) {
+            throw std::invalid_argument(std::string("out must have dtype ") +
+                                        (single_precision_ ? dtype_name<float>() : dtype_name<double>()));
+        }
+        if (!(array_.flags() & py::array::c_style) || !array_.writeable()) {
+            throw std::invalid_argument("out must be a writeable C-contiguous array");
+        }
+        bool shape_ok = array_.ndim() == static_cast<py::ssize_t>(shape.size());
+        std::string expected = "(";
+        for (std::size_t d = 0; d < shape.size(); ++d) {
+            shape_ok = shape_ok && array_.shape(static_cast<py::ssize_t>(d)) == shape[d];
+            expected += std::to_string(shape[d]) + (d + 1 < shape.size() ? ", " : ")");
+        }
+        if (!shape_ok) {
+            throw std::invalid_argument("out must have shape " + expected);
         }
-        charges_vec.resize(n_hits);
-        std::memcpy(charges_vec.data(), charges.data(), n_hits * sizeof(double));
     }
 
-    // Data structures computed without holding the GIL
-    const std::size_t num_stats = extended ? kNumStatsExtended : kNumStats;
-    std::vector<std::size_t> order(n_hits);
-    std::vector<std::size_t> sensor_offsets;
-    std::vector<std::array<double, 3>> sensor_positions_local;
+    std::size_t cells_per_event_;
+    std::size_t num_stats_;
+    bool single_precision_;
+    py::array array_;
+    void* data_ = nullptr;
+};
+
+// Shared body of the dense-tensor entry points: the events delimited by
+// offsets_ptr (n_events + 1 entries) are laid out and selected as in
+// process_events_batch, and each writes its statistics straight into its
+// cells of the detector tensor. `batch` adds the leading event axis.
+py::array process_events_dense(
+    const EventInputs& hits,
+    const int64_t* offsets_ptr,
+    std::size_t n_events,
+    bool batch,
+    const std::optional<double>& grouping_window_ns,
+    const std::optional<int>& n_threads,
+    const StatPlan& plan,
+    const NeighborRule& neighbor_rule,
+    const HitSelection& selection,
+    const py::object& out_obj,
+    double fill_value,
+    bool single_precision) {
+    const Geometry& geometry = *hits.geometry;
+    const std::size_t max_threads = resolve_num_threads(n_threads);
+    const DetectorTensor tensor(out_obj, geometry, n_events, batch, plan.num_stats(), single_precision);
 
-    std::vector<double> sensor_stats_flat; // flattened stats array
+    auto event_at = [&](std::size_t e) {
+        return hits.slice(static_cast<std::size_t>(offsets_ptr[e]), static_cast<std::size_t>(offsets_ptr[e + 1]));
+    };
+    const std::size_t n_workers =
+        std::min(max_threads, std::max<std::size_t>(1, hits.n_hits / kMinHitsPerWorker));
+    const HitBalancedChunks<int64_t> chunks(
+        offsets_ptr, n_events, n_workers == 1 ? 1 : n_workers * kChunksPerWorker);
 
+    ScratchArena& arena = thread_arena();
+    ScratchScope scope(arena);
+    const LayoutBuffers buffers(arena, hits.n_hits, n_events, selection.active());
     {
         py::gil_scoped_release release;
+        parallel_for(chunks.size(), n_workers, [&](std::size_t chunk) {
+            for (std::size_t e = chunks.begin(chunk); e < chunks.end(chunk); ++e) {
+                const auto first_hit = static_cast<std::size_t>(offsets_ptr[e]);
+                const EventInputs event = event_at(e);
+                EventLayout layout = buffers.layout(first_hit, e);
+                build_event_layout(event, layout, max_threads);
+                if (selection.active()) {
+                    select_event_hits(event, layout, neighbor_rule, selection, max_threads,
+                                      buffers.neighbor_counts_at(first_hit), nullptr);
+                }
 
-        std::iota(order.begin(), order.end(), 0);
-        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
-            if (string_ptr[a] != string_ptr[b]) {
-                return string_ptr[a] < string_ptr[b];
-            }
-            if (sensor_ptr[a] != sensor_ptr[b]) {
-                return sensor_ptr[a] < sensor_ptr[b];
+                // Each hit sensor's cell, and scratch for the positions the
+                // neighbor pass reads.
+                ScratchArena& event_arena = thread_arena();
+                ScratchScope event_scope(event_arena);
+                std::size_t* cells = event_arena.allocate<std::size_t>(layout.n_sensors);
+                double* positions = event_arena.allocate<double>(layout.n_sensors * 3);
+                for (std::size_t s = 0; s < layout.n_sensors; ++s) {
+                    cells[s] = geometry.grid_slot(layout.sensor_string_ids[s], layout.sensor_sensor_ids[s]);
+                }
+                tensor.write_event(e, fill_value, layout.n_sensors, cells,
+                                   [&](double* stats, const std::size_t* stat_rows) {
+                    compute_event_stats(event, layout, grouping_window_ns, plan, neighbor_rule, max_threads,
+                                        positions, stats, stat_rows);
+                });
             }
-            return times_ptr[a] < times_ptr[b];
         });
+    }
+    return tensor.array();
+}
 
-        if (n_hits == 0) {
-            // Nothing to do, will return empty arrays below with GIL held
-        } else {
-            sensor_offsets.reserve(n_hits + 1);
-            sensor_positions_local.reserve(n_hits);
-
-            std::vector<int32_t> sensor_string_ids;
-            std::vector<int32_t> sensor_sensor_ids;
-
-            sensor_offsets.push_back(0);
-            for (std::size_t i = 0; i < n_hits; ++i) {
-                const auto idx = order[i];
-                if (i == 0 || string_ptr[idx] != string_ptr[order[i - 1]] || sensor_ptr[idx] != sensor_ptr[order[i - 1]]) {
-                    if (i != 0) sensor_offsets.push_back(i);
-                    sensor_positions_local.push_back({pos_x_ptr[idx], pos_y_ptr[idx], pos_z_ptr[idx]});
-                    sensor_string_ids.push_back(string_ptr[idx]);
-                    sensor_sensor_ids.push_back(sensor_ptr[idx]);
-                }
-            }
-            sensor_offsets.push_back(n_hits);
+py::tuple process_event_arrays_py(
+    py::array string_ids,
+    py::array sensor_ids,
+    py::array times,
+    py::array pos_x,
+    py::array pos_y,
+    py::array pos_z,
+    py::object charges_obj,
+    std::optional<double> grouping_window_ns,
+    std::optional<int> n_threads,
+    bool extended,
+    py::object out_obj,
+    py::object out_positions_obj,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj,
+    std::shared_ptr<NeighborRule> neighbor_rule_ptr,
+    bool return_hlc_flags,
+    bool hlc_only,
+    std::shared_ptr<HitCleaning> cleaning_ptr,
+    py::object pmt_ids_obj) {
+    // Snapshot input pointers before releasing the GIL.
+    EventArrays arrays(string_ids, sensor_ids, times, charges_obj);
+    arrays.set_positions(pos_x, pos_y, pos_z);
+    arrays.set_pmt_ids(pmt_ids_obj);
 
-            const std::size_t n_sensors = sensor_positions_local.size();
-            sensor_stats_flat.reserve(n_sensors * num_stats);
+    return process_event(arrays.event, grouping_window_ns, n_threads, resolve_plan(plan_ptr, extended),
+                         resolve_neighbor_rule(neighbor_rule_ptr), HitSelection{return_hlc_flags, hlc_only, cleaning_ptr.get()},
+                         out_obj, out_positions_obj, single_precision_output(dtype_obj));
+}
 
-            for (std::size_t s = 0; s < n_sensors; ++s) {
-                const std::size_t start = sensor_offsets[s];
-                const std::size_t end = sensor_offsets[s + 1];
-                std::vector<double> times_slice;
-                std::vector<double> charges_slice;
-                times_slice.reserve(end - start);
-                charges_slice.reserve(end - start);
-                for (std::size_t i = start; i < end; ++i) {
-                    const auto idx = order[i];
-                    times_slice.push_back(times_ptr[idx]);
-                    charges_slice.push_back(charges_vec[idx]);
-                }
+py::tuple process_event_geometry_py(
+    const Geometry& geometry,
+    py::array string_ids,
+    py::array sensor_ids,
+    py::array times,
+    py::object charges_obj,
+    std::optional<double> grouping_window_ns,
+    std::optional<int> n_threads,
+    bool extended,
+    py::object out_obj,
+    py::object out_positions_obj,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj,
+    std::shared_ptr<NeighborRule> neighbor_rule_ptr,
+    bool return_hlc_flags,
+    bool hlc_only,
+    std::shared_ptr<HitCleaning> cleaning_ptr,
+    py::object pmt_ids_obj) {
+    EventArrays arrays(string_ids, sensor_ids, times, charges_obj);
+    arrays.event.geometry = &geometry;
+    arrays.set_pmt_ids(pmt_ids_obj);
 
-                if (extended) {
-                    auto stats = compute_stats_single_sensor_impl<true>(
-                        std::move(times_slice),
-                        std::move(charges_slice),
-                        grouping_window_ns
-                    );
-                    sensor_stats_flat.insert(sensor_stats_flat.end(), stats.begin(), stats.end());
-                } else {
-                    auto stats = compute_stats_single_sensor_impl<false>(
-                        std::move(times_slice),
-                        std::move(charges_slice),
-                        grouping_window_ns
-                    );
-                    sensor_stats_flat.insert(sensor_stats_flat.end(), stats.begin(), stats.end());
-                }
-            }
+    return process_event(arrays.event, grouping_window_ns, n_threads, resolve_plan(plan_ptr, extended),
+                         resolve_neighbor_rule(neighbor_rule_ptr), HitSelection{return_hlc_flags, hlc_only, cleaning_ptr.get()},
+                         out_obj, out_positions_obj, single_precision_output(dtype_obj));
+}
 
-            // Extended-only post-processing: n_string_neighbors and n_pulses override
-            if (extended) {
-                // HLC-style neighbor count: same string, +-2 sensor_id, +-1000ns coincidence
-                for (std::size_t s = 0; s < n_sensors; ++s) {
-                    int count = 0;
-                    const int32_t my_str = sensor_string_ids[s];
-                    const int32_t my_sid = sensor_sensor_ids[s];
-                    const std::size_t scan_start = (s >= 4) ? s - 4 : 0;
-                    const std::size_t scan_end = std::min(n_sensors, s + 5);
-                    for (std::size_t other = scan_start; other < scan_end; ++other) {
-                        if (other == s) continue;
-                        if (sensor_string_ids[other] != my_str) continue;
-                        const int32_t sid_diff = std::abs(sensor_sensor_ids[other] - my_sid);
-                        if (sid_diff < 1 || sid_diff > 2) continue;
-                        // Merge-scan for +-1000ns coincidence on pre-grouping times
-                        // times_ptr[order[i]] gives original times, time-sorted within each sensor
-                        std::size_t ai = sensor_offsets[s], bi = sensor_offsets[other];
-                        const std::size_t a_end = sensor_offsets[s + 1];
-                        const std::size_t b_end = sensor_offsets[other + 1];
-                        bool coincident = false;
-                        while (ai < a_end && bi < b_end) {
-                            const double ta = times_ptr[order[ai]];
-                            const double tb = times_ptr[order[bi]];
-                            if (std::abs(ta - tb) <= 1000.0) { coincident = true; break; }
-                            if (ta < tb) ++ai; else ++bi;
-                        }
-                        if (coincident) ++count;
-                    }
-                    sensor_stats_flat[s * num_stats + 23] = static_cast<double>(count);
-                }
+py::tuple process_events_batch_py(
+    py::array string_ids,
+    py::array sensor_ids,
+    py::array times,
+    py::array pos_x,
+    py::array pos_y,
+    py::array pos_z,
+    Int64Array event_offsets,
+    py::object charges_obj,
+    std::optional<double> grouping_window_ns,
+    std::optional<int> n_threads,
+    bool extended,
+    py::object out_obj,
+    py::object out_positions_obj,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj,
+    std::shared_ptr<NeighborRule> neighbor_rule_ptr,
+    bool return_hlc_flags,
+    bool hlc_only,
+    std::shared_ptr<HitCleaning> cleaning_ptr,
+    py::object pmt_ids_obj) {
+    EventArrays arrays(string_ids, sensor_ids, times, charges_obj);
+    arrays.set_positions(pos_x, pos_y, pos_z);
+    arrays.set_pmt_ids(pmt_ids_obj);
 
-                // Override n_pulses with pre-grouping count when grouping is applied
-                if (grouping_window_ns.has_value() && grouping_window_ns.value() > 0.0) {
-                    for (std::size_t s = 0; s < n_sensors; ++s) {
-                        sensor_stats_flat[s * num_stats + 21] =
-                            static_cast<double>(sensor_offsets[s + 1] - sensor_offsets[s]);
-                    }
-                }
-            }
-        }
-    }
+    return process_events_batch(arrays.event, event_offsets, grouping_window_ns, n_threads,
+                                resolve_plan(plan_ptr, extended), resolve_neighbor_rule(neighbor_rule_ptr),
+                                HitSelection{return_hlc_flags, hlc_only, cleaning_ptr.get()}, out_obj, out_positions_obj,
+                                single_precision_output(dtype_obj));
+}
 
-    // With the GIL held, materialise the Python arrays for output
-    if (n_hits == 0) {
-        py::array_t<double> empty_positions(py::array::ShapeContainer{py::ssize_t(0), py::ssize_t(3)});
-        py::array_t<double> empty_stats(py::array::ShapeContainer{py::ssize_t(0), static_cast<py::ssize_t>(num_stats)});
-        return py::make_tuple(empty_positions, empty_stats);
-    }
+py::tuple process_events_batch_geometry_py(
+    const Geometry& geometry,
+    py::array string_ids,
+    py::array sensor_ids,
+    py::array times,
+    Int64Array event_offsets,
+    py::object charges_obj,
+    std::optional<double> grouping_window_ns,
+    std::optional<int> n_threads,
+    bool extended,
+    py::object out_obj,
+    py::object out_positions_obj,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj,
+    std::shared_ptr<NeighborRule> neighbor_rule_ptr,
+    bool return_hlc_flags,
+    bool hlc_only,
+    std::shared_ptr<HitCleaning> cleaning_ptr,
+    py::object pmt_ids_obj) {
+    EventArrays arrays(string_ids, sensor_ids, times, charges_obj);
+    arrays.event.geometry = &geometry;
+    arrays.set_pmt_ids(pmt_ids_obj);
 
-    const std::size_t n_sensors = sensor_positions_local.size();
+    return process_events_batch(arrays.event, event_offsets, grouping_window_ns, n_threads,
+                                resolve_plan(plan_ptr, extended), resolve_neighbor_rule(neighbor_rule_ptr),
+                                HitSelection{return_hlc_flags, hlc_only, cleaning_ptr.get()}, out_obj, out_positions_obj,
+                                single_precision_output(dtype_obj));
+}
 
-    py::array_t<double> positions(py::array::ShapeContainer{
-        static_cast<py::ssize_t>(n_sensors),
-        py::ssize_t(3)});
-    py::array_t<double> stats(py::array::ShapeContainer{
-        static_cast<py::ssize_t>(n_sensors),
-        static_cast<py::ssize_t>(num_stats)});
+py::array process_event_dense_py(
+    const Geometry& geometry,
+    py::array string_ids,
+    py::array sensor_ids,
+    py::array times,
+    py::object charges_obj,
+    py::object out_obj,
+    double fill_value,
+    std::optional<double> grouping_window_ns,
+    std::optional<int> n_threads,
+    bool extended,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj,
+    std::shared_ptr<NeighborRule> neighbor_rule_ptr,
+    bool hlc_only,
+    std::shared_ptr<HitCleaning> cleaning_ptr) {
+    EventArrays arrays(string_ids, sensor_ids, times, charges_obj);
+    arrays.event.geometry = &geometry;
+    const int64_t offsets[2] = {0, static_cast<int64_t>(arrays.event.n_hits)};
 
-    auto positions_buf = positions.mutable_unchecked<2>();
-    for (std::size_t i = 0; i < n_sensors; ++i) {
-        positions_buf(i, 0) = sensor_positions_local[i][0];
-        positions_buf(i, 1) = sensor_positions_local[i][1];
-        positions_buf(i, 2) = sensor_positions_local[i][2];
-    }
+    return process_events_dense(arrays.event, offsets, 1, false, grouping_window_ns, n_threads,
+                                resolve_plan(plan_ptr, extended), resolve_neighbor_rule(neighbor_rule_ptr),
+                                HitSelection{false, hlc_only, cleaning_ptr.get()}, out_obj, fill_value,
+                                single_precision_output(dtype_obj));
+}
 
-    auto stats_buf = stats.mutable_unchecked<2>();
-    for (std::size_t i = 0; i < n_sensors; ++i) {
-        for (std::size_t j = 0; j < num_stats; ++j) {
-            stats_buf(i, j) = sensor_stats_flat[i * num_stats + j];
-        }
+py::array process_events_batch_dense_py(
+    const Geometry& geometry,
+    py::array string_ids,
+    py::array sensor_ids,
+    py::array times,
+    Int64Array event_offsets,
+    py::object charges_obj,
+    py::object out_obj,
+    double fill_value,
+    std::optional<double> grouping_window_ns,
+    std::optional<int> n_threads,
+    bool extended,
+    std::shared_ptr<StatPlan> plan_ptr,
+    py::object dtype_obj,
+    std::shared_ptr<NeighborRule> neighbor_rule_ptr,
+    bool hlc_only,
+    std::shared_ptr<HitCleaning> cleaning_ptr) {
+    EventArrays arrays(string_ids, sensor_ids, times, charges_obj);
+    arrays.event.geometry = &geometry;
+    const std::size_t n_events = check_event_offsets(event_offsets, arrays.event.n_hits);
+
+    return process_events_dense(arrays.event, event_offsets.data(), n_events, true, grouping_window_ns, n_threads,
+                                resolve_plan(plan_ptr, extended), resolve_neighbor_rule(neighbor_rule_ptr),
+                                HitSelection{false, hlc_only, cleaning_ptr.get()}, out_obj, fill_value,
+                                single_precision_output(dtype_obj));
+}
+
+std::shared_ptr<Geometry> make_geometry(
+    const py::array& string_id_column,
+    const py::array& sensor_id_column,
+    DoubleArray x,
+    DoubleArray y,
+    DoubleArray z) {
+    const Int32Array string_ids = int32_id_column(string_id_column);
+    const Int32Array sensor_ids = int32_id_column(sensor_id_column);
+    if (string_ids.ndim() != 1 || sensor_ids.ndim() != 1 || x.ndim() != 1 || y.ndim() != 1 || z.ndim() != 1) {
+        throw std::invalid_argument("All geometry arrays must be 1D");
     }
+    const auto n = string_ids.shape(0);
+    if (sensor_ids.shape(0) != n || x.shape(0) != n || y.shape(0) != n || z.shape(0) != n) {
+        throw std::invalid_argument("All geometry arrays must have identical lengths");
+    }
+    return std::make_shared<Geometry>(string_ids.data(), sensor_ids.data(), x.data(), y.data(), z.data(),
+                                      static_cast<std::size_t>(n));
+}
 
-    return py::make_tuple(positions, stats);
+// Geometry rows of the given sensors, -1 for sensors that are not part of it
+// (including IDs outside the int32 range).
+Int32Array geometry_index_py(const Geometry& geometry, Int64Array string_ids, Int64Array sensor_ids) {
+    if (string_ids.ndim() != 1 || sensor_ids.ndim() != 1 || string_ids.shape(0) != sensor_ids.shape(0)) {
+        throw std::invalid_argument("string_ids and sensor_ids must be 1D arrays of the same length");
+    }
+    const auto n = static_cast<std::size_t>(string_ids.shape(0));
+    Int32Array result(py::array::ShapeContainer{static_cast<py::ssize_t>(n)});
+    int32_t* out = result.mutable_data();
+    const auto fits = [](int64_t id) {
+        return id >= std::numeric_limits<int32_t>::min() && id <= std::numeric_limits<int32_t>::max();
+    };
+    for (std::size_t i = 0; i < n; ++i) {
+        const int64_t string_id = string_ids.data()[i];
+        const int64_t sensor_id = sensor_ids.data()[i];
+        out[i] = fits(string_id) && fits(sensor_id)
+                     ? geometry.index(static_cast<int32_t>(string_id), static_cast<int32_t>(sensor_id))
+                     : -1;
+    }
+    return result;
 }
 
 }  // namespace
@@ -597,12 +4558,152 @@ py::tuple process_event_arrays_py(
 PYBIND11_MODULE(_native, m) {
     m.doc() = "C++ backend for nt_summary_stats";
 
+    // Pick the first-pass kernels for this CPU once, at import.
+    first_pass_kernels();
+
+    m.def("simd_isa",
+          &simd_isa,
+          "Return the instruction set of the selected first-pass kernels\n"
+          "('avx512', 'avx2', 'sse2', 'neon' or 'scalar'). Results are identical for all of them.");
+
+    m.def("set_num_threads",
+          &set_num_threads,
+          py::arg("n_threads"),
+          "Set the number of threads (calling thread included) used by the worker pool.");
+
+    m.def("get_num_threads",
+          &get_num_threads,
+          "Return the number of threads used by the worker pool.");
+
+    m.def("scratch_allocations",
+          &scratch_allocations,
+          "Return the number of heap blocks obtained so far by the per-thread scratch\n"
+          "arenas. It stops growing once calls of a similar size repeat.");
+
+    py::class_<StatPlan, std::shared_ptr<StatPlan>>(
+        m, "StatPlan",
+        "Compiled list of the statistic columns computed for every sensor.")
+        .def(py::init<const std::vector<double>&, const std::vector<double>&, bool, bool, bool, bool, bool>(),
+             py::arg("windows"),
+             py::arg("quantiles"),
+             py::arg("moments") = true,
+             py::arg("n_pulses") = false,
+             py::arg("q_max_frac") = false,
+             py::arg("neighbors") = false,
+             py::arg("skewness") = false)
+        .def_static("standard", []() { return std::make_shared<StatPlan>(StatPlan::standard()); },
+                    "The default 9-column plan.")
+        .def_static("extended", []() { return std::make_shared<StatPlan>(StatPlan::extended()); },
+                    "The default 25-column plan (extended=True).")
+        .def_static("select",
+                    [](const std::vector<std::string>& names) { return std::make_shared<StatPlan>(StatPlan::select(names)); },
+                    py::arg("names"),
+                    "A plan computing only the named columns, in the given order. Names are\n"
+                    "those listed by `names`: the fixed column names, charge_<w>ns and\n"
+                    "charge_<p>_percent_time.")
+        .def_property_readonly("n_stats", &StatPlan::num_stats)
+        .def_property_readonly("names", &StatPlan::names);
+
+    py::class_<NeighborRule, std::shared_ptr<NeighborRule>>(
+        m, "NeighborRule",
+        "Which sensors are neighbors for n_string_neighbors, and when they coincide.")
+        .def(py::init<double, int32_t, std::optional<double>, int64_t>(),
+             py::arg("window_ns") = 1000.0,
+             py::arg("max_id_distance") = 2,
+             py::arg("radius") = py::none(),
+             py::arg("multiplicity") = 1)
+        .def_readonly("window_ns", &NeighborRule::window_ns)
+        .def_readonly("max_id_distance", &NeighborRule::max_id_distance)
+        .def_property_readonly("radius", [](const NeighborRule& rule) {
+            return rule.spatial() ? std::optional<double>(rule.radius) : std::nullopt;
+        })
+        .def_readonly("multiplicity", &NeighborRule::multiplicity);
+
+    py::class_<HitCleaning, std::shared_ptr<HitCleaning>>(
+        m, "HitCleaning",
+        "Noise cleaning applied to an event's hits ahead of the statistics.")
+        .def(py::init<std::optional<double>, std::optional<double>, double, std::optional<int64_t>>(),
+             py::arg("time_window_ns") = py::none(),
+             py::arg("srt_radius") = py::none(),
+             py::arg("srt_time_ns") = 1000.0,
+             py::arg("srt_iterations") = py::none())
+        .def_property_readonly("time_window_ns", [](const HitCleaning& cleaning) {
+            return cleaning.time_window() ? std::optional<double>(cleaning.time_window_ns) : std::nullopt;
+        })
+        .def_property_readonly("srt_radius", [](const HitCleaning& cleaning) {
+            return cleaning.seeded_rt() ? std::optional<double>(cleaning.srt_radius) : std::nullopt;
+        })
+        .def_readonly("srt_time_ns", &HitCleaning::srt_time_ns)
+        .def_property_readonly("srt_iterations", [](const HitCleaning& cleaning) {
+            return cleaning.srt_iterations > 0 ? std::optional<std::size_t>(cleaning.srt_iterations)
+                                               : std::nullopt;
+        });
+
+    py::class_<SensorAccumulator, std::shared_ptr<SensorAccumulator>>(
+        m, "SensorAccumulator",
+        "Summary statistics of one sensor, updated as hits arrive in time order.")
+        .def(py::init(&make_sensor_accumulator),
+             py::arg("extended") = false,
+             py::arg("plan") = py::none())
+        .def("add",
+             &sensor_accumulator_add_py,
+             py::arg("times"),
+             py::arg("charges") = py::none(),
+             "Append hits (charges default to 1.0). Their times must be ascending and\n"
+             "not precede the last hit added. float32 / float64 / int64 times and\n"
+             "float32 / float64 charges are read in place.")
+        .def("stats",
+             &sensor_accumulator_stats_py,
+             py::arg("out") = py::none(),
+             py::arg("dtype") = py::none(),
+             "Statistics of all hits added so far, identical to compute_summary_stats\n"
+             "over them. `out` may be a preallocated array of shape (n_stats,) and dtype\n"
+             "`dtype` (float64, or float32).")
+        .def("reset", &SensorAccumulator::reset, "Drop all hits added so far.")
+        .def_property_readonly("n_hits", &SensorAccumulator::num_hits)
+        .def_property_readonly("n_stats", [](const SensorAccumulator& a) { return a.plan().num_stats(); })
+        .def_property_readonly("names", [](const SensorAccumulator& a) { return a.plan().names(); });
+
+    py::class_<PartialStats, std::shared_ptr<PartialStats>>(
+        m, "PartialStats",
+        "Mergeable state of part of one sensor's hits.")
+        .def(py::init(&make_partial_stats),
+             py::arg("times"),
+             py::arg("charges") = py::none())
+        .def("merge",
+             [](const PartialStats& a, const PartialStats& b) {
+                 py::gil_scoped_release release;
+                 return std::make_shared<PartialStats>(a.merge(b));
+             },
+             py::arg("other"),
+             "The state of this part's hits followed by `other`'s. Associative; merging\n"
+             "the parts of a split hit array in order gives the state of the whole array.")
+        .def("stats",
+             &partial_stats_stats_py,
+             py::arg("extended") = false,
+             py::arg("out") = py::none(),
+             py::arg("plan") = py::none(),
+             py::arg("dtype") = py::none(),
+             "Statistics of the hits of this state, as compute_summary_stats computes them.")
+        .def_property_readonly("n_hits", &PartialStats::num_hits)
+        .def_property_readonly("times", [](const PartialStats& p) { return vector_to_array(p.times()); })
+        .def_property_readonly("charges", [](const PartialStats& p) { return vector_to_array(p.charges()); })
+        .def_property_readonly("unit_charges", &PartialStats::unit_charges);
+
     m.def("compute_summary_stats",
           &compute_summary_stats_py,
           py::arg("times"),
           py::arg("charges"),
           py::arg("extended") = false,
-          "Compute summary statistics for a single sensor.");
+          py::arg("out") = py::none(),
+          py::arg("plan") = py::none(),
+          py::arg("dtype") = py::none(),
+          "Compute summary statistics for a single sensor.\n\n"
+          "Times are read in place as float32, float64 or int64, charges as float32 or\n"
+          "float64. `dtype` (float64 default, or float32) selects the output dtype; the\n"
+          "statistics are accumulated in double either way. If `out` is given (of that\n"
+          "dtype, shape (n_stats,)) the statistics are written into it. A StatPlan `plan`\n"
+          "selects the columns; otherwise `extended` picks the 9 or 25 defaults.");
 
     m.def("process_sensor_data",
           &process_sensor_data_py,
@@ -610,7 +4711,11 @@ PYBIND11_MODULE(_native, m) {
           py::arg("charges") = py::none(),
           py::arg("grouping_window_ns") = py::none(),
           py::arg("extended") = false,
-          "Process sensor data with an optional grouping window.");
+          py::arg("out") = py::none(),
+          py::arg("plan") = py::none(),
+          py::arg("dtype") = py::none(),
+          "Process sensor data with an optional grouping window.\n\n"
+          "Input dtypes, `out`, `plan` and `dtype` work as for compute_summary_stats.");
 
     m.def("process_event_arrays",
           &process_event_arrays_py,
@@ -624,5 +4729,183 @@ PYBIND11_MODULE(_native, m) {
           py::arg("grouping_window_ns") = py::none(),
           py::arg("n_threads") = py::none(),
           py::arg("extended") = false,
-          "Process full event arrays into positions and summary statistics.");
+          py::arg("out") = py::none(),
+          py::arg("out_positions") = py::none(),
+          py::arg("plan") = py::none(),
+          py::arg("dtype") = py::none(),
+          py::arg("neighbor_rule") = py::none(),
+          py::arg("return_hlc_flags") = false,
+          py::arg("hlc_only") = false,
+          py::arg("cleaning") = py::none(),
+          py::arg("pmt_ids") = py::none(),
+          "Process full event arrays into positions and summary statistics.\n\n"
+          "Times, charges and positions are read in place as float32 or float64, IDs as\n"
+          "int16, int32 or int64 (other dtypes are converted first). `out` (shape\n"
+          "(>= n_sensors, n_stats)) and `out_positions` (shape (>= n_sensors, 3)) receive\n"
+          "the results when given; the returned arrays are then views of their leading\n"
+          "n_sensors rows. Both are float64 unless `dtype` is float32. A StatPlan `plan`\n"
+          "selects the statistic columns; otherwise `extended` picks the 9 or 25 defaults.\n"
+          "A NeighborRule `neighbor_rule` sets how n_string_neighbors is counted (default:\n"
+          "same string, +-2 sensor IDs, +-1000 ns). With `return_hlc_flags` a third array,\n"
+          "uint8 of shape (n_hits,) in input order, flags the HLC hits: those in coincidence\n"
+          "with hits on at least `multiplicity` neighbor sensors under the rule. With\n"
+          "`hlc_only` the statistics use only the HLC hits. A HitCleaning `cleaning` drops\n"
+          "noise hits (seeded RT, then time window) before the statistics; the flags are\n"
+          "always those of all hits. With `pmt_ids` the sensors are multi-PMT modules and\n"
+          "(pmt_positions, pmt_stats, pmt_offsets) follow the module tables: one row per\n"
+          "(string_id, sensor_id, pmt_id), the rows of module i being\n"
+          "pmt_offsets[i]:pmt_offsets[i + 1]. The flags, if any, come last.");
+
+    m.def("process_events_batch",
+          &process_events_batch_py,
+          py::arg("string_ids"),
+          py::arg("sensor_ids"),
+          py::arg("times"),
+          py::arg("pos_x"),
+          py::arg("pos_y"),
+          py::arg("pos_z"),
+          py::arg("event_offsets"),
+          py::arg("charges") = py::none(),
+          py::arg("grouping_window_ns") = py::none(),
+          py::arg("n_threads") = py::none(),
+          py::arg("extended") = false,
+          py::arg("out") = py::none(),
+          py::arg("out_positions") = py::none(),
+          py::arg("plan") = py::none(),
+          py::arg("dtype") = py::none(),
+          py::arg("neighbor_rule") = py::none(),
+          py::arg("return_hlc_flags") = false,
+          py::arg("hlc_only") = false,
+          py::arg("cleaning") = py::none(),
+          py::arg("pmt_ids") = py::none(),
+          "Process many events given as flat hit columns plus CSR-style event offsets.\n\n"
+          "Returns (positions, stats, sensor_offsets); the rows of event i are\n"
+          "sensor_offsets[i]:sensor_offsets[i + 1]. Input dtypes, `out` / `out_positions`,\n"
+          "`plan`, `dtype`, `neighbor_rule`, `return_hlc_flags` (a fourth array of flags\n"
+          "for all hits), `hlc_only`, `cleaning` and `pmt_ids` (PMT tables for the whole\n"
+          "batch, with pmt_offsets over all module rows) work as for process_event_arrays.");
+
+    py::class_<Geometry, std::shared_ptr<Geometry>>(
+        m, "Geometry",
+        "Fixed detector geometry: sensor positions keyed by (string_id, sensor_id).")
+        .def(py::init(&make_geometry),
+             py::arg("string_ids"),
+             py::arg("sensor_ids"),
+             py::arg("x"),
+             py::arg("y"),
+             py::arg("z"))
+        .def_property_readonly("n_sensors", &Geometry::n_sensors)
+        .def_property_readonly("string_ids", [](const Geometry& geometry) {
+            return Int32Array(py::array::ShapeContainer{static_cast<py::ssize_t>(geometry.n_sensors())},
+                              geometry.string_ids().data());
+        })
+        .def_property_readonly("sensor_ids", [](const Geometry& geometry) {
+            return Int32Array(py::array::ShapeContainer{static_cast<py::ssize_t>(geometry.n_sensors())},
+                              geometry.sensor_ids().data());
+        })
+        .def_property_readonly("positions", [](const Geometry& geometry) {
+            return DoubleArray(py::array::ShapeContainer{static_cast<py::ssize_t>(geometry.n_sensors()), 3},
+                               geometry.positions().data());
+        })
+        .def_property_readonly("grid_shape", [](const Geometry& geometry) {
+            return py::make_tuple(geometry.n_string_slots(), geometry.n_sensor_slots());
+        })
+        .def_property_readonly("grid_origin", [](const Geometry& geometry) {
+            return py::make_tuple(geometry.min_string_id(), geometry.min_sensor_id());
+        })
+        .def("index",
+             &geometry_index_py,
+             py::arg("string_ids"),
+             py::arg("sensor_ids"),
+             "Return the geometry row of each sensor, or -1 where it is not part of the geometry.");
+
+    m.def("process_event_geometry",
+          &process_event_geometry_py,
+          py::arg("geometry"),
+          py::arg("string_ids"),
+          py::arg("sensor_ids"),
+          py::arg("times"),
+          py::arg("charges") = py::none(),
+          py::arg("grouping_window_ns") = py::none(),
+          py::arg("n_threads") = py::none(),
+          py::arg("extended") = false,
+          py::arg("out") = py::none(),
+          py::arg("out_positions") = py::none(),
+          py::arg("plan") = py::none(),
+          py::arg("dtype") = py::none(),
+          py::arg("neighbor_rule") = py::none(),
+          py::arg("return_hlc_flags") = false,
+          py::arg("hlc_only") = false,
+          py::arg("cleaning") = py::none(),
+          py::arg("pmt_ids") = py::none(),
+          "Like process_event_arrays, with sensor positions taken from a Geometry.");
+
+    m.def("process_events_batch_geometry",
+          &process_events_batch_geometry_py,
+          py::arg("geometry"),
+          py::arg("string_ids"),
+          py::arg("sensor_ids"),
+          py::arg("times"),
+          py::arg("event_offsets"),
+          py::arg("charges") = py::none(),
+          py::arg("grouping_window_ns") = py::none(),
+          py::arg("n_threads") = py::none(),
+          py::arg("extended") = false,
+          py::arg("out") = py::none(),
+          py::arg("out_positions") = py::none(),
+          py::arg("plan") = py::none(),
+          py::arg("dtype") = py::none(),
+          py::arg("neighbor_rule") = py::none(),
+          py::arg("return_hlc_flags") = false,
+          py::arg("hlc_only") = false,
+          py::arg("cleaning") = py::none(),
+          py::arg("pmt_ids") = py::none(),
+          "Like process_events_batch, with sensor positions taken from a Geometry.");
+
+    m.def("process_event_dense",
+          &process_event_dense_py,
+          py::arg("geometry"),
+          py::arg("string_ids"),
+          py::arg("sensor_ids"),
+          py::arg("times"),
+          py::arg("charges") = py::none(),
+          py::arg("out") = py::none(),
+          py::arg("fill_value") = 0.0,
+          py::arg("grouping_window_ns") = py::none(),
+          py::arg("n_threads") = py::none(),
+          py::arg("extended") = false,
+          py::arg("plan") = py::none(),
+          py::arg("dtype") = py::none(),
+          py::arg("neighbor_rule") = py::none(),
+          py::arg("hlc_only") = false,
+          py::arg("cleaning") = py::none(),
+          "Write the statistics of an event into a dense detector tensor.\n\n"
+          "Returns an array of shape (*geometry.grid_shape, n_stats): the cell of sensor\n"
+          "(string_id, sensor_id) is [string_id - min_string_id, sensor_id - min_sensor_id]\n"
+          "(geometry.grid_origin), and cells without hits hold fill_value. `out` (float64,\n"
+          "or float32 with dtype=float32; C-contiguous, exact shape) is filled in place.\n"
+          "`plan`, `neighbor_rule`, `hlc_only` and `cleaning` work as for\n"
+          "process_event_arrays; per-hit HLC flags and per-PMT tables are not available.");
+
+    m.def("process_events_batch_dense",
+          &process_events_batch_dense_py,
+          py::arg("geometry"),
+          py::arg("string_ids"),
+          py::arg("sensor_ids"),
+          py::arg("times"),
+          py::arg("event_offsets"),
+          py::arg("charges") = py::none(),
+          py::arg("out") = py::none(),
+          py::arg("fill_value") = 0.0,
+          py::arg("grouping_window_ns") = py::none(),
+          py::arg("n_threads") = py::none(),
+          py::arg("extended") = false,
+          py::arg("plan") = py::none(),
+          py::arg("dtype") = py::none(),
+          py::arg("neighbor_rule") = py::none(),
+          py::arg("hlc_only") = false,
+          py::arg("cleaning") = py::none(),
+          "Write the statistics of a batch of events into a dense detector tensor.\n\n"
+          "Returns an array of shape (n_events, *geometry.grid_shape, n_stats), event i\n"
+          "in out[i], laid out as for process_event_dense.");
 }
@@ -0,0 +1,142 @@
+"""
+Shared fixtures for the nt_summary_stats test suite.
+
+Every native path promises bit-identical results (any thread count, any SIMD
+kernel, streaming, merged or fused), so the tests compare with exact equality.
+Comparisons against the NumPy implementation use integer times and charges on a
+0.25 grid: every sum is then exact whatever the summation order, and the two
+backends agree bit for bit on every column but the skewness, which NumPy
+evaluates from central rather than raw moments.
+
+The data generators are fixtures (returning the generator function) rather
+than importable helpers, so the suite runs under any pytest import mode.
+"""
+
+import contextlib
+
+import numpy as np
+import pytest
+
+import nt_summary_stats
+from nt_summary_stats import _backend
+
+SKEWNESS_COLUMN = 24
+
+
+@pytest.fixture
+def native():
+    """The native extension module; skips the test when it is not built."""
+    module = _backend.get_native_module()
+    if module is None:
+        pytest.skip("native extension not built")
+    return module
+
+
+@pytest.fixture
+def numpy_backend(monkeypatch):
+    """Context manager routing the entry points called inside it to the NumPy implementation."""
+    @contextlib.contextmanager
+    def use_numpy():
+        with monkeypatch.context() as patch:
+            patch.setattr(_backend, "get_native_module", lambda: None)
+            yield
+    return use_numpy
+
+
+@pytest.fixture
+def pool_of_eight(native):
+    """A pool of eight threads for the test, restoring the previous size afterwards."""
+    previous = nt_summary_stats.get_num_threads()
+    nt_summary_stats.set_num_threads(8)
+    yield
+    nt_summary_stats.set_num_threads(previous)
+
+
+@pytest.fixture(params=["native", "numpy"])
+def backend(request, numpy_backend):
+    """Context manager selecting each backend in turn; the native run skips when it is not built."""
+    if request.param == "native":
+        request.getfixturevalue("native")
+        return contextlib.nullcontext
+    return numpy_backend
+
+
+def _sensor_hits(seed, n_hits, exact=True, time_span=None):
+    """
+    Unsorted (times, charges) of one sensor, with repeated times. Exact hits have
+    integer times in [0, time_span) (default 4 * n_hits) and charges on a 0.25 grid.
+    """
+    rng = np.random.default_rng(seed)
+    if exact:
+        span = time_span if time_span is not None else max(4 * n_hits, 64)
+        times = rng.integers(0, span, n_hits).astype(np.float64)
+        charges = rng.integers(1, 33, n_hits) * 0.25
+    else:
+        times = rng.uniform(-50.0, 5000.0, n_hits)
+        times[rng.integers(0, n_hits, n_hits // 8)] = times[0]
+        charges = rng.exponential(1.0, n_hits)
+    return times, charges
+
+
+def _make_event(seed, n_hits, n_strings=6, n_sensors=20, exact=True, bright_hits=0, time_span=None):
+    """
+    Photon-level event over a small detector; ``bright_hits`` extra hits go to
+    sensor (1, 1), so that it takes the blocked (parallel) reduction.
+    """
+    rng = np.random.default_rng(seed)
+    string_ids = rng.integers(1, n_strings + 1, n_hits + bright_hits).astype(np.int32)
+    sensor_ids = rng.integers(1, n_sensors + 1, n_hits + bright_hits).astype(np.int32)
+    string_ids[n_hits:] = 1
+    sensor_ids[n_hits:] = 1
+    times, charges = _sensor_hits(seed, n_hits + bright_hits, exact, time_span)
+    return {
+        "sensor_pos_x": string_ids * 125.0,
+        "sensor_pos_y": string_ids * -40.0,
+        "sensor_pos_z": sensor_ids * -17.0,
+        "string_id": string_ids,
+        "sensor_id": sensor_ids,
+        "t": times,
+        "charge": charges,
+    }
+
+
+def _assert_stats_equal(actual, expected):
+    """
+    Exact equality; on 25-column (extended) rows the skewness column, which the
+    NumPy implementation evaluates differently, only to 1e-9.
+    """
+    actual = np.asarray(actual)
+    expected = np.asarray(expected)
+    assert actual.shape == expected.shape
+    if actual.shape[-1] != 25:
+        np.testing.assert_array_equal(actual, expected)
+        return
+    others = np.arange(actual.shape[-1]) != SKEWNESS_COLUMN
+    np.testing.assert_array_equal(actual[..., others], expected[..., others])
+    np.testing.assert_allclose(actual[..., SKEWNESS_COLUMN], expected[..., SKEWNESS_COLUMN],
+                               rtol=1e-9, atol=1e-9)
+
+
+@pytest.fixture(scope="session")
+def sensor_hits():
+    return _sensor_hits
+
+
+@pytest.fixture(scope="session")
+def make_event():
+    return _make_event
+
+
+@pytest.fixture(scope="session")
+def assert_stats_equal():
+    return _assert_stats_equal
+
+
+@pytest.fixture(scope="session")
+def flat_events():
+    """Concatenates events into one batch: (flat photon columns, event offsets)."""
+    def flatten(events):
+        offsets = np.cumsum([0] + [len(event["t"]) for event in events]).astype(np.int64)
+        flat = {key: np.concatenate([event[key] for event in events]) for key in events[0]}
+        return flat, offsets
+    return flatten
@@ -0,0 +1,83 @@
+"""SensorAccumulator gives the statistics of one batch call over the same hits."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import SensorAccumulator, StatPlan, compute_summary_stats
+
+
+@pytest.fixture
+def sorted_hits(sensor_hits):
+    def generate(seed, n_hits, exact=False):
+        times, charges = sensor_hits(seed, n_hits, exact)
+        order = np.argsort(times, kind="stable")
+        return times[order], charges[order]
+    return generate
+
+
+def stream(accumulator, times, charges, seed):
+    """Adds the hits in chunks of random size, some of them empty."""
+    rng = np.random.default_rng(seed)
+    start = 0
+    while start < len(times):
+        end = min(len(times), start + int(rng.integers(0, 40)))
+        accumulator.add(times[start:end], None if charges is None else charges[start:end])
+        start = end
+    return accumulator
+
+
+@pytest.mark.parametrize("n_hits", [1, 2, 3, 8, 9, 100, 5000, 40000])
+@pytest.mark.parametrize("extended", [False, True])
+def test_stream_matches_batch(native, sorted_hits, n_hits, extended):
+    times, charges = sorted_hits(n_hits, n_hits)
+    accumulator = stream(SensorAccumulator(extended), times, charges, n_hits)
+    assert accumulator.n_hits == n_hits
+    np.testing.assert_array_equal(accumulator.stats(), compute_summary_stats(times, charges, extended))
+
+
+def test_one_hit_at_a_time(native, sorted_hits):
+    times, charges = sorted_hits(1, 300)
+    accumulator = SensorAccumulator(extended=True)
+    for t, q in zip(times, charges):
+        accumulator.add([t], [q])
+    np.testing.assert_array_equal(accumulator.stats(), compute_summary_stats(times, charges, extended=True))
+
+
+def test_plan_matches_batch(native, sorted_hits):
+    plan = StatPlan(windows=(3.0, 75.0), quantiles=(0.3, 0.99), n_pulses=True, q_max_frac=True, skewness=True)
+    times, charges = sorted_hits(2, 2000)
+    accumulator = stream(SensorAccumulator(plan=plan), times, charges, 2)
+    np.testing.assert_array_equal(accumulator.stats(), compute_summary_stats(times, charges, plan=plan))
+
+
+def test_narrow_inputs_match_float64(native, sorted_hits):
+    times, charges = sorted_hits(3, 1000)
+    times32, charges32 = times.astype(np.float32), charges.astype(np.float32)
+    accumulator = stream(SensorAccumulator(extended=True), times32, charges32, 3)
+    expected = compute_summary_stats(times32.astype(np.float64), charges32.astype(np.float64), extended=True)
+    np.testing.assert_array_equal(accumulator.stats(), expected)
+    np.testing.assert_array_equal(accumulator.stats(dtype=np.float32), expected.astype(np.float32))
+
+    int_times = np.sort(np.random.default_rng(3).integers(-10**6, 10**6, 1000))
+    accumulator = stream(SensorAccumulator(extended=True), int_times, charges, 4)
+    expected = compute_summary_stats(int_times.astype(np.float64), charges, extended=True)
+    np.testing.assert_array_equal(accumulator.stats(), expected)
+
+
+def test_reset_starts_over(native, sorted_hits):
+    times, charges = sorted_hits(5, 400)
+    accumulator = stream(SensorAccumulator(extended=True), times, charges, 5)
+    accumulator.reset()
+    assert accumulator.n_hits == 0
+    stream(accumulator, times[200:], charges[200:], 6)
+    np.testing.assert_array_equal(accumulator.stats(),
+                                  compute_summary_stats(times[200:], charges[200:], extended=True))
+
+
+@pytest.mark.parametrize("extended", [False, True])
+def test_matches_numpy(native, sorted_hits, numpy_backend, assert_stats_equal, extended):
+    times, charges = sorted_hits(7, 3000, exact=True)
+    actual = stream(SensorAccumulator(extended), times, charges, 7).stats()
+    with numpy_backend():
+        reference = stream(SensorAccumulator(extended), times, charges, 7).stats()
+    assert_stats_equal(actual, reference)
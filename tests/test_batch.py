@@ -0,0 +1,71 @@
+"""The batch API against a loop of process_event."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import Geometry, StatPlan, process_event, process_events_batch
+
+
+def events_of(flat, offsets):
+    return [{key: column[offsets[i]:offsets[i + 1]] for key, column in flat.items()}
+            for i in range(len(offsets) - 1)]
+
+
+@pytest.fixture
+def batch(make_event, flat_events):
+    """Events of very different sizes, with empty events at the start, middle and end."""
+    events = [make_event(140 + i, n, exact=False) for i, n in enumerate([1, 7, 300, 2, 5000, 64])]
+    empty = {key: column[:0] for key, column in events[0].items()}
+    return flat_events([empty] + events[:3] + [empty, empty] + events[3:] + [empty])
+
+
+@pytest.mark.parametrize("kwargs", [
+    {},
+    {"extended": True},
+    {"grouping_window_ns": 7.5, "extended": True},
+    {"plan": StatPlan(windows=(3.0, 90.0), quantiles=(0.3,), n_pulses=True, skewness=True)},
+    {"extended": True, "dtype": np.float32},
+], ids=lambda kwargs: ",".join(kwargs) or "default")
+def test_matches_event_loop(native, batch, kwargs):
+    flat, offsets = batch
+    positions, stats, sensor_offsets = process_events_batch(flat, offsets, **kwargs)
+    assert sensor_offsets.dtype == np.int64 and len(sensor_offsets) == len(offsets)
+    assert sensor_offsets[-1] == len(stats) == len(positions)
+    for i, event in enumerate(events_of(flat, offsets)):
+        expected_positions, expected_stats = process_event(event, **kwargs)
+        rows = slice(sensor_offsets[i], sensor_offsets[i + 1])
+        np.testing.assert_array_equal(positions[rows], expected_positions)
+        np.testing.assert_array_equal(stats[rows], expected_stats)
+
+
+def test_offsets_as_list(native, batch):
+    flat, offsets = batch
+    for a, b in zip(process_events_batch(flat, offsets.tolist()), process_events_batch(flat, offsets)):
+        np.testing.assert_array_equal(a, b)
+
+
+@pytest.mark.parametrize("offsets", [[], [1, 20], [0, 15, 5, 20], [0, 10 ** 9]])
+def test_bad_offsets(backend, make_event, offsets):
+    event = make_event(150, 20)
+    with backend(), pytest.raises(ValueError):
+        process_events_batch(event, offsets)
+
+
+def test_matches_numpy(native, numpy_backend, make_event, flat_events, assert_stats_equal):
+    flat, offsets = flat_events([make_event(151 + i, 40 + 200 * i) for i in range(5)])
+    actual = process_events_batch(flat, offsets, 2.5, extended=True)
+    with numpy_backend():
+        reference = process_events_batch(flat, offsets, 2.5, extended=True)
+    np.testing.assert_array_equal(actual[0], reference[0])
+    assert_stats_equal(actual[1], reference[1])
+    np.testing.assert_array_equal(actual[2], reference[2])
+
+
+def test_geometry_batch_matches_positions(native, batch):
+    flat, offsets = batch
+    keys = np.unique(np.column_stack((flat["string_id"], flat["sensor_id"])), axis=0)
+    geometry = Geometry(keys[:, 0], keys[:, 1], keys[:, 0] * 125.0, keys[:, 0] * -40.0, keys[:, 1] * -17.0)
+    without_positions = {key: column for key, column in flat.items() if not key.startswith("sensor_pos")}
+    for a, b in zip(process_events_batch(without_positions, offsets, extended=True, geometry=geometry),
+                    process_events_batch(flat, offsets, extended=True)):
+        np.testing.assert_array_equal(a, b)
@@ -0,0 +1,74 @@
+"""
+Bright sensors at the block sizes of the parallel reduction and sort.
+
+Sums and running charges are formed per kSensorBlockHits (16384) hits; a sensor
+with kParallelSensorHits (65536) hits and up is sorted with parallel_sort (one
+slice per 16384 hits, up to the worker count) and reduced with
+compute_stats_from_sorted_parallel. Each size is tested exactly and one hit
+either side.
+"""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import process_event
+
+BLOCK_HITS = 16384
+PARALLEL_SENSOR_HITS = 4 * BLOCK_HITS
+SIZES = [n + d for n in (BLOCK_HITS, 2 * BLOCK_HITS, PARALLEL_SENSOR_HITS, PARALLEL_SENSOR_HITS + BLOCK_HITS,
+                         8 * BLOCK_HITS) for d in (-1, 0, 1)]
+
+
+@pytest.fixture
+def bright_event(make_event, sensor_hits):
+    def build(n_bright, exact):
+        """Exactly n_bright unsorted hits on sensor (1, 1), plus 300 hits on strings 2-7."""
+        others = make_event(n_bright, 300, exact=exact, time_span=4096)
+        others["string_id"] = others["string_id"] + 1
+        times, charges = sensor_hits(n_bright + 1, n_bright, exact=exact, time_span=4096)
+        bright = {
+            "sensor_pos_x": np.full(n_bright, 125.0),
+            "sensor_pos_y": np.full(n_bright, -40.0),
+            "sensor_pos_z": np.full(n_bright, -17.0),
+            "string_id": np.ones(n_bright, dtype=np.int32),
+            "sensor_id": np.ones(n_bright, dtype=np.int32),
+            "t": times,
+            "charge": charges,
+        }
+        return {key: np.concatenate((bright[key], others[key])) for key in bright}
+    return build
+
+
+@pytest.mark.parametrize("n_bright", SIZES)
+@pytest.mark.parametrize("unit", [False, True])
+def test_parallel_matches_serial(pool_of_eight, bright_event, n_bright, unit):
+    event = bright_event(n_bright, exact=False)
+    if unit:
+        del event["charge"]
+    serial = process_event(event, extended=True, n_threads=1)
+    assert serial[1][0, 21] == n_bright
+    for n_threads in (2, 3, 8):
+        parallel = process_event(event, extended=True, n_threads=n_threads)
+        for a, b in zip(parallel, serial):
+            np.testing.assert_array_equal(a, b)
+
+
+@pytest.mark.parametrize("n_bright", SIZES)
+def test_matches_numpy(pool_of_eight, numpy_backend, assert_stats_equal, bright_event, n_bright):
+    event = bright_event(n_bright, exact=True)
+    actual = process_event(event, extended=True, n_threads=8)
+    with numpy_backend():
+        reference = process_event(event, extended=True)
+    np.testing.assert_array_equal(actual[0], reference[0])
+    assert_stats_equal(actual[1], reference[1])
+
+
+@pytest.mark.parametrize("n_bright", [PARALLEL_SENSOR_HITS - 1, PARALLEL_SENSOR_HITS, PARALLEL_SENSOR_HITS + 1])
+def test_tied_times_keep_input_order(pool_of_eight, bright_event, n_bright):
+    # parallel_sort must order ties by index whatever the slicing, or the running charge would differ.
+    event = bright_event(n_bright, exact=False)
+    event["t"][:n_bright] = np.floor(event["t"][:n_bright] / 64.0)
+    serial = process_event(event, extended=True, n_threads=1)
+    parallel = process_event(event, extended=True, n_threads=8)
+    for a, b in zip(parallel, serial):
+        np.testing.assert_array_equal(a, b)
@@ -0,0 +1,116 @@
+"""Native noise cleaning keeps the hits _clean_hits_numpy keeps."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import HitCleaning, NeighborRule, process_event
+from nt_summary_stats.cleaning import _clean_hits_numpy
+from nt_summary_stats.neighbors import _neighbor_scan_numpy
+
+CLEANINGS = [
+    HitCleaning(time_window_ns=300.0),
+    HitCleaning(time_window_ns=2500.0),
+    HitCleaning(srt_radius=150.0, srt_time_ns=200.0),
+    HitCleaning(srt_radius=300.0, srt_time_ns=100.0, srt_iterations=1),
+    HitCleaning(srt_radius=150.0, srt_time_ns=200.0, time_window_ns=1000.0),
+]
+
+
+def numpy_keep(event, cleaning, rule):
+    """The mask _clean_hits_numpy keeps, seeded with the HLC flags of ``rule``."""
+    keys = np.column_stack((event["string_id"], event["sensor_id"]))
+    unique_keys, first, rows = np.unique(keys, axis=0, return_index=True, return_inverse=True)
+    rows = rows.reshape(-1)
+    sensor_hits = [np.flatnonzero(rows == row) for row in range(len(unique_keys))]
+    positions = np.column_stack([event[f"sensor_pos_{axis}"][first] for axis in "xyz"])
+    times = np.asarray(event["t"], dtype=np.float64)
+    _, flags = _neighbor_scan_numpy(rule, unique_keys, positions, [times[hits] for hits in sensor_hits])
+    seeds = np.zeros(len(times), dtype=bool)
+    for hits, hit_flags in zip(sensor_hits, flags):
+        seeds[hits] = hit_flags
+    return _clean_hits_numpy(cleaning, times, positions, sensor_hits, seeds)
+
+
+def kept(event, keep):
+    return {key: column[keep] for key, column in event.items()}
+
+
+def noisy_event(make_event, seed):
+    """A burst of correlated hits on top of uniform noise over a long readout."""
+    event = make_event(seed, 4000, n_strings=6, n_sensors=20, exact=True)
+    rng = np.random.default_rng(seed)
+    burst = rng.random(len(event["t"])) < 0.3
+    event["t"] = np.where(burst, 10000.0 + np.rint(rng.normal(0.0, 150.0, len(event["t"]))),
+                          rng.integers(0, 40000, len(event["t"])).astype(np.float64))
+    return event
+
+
+@pytest.mark.parametrize("cleaning", CLEANINGS, ids=repr)
+@pytest.mark.parametrize("seed", [70, 71])
+def test_matches_clean_hits_numpy(native, make_event, cleaning, seed):
+    event = noisy_event(make_event, seed)
+    rule = NeighborRule()
+    keep = numpy_keep(event, cleaning, rule)
+    assert 0 < keep.sum() < len(keep)
+    actual = process_event(event, extended=True, cleaning=cleaning, neighbor_rule=rule)
+    expected = process_event(kept(event, keep), extended=True, neighbor_rule=rule)
+    for a, b in zip(actual, expected):
+        np.testing.assert_array_equal(a, b)
+
+
+@pytest.mark.parametrize("cleaning", CLEANINGS, ids=repr)
+def test_matches_numpy(native, numpy_backend, make_event, assert_stats_equal, cleaning):
+    event = noisy_event(make_event, 72)
+    actual = process_event(event, extended=True, cleaning=cleaning)
+    with numpy_backend():
+        reference = process_event(event, extended=True, cleaning=cleaning)
+    np.testing.assert_array_equal(actual[0], reference[0])
+    assert_stats_equal(actual[1], reference[1])
+
+
+def window_event(sensors_and_times):
+    string_ids, sensor_ids, times = [], [], []
+    for (string_id, sensor_id), sensor_times in sensors_and_times.items():
+        string_ids += [string_id] * len(sensor_times)
+        sensor_ids += [sensor_id] * len(sensor_times)
+        times += sensor_times
+    string_ids, sensor_ids = np.array(string_ids), np.array(sensor_ids)
+    return {
+        "sensor_pos_x": string_ids * 125.0,
+        "sensor_pos_y": np.zeros(len(times)),
+        "sensor_pos_z": sensor_ids * -17.0,
+        "string_id": string_ids,
+        "sensor_id": sensor_ids,
+        "t": np.array(times, dtype=np.float64),
+        "charge": np.ones(len(times)),
+    }
+
+
+def test_densest_window_across_sensor_runs(native):
+    # Sensor (1, 1) alone holds four hits in [0, 100]. The densest window is
+    # [1000, 1100], whose five hits come from three sensors' interleaved runs;
+    # a scan of any single sensor's run finds at most two of them.
+    event = window_event({
+        (1, 1): [0.0, 20.0, 50.0, 90.0, 7000.0],
+        (1, 2): [1000.0, 1030.0, 3000.0],
+        (2, 1): [1010.0, 1060.0, 2000.0],
+        (3, 5): [1100.0, 6000.0],
+    })
+    cleaning = HitCleaning(time_window_ns=100.0)
+    keep = numpy_keep(event, cleaning, NeighborRule())
+    np.testing.assert_array_equal(np.sort(event["t"][keep]), [1000.0, 1010.0, 1030.0, 1060.0, 1100.0])
+    _, stats = process_event(event, cleaning=cleaning)
+    _, expected = process_event(kept(event, keep))
+    np.testing.assert_array_equal(stats, expected)
+    assert stats[:, 0].sum() == 5.0
+
+
+def test_densest_window_ties_take_the_earliest(native):
+    # Windows [0, 50] and [500, 550] each hold three hits, spread over sensors.
+    event = window_event({
+        (1, 1): [0.0, 500.0],
+        (1, 2): [10.0, 520.0],
+        (2, 1): [50.0, 550.0],
+    })
+    _, stats = process_event(event, cleaning=HitCleaning(time_window_ns=50.0))
+    np.testing.assert_array_equal(np.sort(stats[:, 3]), [0.0, 10.0, 50.0])
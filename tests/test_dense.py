@@ -0,0 +1,108 @@
+"""Dense detector tensors hold the process_event rows in their geometry cells."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import Geometry, NeighborRule, process_event, process_event_dense, process_events_batch_dense
+
+N_STRINGS, N_SENSORS = 6, 20
+
+
+def detector_geometry():
+    """The sensors of make_event, plus a never-hit string 7 with a hole at (7, 5)."""
+    strings, sensors = np.meshgrid(np.arange(1, N_STRINGS + 2), np.arange(1, N_SENSORS + 1), indexing="ij")
+    strings, sensors = strings.ravel(), sensors.ravel()
+    keep = ~((strings == 7) & (sensors == 5))
+    strings, sensors = strings[keep], sensors[keep]
+    return Geometry(strings, sensors, strings * 125.0, strings * -40.0, sensors * -17.0)
+
+
+def scattered(event, geometry, fill_value, **kwargs):
+    """The process_event rows scattered into a tensor of fill_value."""
+    positions, stats = process_event(event, geometry=geometry, **kwargs)[:2]
+    tensor = np.full((*geometry.grid_shape, stats.shape[1]), fill_value, dtype=stats.dtype)
+    # Row i belongs to the sensor at positions[i]; detector_geometry encodes its IDs in x and z.
+    strings = np.rint(positions[:, 0] / 125.0).astype(np.int64)
+    sensors = np.rint(positions[:, 2] / -17.0).astype(np.int64)
+    origin = geometry.grid_origin
+    tensor[strings - origin[0], sensors - origin[1]] = stats
+    return tensor
+
+
+@pytest.mark.parametrize("fill_value", [0.0, -1.0, np.nan])
+@pytest.mark.parametrize("grouping_window_ns", [None, 2.5])
+def test_event_matches_scattered_rows(native, make_event, fill_value, grouping_window_ns):
+    geometry = detector_geometry()
+    event = make_event(40, 1500, n_strings=N_STRINGS, n_sensors=N_SENSORS, exact=False)
+    tensor = process_event_dense(event, geometry, fill_value=fill_value, grouping_window_ns=grouping_window_ns,
+                                 extended=True)
+    assert tensor.shape == (N_STRINGS + 1, N_SENSORS, 25)
+    np.testing.assert_array_equal(tensor, scattered(event, geometry, fill_value,
+                                                    grouping_window_ns=grouping_window_ns, extended=True))
+    # The never-hit string and the grid hole hold fill_value in every column.
+    np.testing.assert_array_equal(tensor[N_STRINGS], np.full((N_SENSORS, 25), fill_value))
+
+
+@pytest.mark.parametrize("fill_value", [0.0, np.nan])
+def test_float32_matches_float64(native, make_event, fill_value):
+    geometry = detector_geometry()
+    event = make_event(41, 3000, n_strings=N_STRINGS, n_sensors=N_SENSORS, exact=False)
+    single = process_event_dense(event, geometry, fill_value=fill_value, extended=True, dtype=np.float32)
+    double = process_event_dense(event, geometry, fill_value=fill_value, extended=True)
+    assert single.dtype == np.float32
+    np.testing.assert_array_equal(single, double.astype(np.float32))
+
+
+def test_out_is_refilled(native, make_event):
+    geometry = detector_geometry()
+    out = np.full((*geometry.grid_shape, 9), 123.0, dtype=np.float32)
+    first = make_event(42, 2000, n_strings=N_STRINGS, n_sensors=N_SENSORS)
+    second = make_event(43, 40, n_strings=N_STRINGS, n_sensors=N_SENSORS)
+    process_event_dense(first, geometry, out=out, dtype=np.float32)
+    result = process_event_dense(second, geometry, out=out, fill_value=-5.0, dtype=np.float32)
+    assert result is out or np.shares_memory(result, out)
+    np.testing.assert_array_equal(out, scattered(second, geometry, -5.0).astype(np.float32))
+
+
+@pytest.mark.parametrize("dtype, shape", [(np.float64, None), (np.float32, (7, 20, 25)), (np.float32, (7, 20))])
+def test_out_errors(native, make_event, dtype, shape):
+    geometry = detector_geometry()
+    event = make_event(44, 100, n_strings=N_STRINGS, n_sensors=N_SENSORS)
+    out = np.zeros(shape or (*geometry.grid_shape, 9), dtype=dtype)
+    with pytest.raises(ValueError, match="out must"):
+        process_event_dense(event, geometry, out=out, dtype=np.float32)
+    with pytest.raises(ValueError, match="out must"):
+        process_event_dense(event, geometry, out=np.zeros((7, 40, 9), dtype=np.float32)[:, ::2], dtype=np.float32)
+
+
+def test_hlc_only_keeps_fill_value(native, make_event):
+    geometry = detector_geometry()
+    event = make_event(45, 300, n_strings=N_STRINGS, n_sensors=N_SENSORS, exact=False)
+    rule = NeighborRule(window_ns=50.0)
+    tensor = process_event_dense(event, geometry, fill_value=np.nan, neighbor_rule=rule, hlc_only=True)
+    np.testing.assert_array_equal(tensor, scattered(event, geometry, np.nan, neighbor_rule=rule, hlc_only=True))
+
+
+@pytest.mark.parametrize("dtype", [np.float64, np.float32])
+def test_batch_matches_events(native, make_event, flat_events, dtype):
+    geometry = detector_geometry()
+    events = [make_event(50 + i, 30 + 400 * i, n_strings=N_STRINGS, n_sensors=N_SENSORS, exact=False)
+              for i in range(6)]
+    events.insert(3, {key: column[:0] for key, column in events[0].items()})
+    flat, offsets = flat_events(events)
+    batch = process_events_batch_dense(flat, offsets, geometry, fill_value=-1.0, extended=True, dtype=dtype)
+    assert batch.shape == (len(events), *geometry.grid_shape, 25)
+    for i, event in enumerate(events):
+        expected = process_event_dense(event, geometry, fill_value=-1.0, extended=True, dtype=dtype)
+        np.testing.assert_array_equal(batch[i], expected)
+
+
+@pytest.mark.parametrize("fill_value", [0.0, np.nan])
+def test_matches_numpy(native, numpy_backend, make_event, flat_events, assert_stats_equal, fill_value):
+    events = [make_event(60 + i, 200 + 300 * i, n_strings=N_STRINGS, n_sensors=N_SENSORS) for i in range(4)]
+    flat, offsets = flat_events(events)
+    actual = process_events_batch_dense(flat, offsets, detector_geometry(), fill_value=fill_value, extended=True)
+    with numpy_backend():
+        reference = process_events_batch_dense(flat, offsets, detector_geometry(), fill_value=fill_value,
+                                               extended=True)
+    assert_stats_equal(actual, reference)
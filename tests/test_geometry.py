@@ -0,0 +1,131 @@
+"""Registered geometry lookups against explicit per-hit positions, and geometry errors."""
+
+import pickle
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import Geometry, process_event, process_events_batch
+
+N_STRINGS, N_SENSORS = 6, 20
+
+
+def detector(shuffle_seed=None):
+    """(string_ids, sensor_ids, x, y, z) of the make_event detector, in a shuffled order."""
+    strings, sensors = np.meshgrid(np.arange(1, N_STRINGS + 1), np.arange(1, N_SENSORS + 1), indexing="ij")
+    strings, sensors = strings.ravel(), sensors.ravel()
+    if shuffle_seed is not None:
+        order = np.random.default_rng(shuffle_seed).permutation(len(strings))
+        strings, sensors = strings[order], sensors[order]
+    return strings, sensors, strings * 125.0, strings * -40.0, sensors * -17.0
+
+
+def without_positions(event):
+    return {key: column for key, column in event.items() if not key.startswith("sensor_pos")}
+
+
+@pytest.mark.parametrize("id_dtype", [np.int16, np.int32, np.int64])
+@pytest.mark.parametrize("grouping_window_ns", [None, 2.5])
+def test_event_matches_explicit_positions(backend, make_event, id_dtype, grouping_window_ns):
+    event = make_event(160, 3000, n_strings=N_STRINGS, n_sensors=N_SENSORS, exact=False)
+    event["string_id"] = event["string_id"].astype(id_dtype)
+    event["sensor_id"] = event["sensor_id"].astype(id_dtype)
+    with backend():
+        geometry = Geometry(*detector(shuffle_seed=160))
+        actual = process_event(without_positions(event), grouping_window_ns, extended=True, geometry=geometry)
+        expected = process_event(event, grouping_window_ns, extended=True)
+    for a, b in zip(actual, expected):
+        np.testing.assert_array_equal(a, b)
+
+
+def test_batch_matches_explicit_positions(backend, make_event, flat_events):
+    flat, offsets = flat_events([make_event(161 + i, 20 + 400 * i, exact=False) for i in range(5)])
+    with backend():
+        geometry = Geometry(*detector(shuffle_seed=161))
+        actual = process_events_batch(without_positions(flat), offsets, extended=True, geometry=geometry)
+        expected = process_events_batch(flat, offsets, extended=True)
+    for a, b in zip(actual, expected):
+        np.testing.assert_array_equal(a, b)
+
+
+def test_lookups(backend):
+    with backend():
+        strings, sensors, x, y, z = detector(shuffle_seed=162)
+        geometry = Geometry(strings, sensors, x, y, z)
+        np.testing.assert_array_equal(geometry.index(strings, sensors), np.arange(len(strings)))
+        np.testing.assert_array_equal(geometry.positions, np.column_stack((x, y, z)))
+        rng = np.random.default_rng(162)
+        rows = rng.integers(0, len(strings), 500)
+        np.testing.assert_array_equal(geometry.hit_positions(strings[rows], sensors[rows]),
+                                      np.column_stack((x, y, z))[rows])
+        # Outside the ID ranges, or beyond int32, a sensor is simply not part of the geometry.
+        np.testing.assert_array_equal(geometry.index([0, 7, 3, 2 ** 32 + 1, 1], [1, 1, 21, 1, -2 ** 33]),
+                                      [-1, -1, -1, -1, -1])
+        assert geometry.grid_shape == (N_STRINGS, N_SENSORS) and geometry.grid_origin == (1, 1)
+
+
+def test_from_table_and_pickle(backend):
+    with backend():
+        strings, sensors, x, y, z = detector(shuffle_seed=163)
+        geometry = Geometry.from_table(np.column_stack((strings, sensors, x, y, z)))
+        restored = pickle.loads(pickle.dumps(geometry))
+    for g in (geometry, restored):
+        np.testing.assert_array_equal(g.string_ids, strings)
+        np.testing.assert_array_equal(g.sensor_ids, sensors)
+        np.testing.assert_array_equal(g.positions, np.column_stack((x, y, z)))
+
+
+def test_duplicate_sensor(backend):
+    strings, sensors, x, y, z = detector()
+    strings[40], sensors[40] = strings[7], sensors[7]
+    with backend(), pytest.raises(ValueError, match=rf"sensor \(string_id={strings[7]}, "
+                                                    rf"sensor_id={sensors[7]}\) more than once"):
+        Geometry(strings, sensors, x, y, z)
+
+
+@pytest.mark.parametrize("batch", [False, True])
+def test_unknown_sensor(backend, make_event, batch):
+    event = make_event(164, 500, n_strings=N_STRINGS, n_sensors=N_SENSORS)
+    event["string_id"][123] = 4
+    event["sensor_id"][123] = 25
+    with backend(), pytest.raises(ValueError, match=r"sensor \(string_id=4, sensor_id=25\) is not part of the "
+                                                    r"geometry"):
+        geometry = Geometry(*detector())
+        if batch:
+            process_events_batch(without_positions(event), [0, 100, 500], geometry=geometry)
+        else:
+            process_event(without_positions(event), geometry=geometry)
+
+
+@pytest.mark.parametrize("string_id, sensor_id", [(2 ** 31, 1), (1, -2 ** 31 - 1), (2 ** 32 + 1, 1)])
+def test_ids_beyond_int32_raise(backend, string_id, sensor_id):
+    strings, sensors, x, y, z = detector()
+    strings = strings.astype(np.int64)
+    sensors = sensors.astype(np.int64)
+    strings[-1], sensors[-1] = string_id, sensor_id
+    with backend():
+        with pytest.raises(ValueError, match="string_id and sensor_id values must fit in int32"):
+            Geometry(strings, sensors, x, y, z)
+        with pytest.raises(ValueError, match="string_id and sensor_id values must fit in int32"):
+            Geometry.from_table(np.column_stack((strings, sensors, x, y, z)))
+
+
+def test_native_geometry_ids_beyond_int32_raise(native):
+    strings, sensors, x, y, z = detector()
+    strings = strings.astype(np.int64)
+    strings[-1] = 2 ** 31 + 6
+    with pytest.raises(ValueError, match="string_id and sensor_id values must fit in int32"):
+        native.Geometry(strings, sensors.astype(np.int64), x, y, z)
+    # In range, int64 IDs are narrowed.
+    geometry = native.Geometry(strings % 2 ** 31, sensors.astype(np.int64), x, y, z)
+    np.testing.assert_array_equal(geometry.index(np.int64([2 ** 31 + 6, 6]), np.int64([20, 20])), [-1, len(x) - 1])
+
+
+def test_event_ids_beyond_int32_raise(native, make_event):
+    event = make_event(165, 300, n_strings=N_STRINGS, n_sensors=N_SENSORS)
+    event["string_id"] = event["string_id"].astype(np.int64)
+    event["string_id"][17] = 2 ** 31
+    for sensor_dtype in (np.int64, np.int32):
+        event["sensor_id"] = event["sensor_id"].astype(sensor_dtype)
+        with pytest.raises(ValueError, match="string_id and sensor_id values must fit in int32"):
+            process_event(event)
@@ -0,0 +1,71 @@
+"""Fused grouping gives the statistics of the grouped hits of _group_hits_by_window."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import StatPlan, compute_summary_stats, process_event, process_sensor_data
+from nt_summary_stats.event import _group_hits_by_window
+
+N_PULSES_COLUMN = 21
+WINDOWS = [0.5, 1.0, 2.5, 7.5, 40.0, 1e6]
+
+
+def grouped_reference(times, charges, window_ns, extended=False, plan=None):
+    """Stats of the grouped hits, with n_pulses counting the hits before grouping."""
+    grouped_times, grouped_charges = _group_hits_by_window(
+        times, np.ones_like(times) if charges is None else charges, window_ns)
+    stats = compute_summary_stats(grouped_times, grouped_charges, extended, plan=plan)
+    column = N_PULSES_COLUMN if plan is None else plan.names.index("n_pulses")
+    if extended or plan is not None:
+        stats[column] = len(times)
+    return stats
+
+
+@pytest.mark.parametrize("window_ns", WINDOWS)
+@pytest.mark.parametrize("n_hits", [1, 2, 9, 300, 20000])
+def test_sensor_matches_reference(native, sensor_hits, window_ns, n_hits):
+    times, charges = sensor_hits(n_hits, n_hits)
+    actual = process_sensor_data(times, charges, window_ns, extended=True)
+    np.testing.assert_array_equal(actual, grouped_reference(times, charges, window_ns, extended=True))
+    np.testing.assert_array_equal(process_sensor_data(times, charges, window_ns),
+                                  grouped_reference(times, charges, window_ns))
+
+
+@pytest.mark.parametrize("window_ns", WINDOWS)
+def test_unit_charges_match_reference(native, sensor_hits, window_ns):
+    times, _ = sensor_hits(3, 5000)
+    np.testing.assert_array_equal(process_sensor_data(times, None, window_ns, extended=True),
+                                  grouped_reference(times, None, window_ns, extended=True))
+
+
+def test_plan_matches_reference(native, sensor_hits):
+    plan = StatPlan(windows=(4.0, 60.0), quantiles=(0.15, 0.85), n_pulses=True, q_max_frac=True, skewness=True)
+    times, charges = sensor_hits(4, 8000)
+    np.testing.assert_array_equal(process_sensor_data(times, charges, 2.5, plan=plan),
+                                  grouped_reference(times, charges, 2.5, plan=plan))
+
+
+@pytest.mark.parametrize("window_ns", [1.0, 7.5])
+def test_event_rows_match_sensors(native, make_event, window_ns):
+    event = make_event(5, 6000, n_strings=8, n_sensors=30)
+    _, stats = process_event(event, window_ns, extended=True)
+    keys = np.column_stack((event["string_id"], event["sensor_id"]))
+    unique_keys, rows = np.unique(keys, axis=0, return_inverse=True)
+    rows = rows.reshape(-1)
+    assert len(stats) == len(unique_keys)
+    for row in range(len(unique_keys)):
+        hits = rows == row
+        expected = grouped_reference(event["t"][hits], event["charge"][hits], window_ns, extended=True)
+        # n_string_neighbors is an event-level count.
+        expected[23] = stats[row, 23]
+        np.testing.assert_array_equal(stats[row], expected)
+
+
+@pytest.mark.parametrize("window_ns", [1.0, 7.5, 40.0])
+@pytest.mark.parametrize("extended", [False, True])
+def test_sensor_matches_numpy(native, numpy_backend, sensor_hits, assert_stats_equal, window_ns, extended):
+    times, charges = sensor_hits(6, 4000)
+    actual = process_sensor_data(times, charges, window_ns, extended=extended)
+    with numpy_backend():
+        reference = process_sensor_data(times, charges, window_ns, extended=extended)
+    assert_stats_equal(actual, reference)
@@ -0,0 +1,83 @@
+"""HLC flags and hlc_only against the per-sensor flags of _neighbor_scan_numpy."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import NeighborRule, process_event, process_events_batch
+from nt_summary_stats.neighbors import _neighbor_scan_numpy
+
+RULES = [
+    NeighborRule(),
+    NeighborRule(window_ns=200.0, max_id_distance=1),
+    NeighborRule(window_ns=1000.0, max_id_distance=3, multiplicity=2),
+    NeighborRule(window_ns=500.0, radius=140.0, multiplicity=2),
+]
+
+
+def numpy_flags(event, rule):
+    """The HLC flag of every hit, in input order."""
+    keys = np.column_stack((event["string_id"], event["sensor_id"]))
+    unique_keys, first, rows = np.unique(keys, axis=0, return_index=True, return_inverse=True)
+    rows = rows.reshape(-1)
+    sensor_hits = [np.flatnonzero(rows == row) for row in range(len(unique_keys))]
+    positions = np.column_stack([event[f"sensor_pos_{axis}"][first] for axis in "xyz"])
+    times = np.asarray(event["t"], dtype=np.float64)
+    _, flags = _neighbor_scan_numpy(rule, unique_keys, positions, [times[hits] for hits in sensor_hits])
+    hit_flags = np.zeros(len(times), dtype=np.uint8)
+    for hits, sensor_flags in zip(sensor_hits, flags):
+        hit_flags[hits] = sensor_flags
+    return hit_flags
+
+
+def sparse_event(make_event, seed, n_hits=1500):
+    """Hits spread over a long readout, so that a fair share of them are isolated."""
+    event = make_event(seed, n_hits, n_strings=6, n_sensors=40, exact=True)
+    event["t"] = np.random.default_rng(seed).integers(0, 200000, n_hits).astype(np.float64)
+    return event
+
+
+@pytest.mark.parametrize("rule", RULES, ids=repr)
+@pytest.mark.parametrize("seed", [90, 91])
+def test_flags_match_numpy_in_input_order(native, make_event, rule, seed):
+    event = sparse_event(make_event, seed)
+    expected = numpy_flags(event, rule)
+    assert 0 < expected.sum() < len(expected)
+    result = process_event(event, extended=True, neighbor_rule=rule, return_hlc_flags=True)
+    assert len(result) == 3
+    assert result[2].dtype == np.uint8
+    np.testing.assert_array_equal(result[2], expected)
+
+
+@pytest.mark.parametrize("rule", RULES, ids=repr)
+def test_hlc_only_keeps_flagged_hits(native, make_event, rule):
+    event = sparse_event(make_event, 92)
+    flags = numpy_flags(event, rule).astype(bool)
+    positions, stats, hit_flags = process_event(event, 2.5, extended=True, neighbor_rule=rule, hlc_only=True,
+                                                return_hlc_flags=True)
+    expected = process_event({key: column[flags] for key, column in event.items()}, 2.5, extended=True,
+                             neighbor_rule=rule)
+    np.testing.assert_array_equal(positions, expected[0])
+    np.testing.assert_array_equal(stats, expected[1])
+    # The flags stay those of all hits.
+    np.testing.assert_array_equal(hit_flags, flags)
+
+
+def test_batch_flags(native, make_event, flat_events):
+    rule = RULES[2]
+    events = [sparse_event(make_event, 93 + i, 200 + 300 * i) for i in range(5)]
+    flat, offsets = flat_events(events)
+    *_, hit_flags = process_events_batch(flat, offsets, extended=True, neighbor_rule=rule, return_hlc_flags=True)
+    np.testing.assert_array_equal(hit_flags, np.concatenate([numpy_flags(event, rule) for event in events]))
+
+
+@pytest.mark.parametrize("hlc_only", [False, True])
+@pytest.mark.parametrize("rule", RULES[1::2], ids=repr)
+def test_matches_numpy(native, numpy_backend, make_event, assert_stats_equal, rule, hlc_only):
+    event = sparse_event(make_event, 98)
+    actual = process_event(event, extended=True, neighbor_rule=rule, hlc_only=hlc_only, return_hlc_flags=True)
+    with numpy_backend():
+        reference = process_event(event, extended=True, neighbor_rule=rule, hlc_only=hlc_only,
+                                  return_hlc_flags=True)
+    np.testing.assert_array_equal(actual[0], reference[0])
+    assert_stats_equal(actual[1], reference[1])
+    np.testing.assert_array_equal(actual[2], reference[2])
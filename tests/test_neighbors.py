@@ -0,0 +1,132 @@
+"""n_string_neighbors of the native neighbor engine against _neighbor_scan_numpy."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import NeighborRule, StatPlan, process_event
+from nt_summary_stats.neighbors import _neighbor_scan_numpy
+
+NEIGHBORS_COLUMN = 23
+
+
+def sensors_of(event):
+    """(keys, positions, hit times) of each sensor, in the row order of process_event."""
+    keys = np.column_stack((event["string_id"], event["sensor_id"]))
+    unique_keys, first, rows = np.unique(keys, axis=0, return_index=True, return_inverse=True)
+    rows = rows.reshape(-1)
+    positions = np.column_stack([event[f"sensor_pos_{axis}"][first] for axis in "xyz"])
+    times = [event["t"][rows == row] for row in range(len(unique_keys))]
+    return unique_keys, positions, times
+
+
+def numpy_column(event, rule):
+    """The n_string_neighbors column: coincident neighbors once they reach the multiplicity, else 0."""
+    counts, _ = _neighbor_scan_numpy(rule, *sensors_of(event))
+    return np.where(counts >= rule.multiplicity, counts, 0).astype(np.float64)
+
+
+def baseline_column(event):
+    """The original extended=True scan: same string, +-2 sensor IDs, +-1000 ns, over rows i-4..i+4."""
+    keys, _, times = sensors_of(event)
+    sorted_times = [np.sort(t) for t in times]
+    column = np.zeros(len(keys))
+    for i in range(len(keys)):
+        for j in range(max(0, i - 4), min(len(keys), i + 5)):
+            if j == i or keys[j, 0] != keys[i, 0] or not 1 <= abs(int(keys[j, 1]) - int(keys[i, 1])) <= 2:
+                continue
+            differences = np.abs(sorted_times[i][:, None] - sorted_times[j][None, :])
+            column[i] += bool((differences <= 1000.0).any())
+    return column
+
+
+def scattered_event(seed, n_hits, n_sensors=150, span=300.0):
+    """Hits on sensors at random 3D positions, so that radius rules span several grid cells."""
+    rng = np.random.default_rng(seed)
+    positions = rng.uniform(-span, span, (n_sensors, 3))
+    sensor = rng.integers(0, n_sensors, n_hits)
+    return {
+        "sensor_pos_x": positions[sensor, 0],
+        "sensor_pos_y": positions[sensor, 1],
+        "sensor_pos_z": positions[sensor, 2],
+        "string_id": (sensor // 10 + 1).astype(np.int32),
+        "sensor_id": (sensor % 10 + 1).astype(np.int32),
+        "t": rng.uniform(0.0, 20000.0, n_hits),
+        "charge": rng.exponential(1.0, n_hits),
+    }
+
+
+@pytest.mark.parametrize("seed", [80, 81, 82])
+def test_default_rule_reproduces_baseline(native, make_event, seed):
+    event = make_event(seed, 600, n_strings=5, n_sensors=60, exact=False)
+    _, stats = process_event(event, extended=True)
+    expected = baseline_column(event)
+    np.testing.assert_array_equal(stats[:, NEIGHBORS_COLUMN], expected)
+    np.testing.assert_array_equal(expected, numpy_column(event, NeighborRule()))
+    _, explicit = process_event(event, extended=True, neighbor_rule=NeighborRule())
+    np.testing.assert_array_equal(explicit, stats)
+
+
+@pytest.mark.parametrize("rule", [
+    NeighborRule(window_ns=0.0),
+    NeighborRule(window_ns=250.0, max_id_distance=1),
+    NeighborRule(window_ns=500.0, max_id_distance=7),
+], ids=repr)
+def test_id_rules(native, make_event, rule):
+    event = make_event(83, 2000, n_strings=5, n_sensors=60, exact=True)
+    _, stats = process_event(event, extended=True, neighbor_rule=rule)
+    np.testing.assert_array_equal(stats[:, NEIGHBORS_COLUMN], numpy_column(event, rule))
+
+
+@pytest.mark.parametrize("radius", [20.0, 75.0, 160.0, 1000.0])
+@pytest.mark.parametrize("seed", [84, 85])
+def test_radius_rules(native, radius, seed):
+    event = scattered_event(seed, 3000)
+    rule = NeighborRule(window_ns=300.0, radius=radius)
+    _, stats = process_event(event, extended=True, neighbor_rule=rule)
+    expected = numpy_column(event, rule)
+    np.testing.assert_array_equal(stats[:, NEIGHBORS_COLUMN], expected)
+    if radius == 1000.0:
+        # Nearly every other hit sensor is in range.
+        assert expected.max() > 100
+
+
+def test_radius_on_string_layout(native, make_event):
+    # Sensors up to 8 IDs apart on a string (17 units each) are in range, and so is the
+    # same depth on an adjacent string (131 units away); the ID rule reaches neither.
+    event = make_event(86, 1500, n_strings=5, n_sensors=60, exact=False)
+    rule = NeighborRule(window_ns=400.0, radius=140.0)
+    _, stats = process_event(event, extended=True, neighbor_rule=rule)
+    np.testing.assert_array_equal(stats[:, NEIGHBORS_COLUMN], numpy_column(event, rule))
+
+
+@pytest.mark.parametrize("multiplicity", [1, 2, 3, 6])
+@pytest.mark.parametrize("radius", [None, 160.0])
+def test_multiplicity_cut(native, radius, multiplicity):
+    event = scattered_event(87, 4000)
+    rule = NeighborRule(window_ns=400.0, max_id_distance=3, radius=radius, multiplicity=multiplicity)
+    _, stats = process_event(event, extended=True, neighbor_rule=rule)
+    expected = numpy_column(event, rule)
+    np.testing.assert_array_equal(stats[:, NEIGHBORS_COLUMN], expected)
+    if multiplicity > 1:
+        assert ((expected > 0) & (expected < multiplicity)).sum() == 0
+
+
+def test_plan_column(native, make_event):
+    event = make_event(88, 800, n_strings=5, n_sensors=60, exact=False)
+    rule = NeighborRule(window_ns=200.0, radius=60.0, multiplicity=2)
+    plan = StatPlan.select(["n_string_neighbors", "total_charge"])
+    _, stats = process_event(event, plan=plan, neighbor_rule=rule)
+    np.testing.assert_array_equal(stats[:, 0], numpy_column(event, rule))
+
+
+@pytest.mark.parametrize("rule", [NeighborRule(), NeighborRule(window_ns=300.0, radius=160.0, multiplicity=2)],
+                         ids=repr)
+def test_matches_numpy(native, numpy_backend, assert_stats_equal, rule):
+    event = scattered_event(89, 2500)
+    event["t"] = np.rint(event["t"])
+    event["charge"] = np.rint(event["charge"] * 4.0) * 0.25
+    actual = process_event(event, extended=True, neighbor_rule=rule)
+    with numpy_backend():
+        reference = process_event(event, extended=True, neighbor_rule=rule)
+    np.testing.assert_array_equal(actual[0], reference[0])
+    assert_stats_equal(actual[1], reference[1])
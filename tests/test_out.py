@@ -0,0 +1,110 @@
+"""Caller-provided out buffers: filled in place, and rejected with the same errors by both backends."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import compute_summary_stats, process_event, process_events_batch, process_sensor_data
+
+
+@pytest.mark.parametrize("dtype", [np.float64, np.float32])
+def test_out_with_spare_rows_returns_leading_view(backend, make_event, dtype):
+    event = make_event(152, 500)
+    with backend():
+        positions, stats = process_event(event, extended=True, dtype=dtype)
+        out = np.full((len(stats) + 13, 25), -7.0, dtype=dtype)
+        out_positions = np.full((len(stats) + 5, 3), -7.0, dtype=dtype)
+        result = process_event(event, extended=True, dtype=dtype, out=out, out_positions=out_positions)
+    assert result[1].shape == stats.shape and result[0].shape == positions.shape
+    assert np.shares_memory(result[1], out)
+    assert np.shares_memory(result[0], out_positions)
+    np.testing.assert_array_equal(result[1], stats)
+    np.testing.assert_array_equal(result[0], positions)
+    np.testing.assert_array_equal(out[len(stats):], -7.0)
+    np.testing.assert_array_equal(out_positions[len(stats):], -7.0)
+
+
+def test_batch_out(backend, make_event, flat_events):
+    flat, offsets = flat_events([make_event(153 + i, 100 + 50 * i) for i in range(4)])
+    with backend():
+        positions, stats, sensor_offsets = process_events_batch(flat, offsets, extended=True)
+        out = np.zeros((len(stats) + 2, 25))
+        out_positions = np.zeros((len(stats), 3))
+        result = process_events_batch(flat, offsets, extended=True, out=out, out_positions=out_positions)
+    assert np.shares_memory(result[1], out) and np.shares_memory(result[0], out_positions)
+    np.testing.assert_array_equal(result[1], stats)
+    np.testing.assert_array_equal(result[0], positions)
+    np.testing.assert_array_equal(result[2], sensor_offsets)
+
+
+def test_sensor_out(backend, sensor_hits):
+    times, charges = sensor_hits(154, 300)
+    with backend():
+        expected = process_sensor_data(times, charges, 2.5, extended=True)
+        out = np.zeros(25)
+        result = process_sensor_data(times, charges, 2.5, extended=True, out=out)
+        single = np.zeros(9, dtype=np.float32)
+        single_result = compute_summary_stats(times, charges, out=single, dtype=np.float32)
+    assert np.shares_memory(result, out) and np.shares_memory(single_result, single)
+    np.testing.assert_array_equal(out, expected)
+    np.testing.assert_array_equal(single, compute_summary_stats(times, charges).astype(np.float32))
+
+
+def read_only(array):
+    array.flags.writeable = False
+    return array
+
+
+# (out, out_positions, dtype, error) for an event of N sensor rows and 25 columns.
+EVENT_OUT_ERRORS = [
+    (lambda n: np.zeros((n, 25), dtype=np.float32), None, np.float64, "out must have dtype float64"),
+    (lambda n: np.zeros((n, 25)), None, np.float32, "out must have dtype float32"),
+    (lambda n: np.zeros((n, 25), dtype=np.int64), None, np.float64, "out must have dtype"),
+    (lambda n: np.zeros((n - 1, 25)), None, np.float64, r"out must have shape \(n, 25\)"),
+    (lambda n: np.zeros((n, 9)), None, np.float64, r"out must have shape \(n, 25\)"),
+    (lambda n: np.zeros(n * 25), None, np.float64, r"out must have shape \(n, 25\)"),
+    (lambda n: np.zeros((n, 25, 1)), None, np.float64, r"out must have shape \(n, 25\)"),
+    (lambda n: np.zeros((n, 50))[:, ::2], None, np.float64, "out must be a writeable C-contiguous array"),
+    (lambda n: np.zeros((25, n)).T, None, np.float64, "out must be a writeable C-contiguous array"),
+    (lambda n: read_only(np.zeros((n, 25))), None, np.float64, "out must be a writeable C-contiguous array"),
+    (None, lambda n: np.zeros((n, 3), dtype=np.float32), np.float64, "out_positions must have dtype float64"),
+    (None, lambda n: np.zeros((n - 1, 3)), np.float64, r"out_positions must have shape \(n, 3\)"),
+    (None, lambda n: np.zeros((n, 4)), np.float64, r"out_positions must have shape \(n, 3\)"),
+    (None, lambda n: np.zeros((n, 6))[:, ::2], np.float64, "out_positions must be a writeable C-contiguous"),
+]
+
+
+@pytest.mark.parametrize("out, out_positions, dtype, error", EVENT_OUT_ERRORS)
+def test_event_out_errors(backend, make_event, out, out_positions, dtype, error):
+    event = make_event(155, 400)
+    with backend():
+        n = len(process_event(event)[1])
+        with pytest.raises(ValueError, match=error):
+            process_event(event, extended=True, dtype=dtype, out=out and out(n),
+                          out_positions=out_positions and out_positions(n))
+
+
+@pytest.mark.parametrize("out, out_positions, dtype, error", EVENT_OUT_ERRORS[::3])
+def test_batch_out_errors(backend, make_event, flat_events, out, out_positions, dtype, error):
+    flat, offsets = flat_events([make_event(156 + i, 100) for i in range(3)])
+    with backend():
+        n = len(process_events_batch(flat, offsets)[1])
+        with pytest.raises(ValueError, match=error):
+            process_events_batch(flat, offsets, extended=True, dtype=dtype, out=out and out(n),
+                                 out_positions=out_positions and out_positions(n))
+
+
+@pytest.mark.parametrize("out, dtype, error", [
+    (np.zeros(25, dtype=np.float32), np.float64, "out must have dtype float64"),
+    (np.zeros(24), np.float64, r"out must have shape \(25,\)"),
+    (np.zeros(26), np.float64, r"out must have shape \(25,\)"),
+    (np.zeros((1, 25)), np.float64, r"out must have shape \(25,\)"),
+    (np.zeros(50)[::2], np.float64, "out must be a writeable C-contiguous array"),
+    (read_only(np.zeros(25)), np.float64, "out must be a writeable C-contiguous array"),
+])
+def test_sensor_out_errors(backend, sensor_hits, out, dtype, error):
+    times, charges = sensor_hits(157, 50)
+    with backend():
+        with pytest.raises(ValueError, match=error):
+            process_sensor_data(times, charges, extended=True, out=out, dtype=dtype)
+        with pytest.raises(ValueError, match=error):
+            compute_summary_stats(times, charges, extended=True, out=out, dtype=dtype)
@@ -0,0 +1,102 @@
+"""Merged PartialStats give the statistics of the whole hit array."""
+
+import functools
+import pickle
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import PartialStats, StatPlan, compute_summary_stats
+
+
+def split(times, charges, n_parts, seed):
+    """Contiguous parts of random sizes, some of them empty."""
+    rng = np.random.default_rng(seed)
+    cuts = np.sort(rng.integers(0, len(times) + 1, n_parts - 1))
+    bounds = np.concatenate(([0], cuts, [len(times)]))
+    return [(times[a:b], None if charges is None else charges[a:b]) for a, b in zip(bounds[:-1], bounds[1:])]
+
+
+def tree_merge(parts):
+    while len(parts) > 1:
+        parts = [parts[i].merge(parts[i + 1]) if i + 1 < len(parts) else parts[i] for i in range(0, len(parts), 2)]
+    return parts[0]
+
+
+@pytest.mark.parametrize("n_parts", [1, 2, 3, 7, 16])
+@pytest.mark.parametrize("extended", [False, True])
+def test_any_partition_matches_whole(native, sensor_hits, n_parts, extended):
+    times, charges = sensor_hits(n_parts, 3000, exact=False)
+    expected = compute_summary_stats(times, charges, extended)
+    parts = [PartialStats(t, q) for t, q in split(times, charges, n_parts, n_parts)]
+    left = functools.reduce(PartialStats.merge, parts)
+    right = functools.reduce(lambda acc, part: part.merge(acc), reversed(parts))
+    for merged in (left, right, tree_merge(parts)):
+        assert merged.n_hits == len(times)
+        np.testing.assert_array_equal(merged.stats(extended), expected)
+    np.testing.assert_array_equal(PartialStats(times, charges).stats(extended), expected)
+
+
+def test_partition_matches_whole_with_plan(native, sensor_hits):
+    plan = StatPlan(windows=(1.5, 400.0), quantiles=(0.01, 0.6), n_pulses=True, q_max_frac=True, skewness=True)
+    times, charges = sensor_hits(20, 50000, exact=False)
+    parts = [PartialStats(t, q) for t, q in split(times, charges, 5, 20)]
+    np.testing.assert_array_equal(tree_merge(parts).stats(plan=plan), compute_summary_stats(times, charges, plan=plan))
+
+
+def test_merged_state_is_sorted(native, sensor_hits):
+    times, charges = sensor_hits(21, 500, exact=False)
+    merged = tree_merge([PartialStats(t, q) for t, q in split(times, charges, 6, 21)])
+    order = np.argsort(times, kind="stable")
+    np.testing.assert_array_equal(merged.times, times[order])
+    np.testing.assert_array_equal(merged.charges, charges[order])
+
+
+@pytest.mark.parametrize("use_charges", [True, False])
+def test_pickle_round_trip(native, sensor_hits, use_charges):
+    times, charges = sensor_hits(22, 2000, exact=False)
+    charges = charges if use_charges else None
+    parts = [PartialStats(t, q) for t, q in split(times, charges, 4, 22)]
+    restored = [pickle.loads(pickle.dumps(part)) for part in parts]
+    for part, copy in zip(parts, restored):
+        np.testing.assert_array_equal(copy.times, part.times)
+        np.testing.assert_array_equal(copy.charges, part.charges)
+        np.testing.assert_array_equal(copy.stats(extended=True), part.stats(extended=True))
+    np.testing.assert_array_equal(tree_merge(restored).stats(extended=True), tree_merge(parts).stats(extended=True))
+    merged = pickle.loads(pickle.dumps(tree_merge(parts)))
+    np.testing.assert_array_equal(merged.stats(extended=True), tree_merge(parts).stats(extended=True))
+
+
+def test_unit_charges_stay_implicit(backend, sensor_hits):
+    times, charges = sensor_hits(26, 3000, exact=False)
+    with backend():
+        unit = [PartialStats(t) for t, _ in split(times, charges, 4, 26)]
+        ones = [PartialStats(t, np.ones_like(t)) for t, _ in split(times, charges, 4, 26)]
+        assert all(part.unit_charges for part in unit) and not any(part.unit_charges for part in ones)
+        merged = tree_merge(unit)
+        assert merged.unit_charges
+        assert pickle.loads(pickle.dumps(merged)).unit_charges
+        np.testing.assert_array_equal(merged.charges, np.ones(len(times)))
+        np.testing.assert_array_equal(merged.stats(extended=True), tree_merge(ones).stats(extended=True))
+        # A part with charges makes the merge store them, with ones for the unit part.
+        mixed = unit[0].merge(PartialStats(*split(times, charges, 4, 26)[1]))
+        assert not mixed.unit_charges
+        np.testing.assert_array_equal(mixed.stats(extended=True),
+                                      ones[0].merge(PartialStats(*split(times, charges, 4, 26)[1])).stats(extended=True))
+
+
+def test_int64_and_float32_parts(native):
+    times = np.random.default_rng(23).integers(-10**9, 10**9, 4000)
+    charges = np.random.default_rng(24).exponential(1.0, 4000).astype(np.float32)
+    parts = [PartialStats(t, q) for t, q in split(times, charges, 5, 23)]
+    expected = compute_summary_stats(times.astype(np.float64), charges.astype(np.float64), extended=True)
+    np.testing.assert_array_equal(tree_merge(parts).stats(extended=True), expected)
+
+
+@pytest.mark.parametrize("extended", [False, True])
+def test_matches_numpy(native, numpy_backend, sensor_hits, assert_stats_equal, extended):
+    times, charges = sensor_hits(25, 3000, exact=True)
+    actual = tree_merge([PartialStats(t, q) for t, q in split(times, charges, 6, 25)]).stats(extended)
+    with numpy_backend():
+        reference = tree_merge([PartialStats(t, q) for t, q in split(times, charges, 6, 25)]).stats(extended)
+    assert_stats_equal(actual, reference)
@@ -0,0 +1,73 @@
+"""Per-PMT tables against _process_event_arrays_numpy(pmt_ids=...)."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import NeighborRule, StatPlan, process_event
+from nt_summary_stats.event import _process_event_arrays_numpy
+
+NEIGHBORS_COLUMN = 23
+
+
+def with_pmts(event, seed, n_pmts=7, dtype=np.int32):
+    rng = np.random.default_rng(seed)
+    return dict(event, pmt_id=rng.integers(0, n_pmts, len(event["t"])).astype(dtype))
+
+
+def numpy_tables(event, grouping_window_ns=None, **kwargs):
+    """(positions, stats, pmt_offsets) of the PMT rows of the NumPy implementation."""
+    _, _, _, (positions, stats, pmts_per_sensor), _ = _process_event_arrays_numpy(
+        event["sensor_pos_x"], event["sensor_pos_y"], event["sensor_pos_z"], event["string_id"],
+        event["sensor_id"], event["t"], event.get("charge"), grouping_window_ns, pmt_ids=event["pmt_id"],
+        **kwargs)
+    return positions, stats, np.concatenate(([0], np.cumsum(pmts_per_sensor))).astype(np.int64)
+
+
+@pytest.mark.parametrize("pmt_dtype", [np.int16, np.int32, np.int64])
+@pytest.mark.parametrize("grouping_window_ns", [None, 2.5])
+def test_tables_match_numpy(native, make_event, assert_stats_equal, grouping_window_ns, pmt_dtype):
+    event = with_pmts(make_event(100, 4000, n_strings=6, n_sensors=20), 100, dtype=pmt_dtype)
+    positions, stats, pmt_positions, pmt_stats, pmt_offsets = process_event(
+        event, grouping_window_ns, extended=True, per_pmt=True)
+    expected_positions, expected_stats, expected_offsets = numpy_tables(event, grouping_window_ns, extended=True)
+    assert pmt_offsets.dtype == np.int64
+    np.testing.assert_array_equal(pmt_offsets, expected_offsets)
+    np.testing.assert_array_equal(pmt_positions, expected_positions)
+    assert_stats_equal(pmt_stats, expected_stats)
+    # The module rows are those of per_pmt=False.
+    modules = process_event(event, grouping_window_ns, extended=True)
+    np.testing.assert_array_equal(positions, modules[0])
+    np.testing.assert_array_equal(stats, modules[1])
+
+
+@pytest.mark.parametrize("rule", [NeighborRule(), NeighborRule(window_ns=30.0, radius=140.0, multiplicity=2)],
+                         ids=repr)
+def test_neighbors_copied_from_module(native, make_event, rule):
+    event = with_pmts(make_event(101, 3000, n_strings=6, n_sensors=20, exact=False), 101)
+    _, stats, _, pmt_stats, pmt_offsets = process_event(event, extended=True, neighbor_rule=rule, per_pmt=True)
+    assert stats[:, NEIGHBORS_COLUMN].any()
+    pmts_per_sensor = np.diff(pmt_offsets)
+    assert (pmts_per_sensor >= 1).all() and pmts_per_sensor.sum() == len(pmt_stats)
+    np.testing.assert_array_equal(pmt_stats[:, NEIGHBORS_COLUMN],
+                                  np.repeat(stats[:, NEIGHBORS_COLUMN], pmts_per_sensor))
+
+
+def test_plan_tables_match_numpy(native, make_event, assert_stats_equal):
+    plan = StatPlan.select(["n_string_neighbors", "charge_20ns", "charge_50_percent_time", "n_pulses"])
+    event = with_pmts(make_event(102, 2500, n_strings=6, n_sensors=20), 102)
+    _, _, pmt_positions, pmt_stats, pmt_offsets = process_event(event, 2.5, plan=plan, per_pmt=True)
+    expected_positions, expected_stats, expected_offsets = numpy_tables(event, 2.5, plan=plan)
+    np.testing.assert_array_equal(pmt_offsets, expected_offsets)
+    np.testing.assert_array_equal(pmt_positions, expected_positions)
+    assert_stats_equal(pmt_stats, expected_stats)
+
+
+def test_matches_numpy_backend(native, numpy_backend, make_event, assert_stats_equal):
+    event = with_pmts(make_event(103, 2000, n_strings=6, n_sensors=20), 103)
+    actual = process_event(event, extended=True, per_pmt=True)
+    with numpy_backend():
+        reference = process_event(event, extended=True, per_pmt=True)
+    for i in (0, 2, 4):
+        np.testing.assert_array_equal(actual[i], reference[i])
+    for i in (1, 3):
+        assert_stats_equal(actual[i], reference[i])
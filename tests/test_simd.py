@@ -0,0 +1,74 @@
+"""
+Every first-pass SIMD kernel gives the results of the scalar one.
+
+The kernels are chosen once, at import, so each ISA runs in a subprocess with
+NTSS_SIMD set; an empty cap selects the best kernel of the CPU (AVX-512 or NEON
+where available).
+"""
+
+import os
+import subprocess
+import sys
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import _backend
+
+CHILD = """
+import sys
+import numpy as np
+import nt_summary_stats
+from nt_summary_stats import _backend
+
+inputs = np.load(sys.argv[1])
+event = {key[6:]: inputs[key] for key in inputs.files if key.startswith("event_")}
+results = {}
+results["event"] = nt_summary_stats.process_event(event, extended=True)[1]
+results["grouped"] = nt_summary_stats.process_event(event, 7.5, extended=True)[1]
+results["unit"] = nt_summary_stats.process_event({k: v for k, v in event.items() if k != "charge"},
+                                                 extended=True)[1]
+for n in (1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 33, 1001, 70000):
+    times, charges = inputs["times"][:n], inputs["charges"][:n]
+    results[f"sensor_{n}"] = nt_summary_stats.compute_summary_stats(times, charges, extended=True)
+    results[f"float32_{n}"] = nt_summary_stats.compute_summary_stats(
+        times.astype(np.float32), charges.astype(np.float32), extended=True)
+np.savez(sys.argv[2], **results)
+print(_backend.get_native_module().simd_isa())
+"""
+
+
+def run_with_simd(cap, inputs_path, output_path):
+    env = dict(os.environ, NTSS_SIMD=cap, NTSS_FORCE_NATIVE="1", PYTHONPATH=os.pathsep.join(sys.path))
+    env.pop("NTSS_DISABLE_NATIVE", None)
+    completed = subprocess.run([sys.executable, "-c", CHILD, str(inputs_path), str(output_path)],
+                               env=env, capture_output=True, text=True, check=True)
+    return completed.stdout.strip(), np.load(output_path)
+
+
+@pytest.fixture(scope="module")
+def inputs_path(tmp_path_factory, make_event, sensor_hits):
+    event = make_event(10, 5000, n_strings=10, n_sensors=40, exact=False, bright_hits=70000)
+    times, charges = sensor_hits(11, 70000, exact=False)
+    path = tmp_path_factory.mktemp("simd") / "inputs.npz"
+    np.savez(path, times=times, charges=charges, **{f"event_{key}": value for key, value in event.items()})
+    return path
+
+
+@pytest.fixture(scope="module")
+def scalar_results(inputs_path):
+    if _backend.get_native_module() is None:
+        pytest.skip("native extension not built")
+    isa, results = run_with_simd("scalar", inputs_path, inputs_path.parent / "scalar.npz")
+    assert isa == "scalar"
+    return results
+
+
+@pytest.mark.parametrize("cap", ["sse2", "avx2", ""])
+def test_kernel_matches_scalar(scalar_results, inputs_path, cap):
+    isa, results = run_with_simd(cap, inputs_path, inputs_path.parent / f"{cap or 'best'}.npz")
+    if cap and isa != cap:
+        pytest.skip(f"CPU has no {cap} kernel (selected {isa})")
+    assert set(results.files) == set(scalar_results.files)
+    for name in results.files:
+        np.testing.assert_array_equal(results[name], scalar_results[name], err_msg=f"{isa}: {name}")
@@ -0,0 +1,63 @@
+"""Event rows of sensors with one or two hits match the single-sensor kernel."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import StatPlan, process_event, process_sensor_data
+
+NEIGHBORS = "n_string_neighbors"
+PLANS = [
+    None,
+    StatPlan.standard(),
+    StatPlan(windows=(0.0, 3.0, 1e6), quantiles=(0.01, 0.5, 0.99), n_pulses=True, q_max_frac=True, skewness=True),
+    StatPlan.select(["charge_0ns", "charge_1_percent_time", "q_max_frac"]),
+]
+
+
+def pairs_event(seed, n_sensors=400):
+    """One or two hits per sensor, in shuffled order, with tied times and zero, negative and tiny charges."""
+    rng = np.random.default_rng(seed)
+    counts = rng.integers(1, 3, n_sensors)
+    sensor = np.repeat(np.arange(n_sensors), counts)
+    times = np.floor(rng.uniform(-50.0, 50.0, len(sensor)))
+    second = np.flatnonzero(sensor[1:] == sensor[:-1]) + 1
+    tied = second[rng.random(len(second)) < 0.3]
+    times[tied] = times[tied - 1]
+    values = np.array([0.0, -0.0, 1.0, -1.0, 2.5, 1e-300, -3.0])
+    charges = np.where(rng.random(len(sensor)) < 0.5, values[rng.integers(0, len(values), len(sensor))],
+                       rng.uniform(-2.0, 5.0, len(sensor)))
+    order = rng.permutation(len(sensor))
+    sensor, times, charges = sensor[order], times[order], charges[order]
+    string_ids = (sensor // 20 + 1).astype(np.int32)
+    sensor_ids = (sensor % 20 + 1).astype(np.int32)
+    return {
+        "sensor_pos_x": string_ids * 125.0,
+        "sensor_pos_y": np.zeros(len(sensor)),
+        "sensor_pos_z": sensor_ids * -17.0,
+        "string_id": string_ids,
+        "sensor_id": sensor_ids,
+        "t": times,
+        "charge": charges,
+    }
+
+
+@pytest.mark.parametrize("plan", PLANS, ids=lambda plan: "extended" if plan is None else repr(plan))
+@pytest.mark.parametrize("unit", [False, True])
+@pytest.mark.parametrize("seed", [190, 191])
+def test_rows_match_sensor_kernel(native, plan, unit, seed):
+    event = pairs_event(seed)
+    if unit:
+        del event["charge"]
+    kwargs = {"extended": True} if plan is None else {"plan": plan}
+    _, stats = process_event(event, **kwargs)
+    keys = np.column_stack((event["string_id"], event["sensor_id"]))
+    unique_keys, rows = np.unique(keys, axis=0, return_inverse=True)
+    rows = rows.reshape(-1)
+    names = (plan or StatPlan.extended()).names
+    for row in range(len(unique_keys)):
+        hits = rows == row
+        expected = process_sensor_data(event["t"][hits], None if unit else event["charge"][hits], **kwargs)
+        if NEIGHBORS in names:
+            # An event-level count.
+            expected[names.index(NEIGHBORS)] = stats[row, names.index(NEIGHBORS)]
+        np.testing.assert_array_equal(stats[row], expected)
@@ -0,0 +1,91 @@
+"""
+The three hit-ordering engines (counting, radix and comparison sort) give the
+same rows, in (string_id, sensor_id) order, with tied times kept in input order.
+
+The engine is picked from the event: a counting sort when the ID ranges span at
+most 4 slots per hit, else a radix sort from kRadixSortMinHits (192) hits up and
+a comparison sort below. Mapping the IDs monotonically onto a sparse range keeps
+the rows but switches the engine.
+"""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import process_event, process_sensor_data
+
+RADIX_SORT_MIN_HITS = 192
+NEIGHBORS_COLUMN = 23
+ID_DTYPES = [np.int16, np.int32, np.int64]
+
+
+def compact(event, dtype):
+    """6 x 20 sensor slots: counting sort from 30 hits up."""
+    return dict(event, string_id=event["string_id"].astype(dtype), sensor_id=event["sensor_id"].astype(dtype))
+
+
+def sparse(event, dtype):
+    """The same sensors spread over ~25000 x 19000 slots (negative IDs included) to rule out the counting sort."""
+    return dict(event, string_id=(event["string_id"].astype(np.int64) * 5000 - 16000).astype(dtype),
+                sensor_id=(event["sensor_id"].astype(np.int64) * 1000 - 10000).astype(dtype))
+
+
+def sensor_rows(event, stats):
+    """Each row computed from its sensor's hits alone, in input order."""
+    keys = np.column_stack((event["string_id"], event["sensor_id"]))
+    unique_keys, rows = np.unique(keys, axis=0, return_inverse=True)
+    rows = rows.reshape(-1)
+    assert len(unique_keys) == len(stats)
+    expected = np.empty_like(stats)
+    for row in range(len(unique_keys)):
+        hits = rows == row
+        expected[row] = process_sensor_data(event["t"][hits], event["charge"][hits], extended=True)
+        # n_string_neighbors is an event-level count.
+        expected[row, NEIGHBORS_COLUMN] = stats[row, NEIGHBORS_COLUMN]
+    return unique_keys, expected
+
+
+@pytest.mark.parametrize("id_dtype", ID_DTYPES)
+@pytest.mark.parametrize("n_hits", [30, 100, RADIX_SORT_MIN_HITS - 1, RADIX_SORT_MIN_HITS,
+                                    RADIX_SORT_MIN_HITS + 1, 3000])
+def test_engines_agree(native, make_event, n_hits, id_dtype):
+    event = make_event(110 + n_hits, n_hits, exact=False)
+    counting = process_event(compact(event, id_dtype), extended=True)
+    by_id = process_event(sparse(event, id_dtype), extended=True)
+    for a, b in zip(counting, by_id):
+        np.testing.assert_array_equal(a, b)
+    # Rows are in (string_id, sensor_id) order; make_event encodes the IDs in x and z.
+    unique_keys, expected = sensor_rows(event, counting[1])
+    np.testing.assert_array_equal(np.rint(counting[0][:, 0] / 125.0), unique_keys[:, 0])
+    np.testing.assert_array_equal(np.rint(counting[0][:, 2] / -17.0), unique_keys[:, 1])
+    np.testing.assert_array_equal(counting[1], expected)
+
+
+@pytest.mark.parametrize("id_dtype", ID_DTYPES)
+@pytest.mark.parametrize("n_hits", [2, 17, RADIX_SORT_MIN_HITS - 1, RADIX_SORT_MIN_HITS])
+def test_all_ties(native, make_event, n_hits, id_dtype):
+    # Every hit at the same time: only the input order separates them.
+    event = make_event(120 + n_hits, n_hits, n_strings=2, n_sensors=2, exact=False)
+    event["t"] = np.full(n_hits, 42.0)
+    for mapping in (compact, sparse):
+        mapped = mapping(event, id_dtype)
+        _, stats = process_event(mapped, extended=True)
+        np.testing.assert_array_equal(stats, sensor_rows(event, stats)[1])
+
+
+@pytest.mark.parametrize("mapping", [compact, sparse])
+def test_bright_sensor(native, make_event, mapping):
+    # Sensor (1, 1) holds over kParallelSensorHits hits, so its run is sorted in parallel.
+    event = make_event(130, 3000, exact=False, bright_hits=70000)
+    _, stats = process_event(mapping(event, np.int32), extended=True)
+    np.testing.assert_array_equal(stats, sensor_rows(event, stats)[1])
+
+
+def test_sorted_input(native, make_event):
+    # Runs already in time order skip the per-sensor sort.
+    event = make_event(131, 5000, exact=False)
+    order = np.lexsort((event["t"], event["sensor_id"], event["string_id"]))
+    ordered = {key: column[order] for key, column in event.items()}
+    for mapping in (compact, sparse):
+        for a, b in zip(process_event(mapping(ordered, np.int32), extended=True),
+                        process_event(mapping(event, np.int32), extended=True)):
+            np.testing.assert_array_equal(a, b)
@@ -0,0 +1,160 @@
+"""Results of the native event paths do not depend on the thread count."""
+
+import os
+import subprocess
+import sys
+import threading
+
+import numpy as np
+import pytest
+
+import nt_summary_stats
+from nt_summary_stats import process_event, process_events_batch
+
+
+@pytest.fixture
+def flat_batch(make_event, flat_events):
+    def build(n_events, seed, exact=True):
+        return flat_events([make_event(seed + i, 50 + 97 * i, exact=exact) for i in range(n_events)])
+    return build
+
+
+@pytest.mark.parametrize("grouping_window_ns", [None, 7.5])
+@pytest.mark.parametrize("n_threads", [2, 3, 8])
+def test_process_event_matches_serial(pool_of_eight, make_event, n_threads, grouping_window_ns):
+    event = make_event(1, 20000, n_strings=30, n_sensors=60, exact=False)
+    serial = process_event(event, grouping_window_ns, extended=True, n_threads=1)
+    parallel = process_event(event, grouping_window_ns, extended=True, n_threads=n_threads)
+    for a, b in zip(parallel, serial):
+        np.testing.assert_array_equal(a, b)
+
+
+@pytest.mark.parametrize("n_threads", [2, 5, 8])
+def test_bright_sensor_matches_serial(pool_of_eight, make_event, n_threads):
+    # 100000 hits on one sensor: parallel merge sort and blocked sums.
+    event = make_event(2, 500, exact=False, bright_hits=100000)
+    serial = process_event(event, extended=True, n_threads=1)
+    parallel = process_event(event, extended=True, n_threads=n_threads)
+    for a, b in zip(parallel, serial):
+        np.testing.assert_array_equal(a, b)
+
+
+@pytest.mark.parametrize("n_threads", [2, 8])
+def test_process_events_batch_matches_serial(pool_of_eight, flat_batch, n_threads):
+    flat, offsets = flat_batch(40, 3, exact=False)
+    serial = process_events_batch(flat, offsets, 7.5, extended=True, n_threads=1)
+    parallel = process_events_batch(flat, offsets, 7.5, extended=True, n_threads=n_threads)
+    for a, b in zip(parallel, serial):
+        np.testing.assert_array_equal(a, b)
+
+
+def test_process_events_batch_matches_single_events(pool_of_eight, flat_batch):
+    flat, offsets = flat_batch(12, 4, exact=False)
+    positions, stats, sensor_offsets = process_events_batch(flat, offsets, extended=True)
+    for i in range(len(offsets) - 1):
+        event = {key: column[offsets[i]:offsets[i + 1]] for key, column in flat.items()}
+        event_positions, event_stats = process_event(event, extended=True, n_threads=1)
+        rows = slice(sensor_offsets[i], sensor_offsets[i + 1])
+        np.testing.assert_array_equal(positions[rows], event_positions)
+        np.testing.assert_array_equal(stats[rows], event_stats)
+
+
+@pytest.mark.parametrize("grouping_window_ns", [None, 2.5])
+@pytest.mark.parametrize("extended", [False, True])
+def test_process_event_matches_numpy(pool_of_eight, numpy_backend, make_event, assert_stats_equal, extended, grouping_window_ns):
+    event = make_event(5, 3000)
+    native = process_event(event, grouping_window_ns, extended=extended, n_threads=8)
+    with numpy_backend():
+        reference = process_event(event, grouping_window_ns, extended=extended)
+    np.testing.assert_array_equal(native[0], reference[0])
+    assert_stats_equal(native[1], reference[1])
+
+
+def test_process_events_batch_matches_numpy(pool_of_eight, numpy_backend, flat_batch, assert_stats_equal):
+    flat, offsets = flat_batch(10, 6)
+    native = process_events_batch(flat, offsets, extended=True, n_threads=8)
+    with numpy_backend():
+        reference = process_events_batch(flat, offsets, extended=True)
+    np.testing.assert_array_equal(native[0], reference[0])
+    assert_stats_equal(native[1], reference[1])
+    np.testing.assert_array_equal(native[2], reference[2])
+
+
+FORK_CHILD = """
+import os
+import sys
+import numpy as np
+import nt_summary_stats
+
+inputs = np.load(sys.argv[1])
+event = {key: inputs[key] for key in inputs.files}
+nt_summary_stats.set_num_threads(4)
+expected = nt_summary_stats.process_event(event, extended=True)[1]
+
+
+def check(depth):
+    # Fork with the pool running, then use it again in the child (and grandchild).
+    pid = os.fork()
+    if pid == 0:
+        ok = all(np.array_equal(nt_summary_stats.process_event(event, extended=True, n_threads=n)[1], expected)
+                 for n in (4, 2))
+        if ok and depth > 1:
+            ok = check(depth - 1)
+        os._exit(0 if ok else 1)
+    _, status = os.waitpid(pid, 0)
+    return os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0
+
+
+results = [check(2) for _ in range(3)]
+# The parent's pool is unaffected.
+assert np.array_equal(nt_summary_stats.process_event(event, extended=True)[1], expected)
+print(sum(results))
+"""
+
+
+@pytest.mark.skipif(not hasattr(os, "fork"), reason="needs fork()")
+def test_pool_survives_fork(native, make_event, tmp_path):
+    event = make_event(170, 20000, exact=False, bright_hits=70000)
+    path = tmp_path / "event.npz"
+    np.savez(path, **event)
+    env = dict(os.environ, NTSS_FORCE_NATIVE="1", PYTHONPATH=os.pathsep.join(sys.path))
+    completed = subprocess.run([sys.executable, "-c", FORK_CHILD, str(path)], env=env, capture_output=True,
+                               text=True, timeout=300)
+    assert completed.returncode == 0, completed.stderr
+    assert completed.stdout.strip() == "3"
+
+
+def test_nested_batch_and_bright_sensors(pool_of_eight, make_event, flat_events):
+    # Events run in parallel and each bright sensor is sorted and reduced in parallel inside them.
+    events = [make_event(171 + i, 500, exact=False, bright_hits=70000 * (i % 2)) for i in range(6)]
+    flat, offsets = flat_events(events)
+    positions, stats, sensor_offsets = process_events_batch(flat, offsets, 2.5, extended=True)
+    for i, event in enumerate(events):
+        rows = slice(sensor_offsets[i], sensor_offsets[i + 1])
+        expected = process_event(event, 2.5, extended=True, n_threads=1)
+        np.testing.assert_array_equal(positions[rows], expected[0])
+        np.testing.assert_array_equal(stats[rows], expected[1])
+
+
+def test_concurrent_callers_while_resizing(pool_of_eight, make_event):
+    event = make_event(177, 4000, exact=False, bright_hits=70000)
+    expected = process_event(event, extended=True, n_threads=1)
+    mismatches = []
+
+    def work():
+        for _ in range(6):
+            result = process_event(event, extended=True)
+            if not all(np.array_equal(a, b) for a, b in zip(result, expected)):
+                mismatches.append(result)
+
+    workers = [threading.Thread(target=work) for _ in range(4)]
+    for worker in workers:
+        worker.start()
+    # Running computations keep their pool; each resize applies to later work.
+    sizes = [1, 3, 8, 2, 5]
+    while any(worker.is_alive() for worker in workers):
+        nt_summary_stats.set_num_threads(sizes[0])
+        sizes = sizes[1:] + sizes[:1]
+    for worker in workers:
+        worker.join()
+    assert not mismatches
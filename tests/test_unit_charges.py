@@ -0,0 +1,74 @@
+"""Hits without charges (kUnitCharge kernels) match explicit charges of 1.0."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import (PartialStats, SensorAccumulator, StatPlan, process_event, process_events_batch,
+                              process_sensor_data)
+
+
+def without_charges(event):
+    return {key: column for key, column in event.items() if key != "charge"}
+
+
+def with_unit_charges(event):
+    return dict(event, charge=np.ones_like(event["t"]))
+
+
+@pytest.mark.parametrize("grouping_window_ns", [None, 7.5])
+@pytest.mark.parametrize("extended", [False, True])
+def test_process_event(native, make_event, extended, grouping_window_ns):
+    event = make_event(30, 20000, n_strings=12, n_sensors=50, exact=False, bright_hits=70000)
+    unit = process_event(without_charges(event), grouping_window_ns, extended=extended)
+    ones = process_event(with_unit_charges(event), grouping_window_ns, extended=extended)
+    for a, b in zip(unit, ones):
+        np.testing.assert_array_equal(a, b)
+
+
+def test_process_event_plan(native, make_event):
+    plan = StatPlan(windows=(5.0,), quantiles=(0.5,), n_pulses=True, q_max_frac=True, skewness=True)
+    event = make_event(31, 5000, exact=False)
+    unit = process_event(without_charges(event), plan=plan)
+    ones = process_event(with_unit_charges(event), plan=plan)
+    for a, b in zip(unit, ones):
+        np.testing.assert_array_equal(a, b)
+
+
+def test_process_events_batch(native, make_event, flat_events):
+    flat, offsets = flat_events([make_event(32 + i, 200 + 300 * i, exact=False) for i in range(8)])
+    unit = process_events_batch(without_charges(flat), offsets, 2.5, extended=True)
+    ones = process_events_batch(with_unit_charges(flat), offsets, 2.5, extended=True)
+    for a, b in zip(unit, ones):
+        np.testing.assert_array_equal(a, b)
+
+
+@pytest.mark.parametrize("grouping_window_ns", [None, 0.5, 7.5])
+@pytest.mark.parametrize("n_hits", [1, 2, 3, 17, 4000, 70000])
+def test_single_sensor(native, sensor_hits, n_hits, grouping_window_ns):
+    times, _ = sensor_hits(n_hits, n_hits, exact=False)
+    np.testing.assert_array_equal(process_sensor_data(times, None, grouping_window_ns, extended=True),
+                                  process_sensor_data(times, np.ones_like(times), grouping_window_ns, extended=True))
+
+
+def test_accumulator_and_partial_stats(native, sensor_hits):
+    times, _ = sensor_hits(33, 3000, exact=False)
+    times = np.sort(times)
+    ones = np.ones_like(times)
+    unit, explicit = SensorAccumulator(extended=True), SensorAccumulator(extended=True)
+    for start in range(0, len(times), 250):
+        unit.add(times[start:start + 250])
+        explicit.add(times[start:start + 250], ones[start:start + 250])
+    np.testing.assert_array_equal(unit.stats(), explicit.stats())
+    merged_unit = PartialStats(times[:1000]).merge(PartialStats(times[1000:]))
+    merged_ones = PartialStats(times[:1000], ones[:1000]).merge(PartialStats(times[1000:], ones[1000:]))
+    np.testing.assert_array_equal(merged_unit.stats(extended=True), merged_ones.stats(extended=True))
+
+
+@pytest.mark.parametrize("grouping_window_ns", [None, 2.5])
+def test_process_event_matches_numpy(native, numpy_backend, make_event, assert_stats_equal, grouping_window_ns):
+    event = without_charges(make_event(34, 3000))
+    actual = process_event(event, grouping_window_ns, extended=True)
+    with numpy_backend():
+        reference = process_event(event, grouping_window_ns, extended=True)
+    np.testing.assert_array_equal(actual[0], reference[0])
+    assert_stats_equal(actual[1], reference[1])
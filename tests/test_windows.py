@@ -0,0 +1,70 @@
+"""A charge window that covers every hit reports exactly total_charge."""
+
+import numpy as np
+import pytest
+
+from nt_summary_stats import (PartialStats, SensorAccumulator, StatPlan, compute_summary_stats, process_event,
+                              process_sensor_data)
+
+TOTAL_CHARGE_COLUMN = 0
+CHARGE_2000NS_COLUMN = 20
+
+
+def burst(seed, n_hits, duration=1500.0):
+    """Hits spread over less than 2000 ns, with charges whose running and pairwise sums round differently."""
+    rng = np.random.default_rng(seed)
+    times = rng.uniform(0.0, duration, n_hits)
+    return times, rng.exponential(1.0, n_hits) * np.pi
+
+
+@pytest.mark.parametrize("n_hits", [2, 3, 17, 1000, 20000, 70000])
+def test_charge_2000ns_is_total_charge(backend, n_hits):
+    times, charges = burst(180 + n_hits, n_hits)
+    with backend():
+        stats = compute_summary_stats(times, charges, extended=True)
+        grouped = process_sensor_data(times, charges, 0.5, extended=True)
+    assert stats[CHARGE_2000NS_COLUMN] == stats[TOTAL_CHARGE_COLUMN]
+    assert grouped[CHARGE_2000NS_COLUMN] == grouped[TOTAL_CHARGE_COLUMN]
+
+
+def test_plan_windows(backend):
+    times, charges = burst(181, 5000)
+    plan = StatPlan(windows=(100.0, 1500.0, 1e9), quantiles=(0.5,))
+    with backend():
+        stats = compute_summary_stats(times, charges, plan=plan)
+    names = plan.names
+    total = stats[names.index("total_charge")]
+    assert stats[names.index("charge_1500ns")] == total
+    assert stats[names.index("charge_1000000000ns")] == total
+    assert stats[names.index("charge_100ns")] < total
+
+
+def test_event_rows(backend, make_event):
+    event = make_event(182, 30000, exact=False, bright_hits=70000)
+    event["t"] = event["t"] % 1900.0
+    event["charge"] = event["charge"] * np.pi
+    with backend():
+        _, stats = process_event(event, extended=True)
+    np.testing.assert_array_equal(stats[:, CHARGE_2000NS_COLUMN], stats[:, TOTAL_CHARGE_COLUMN])
+
+
+def test_accumulator_and_partial_stats(native):
+    times, charges = burst(183, 40000)
+    order = np.argsort(times, kind="stable")
+    times, charges = times[order], charges[order]
+    accumulator = SensorAccumulator(extended=True)
+    for start in range(0, len(times), 3000):
+        accumulator.add(times[start:start + 3000], charges[start:start + 3000])
+    merged = PartialStats(times[:15000], charges[:15000]).merge(PartialStats(times[15000:], charges[15000:]))
+    for stats in (accumulator.stats(), merged.stats(extended=True)):
+        assert stats[CHARGE_2000NS_COLUMN] == stats[TOTAL_CHARGE_COLUMN]
+
+
+@pytest.mark.parametrize("grouping_window_ns", [None, 2.5])
+def test_window_only_plan(backend, grouping_window_ns):
+    # No total_charge column: the window still reports the total the first pass forms.
+    times, charges = burst(184, 3000)
+    with backend():
+        window = process_sensor_data(times, charges, grouping_window_ns, plan=["charge_5000ns"])
+        total = process_sensor_data(times, charges, grouping_window_ns, plan=["total_charge"])
+    assert window[0] == total[0]